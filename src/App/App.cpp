@@ -29,7 +29,7 @@ Application::~Application()
 		initStatus = glfwStatus;
 		return glfwStatus;
 	}
-	uiManager->Initialize(window);
+	uiManager->Initialize(window, uploadQueue);
 
 
 	int major, minor, rev;
@@ -51,6 +51,7 @@ void Application::RunApplication()
 	while(!glfwWindowShouldClose(window))
 	{
 		glfwPollEvents();
+		uploadQueue.Drain(ORM::GpuUploadBudgetMs);
 		RenderScene();
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
@@ -69,6 +70,8 @@ void Application::RunApplication()
 
 void Application::Shutdown()
 {
+	uploadQueue.Shutdown();
+
 	if(uiManager)
 	{
 		uiManager->Shutdown();
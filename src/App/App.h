@@ -3,6 +3,7 @@
 #include <memory>
 #include <string_view>
 #include <optional>
+#include "GpuUploadQueue.h"
 #include "UIManager.h"
 
 enum class InitStatus
@@ -34,5 +35,8 @@ private:
 
 	GLFWwindow* window = nullptr;
 	std::optional<InitStatus> initStatus;
+
+	// Worker threads post pixels here; only RunApplication's render loop touches GL.
+	GpuUploadQueue uploadQueue;
 	std::unique_ptr<UIManager> uiManager;
 };
\ No newline at end of file
@@ -0,0 +1,534 @@
+#include "BatchManifest.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	// -----------------------------------------------------------------
+	// Minimal JSON reader: enough for manifests (objects, arrays, strings,
+	// numbers, booleans, null). Numbers are kept as text; they are not used.
+	// -----------------------------------------------------------------
+
+	struct JsonValue
+	{
+		enum class Type { Null, Bool, Number, String, Array, Object } type = Type::Null;
+		bool boolean = false;
+		std::string text;
+		std::vector<JsonValue> items;
+		std::vector<std::string> keys;
+
+		const JsonValue* Find(const std::string& key) const
+		{
+			for(size_t i = 0; i < keys.size(); ++i)
+				if(keys[i] == key) return &items[i];
+			return nullptr;
+		}
+	};
+
+	class JsonParser
+	{
+	public:
+		explicit JsonParser(const std::string& source) : src(source) {}
+
+		bool Parse(JsonValue& out, std::string& error)
+		{
+			if(!ParseValue(out, 0)) {
+				error = "JSON parse error at offset " + std::to_string(pos) + ": " + message;
+				return false;
+			}
+			SkipWhitespace();
+			if(pos != src.size()) {
+				error = "JSON parse error at offset " + std::to_string(pos) + ": trailing characters";
+				return false;
+			}
+			return true;
+		}
+
+	private:
+		bool Error(const char* what)
+		{
+			message = what;
+			return false;
+		}
+
+		void SkipWhitespace()
+		{
+			while(pos < src.size() && std::isspace(static_cast<unsigned char>(src[pos])))
+				++pos;
+		}
+
+		bool Consume(char c)
+		{
+			SkipWhitespace();
+			if(pos < src.size() && src[pos] == c) {
+				++pos;
+				return true;
+			}
+			return false;
+		}
+
+		bool Literal(const char* word)
+		{
+			const size_t length = std::char_traits<char>::length(word);
+			if(src.compare(pos, length, word) != 0)
+				return Error("invalid literal");
+			pos += length;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& out, int depth)
+		{
+			if(depth > 64)
+				return Error("nesting too deep");
+
+			SkipWhitespace();
+			if(pos >= src.size())
+				return Error("unexpected end of input");
+
+			const char c = src[pos];
+			if(c == '{') return ParseObject(out, depth);
+			if(c == '[') return ParseArray(out, depth);
+			if(c == '"') { out.type = JsonValue::Type::String; return ParseString(out.text); }
+			if(c == 't') { out.type = JsonValue::Type::Bool; out.boolean = true; return Literal("true"); }
+			if(c == 'f') { out.type = JsonValue::Type::Bool; out.boolean = false; return Literal("false"); }
+			if(c == 'n') { out.type = JsonValue::Type::Null; return Literal("null"); }
+			if(c == '-' || std::isdigit(static_cast<unsigned char>(c))) {
+				const size_t start = pos;
+				while(pos < src.size() && std::strchr("+-0123456789.eE", src[pos]))
+					++pos;
+				out.type = JsonValue::Type::Number;
+				out.text = src.substr(start, pos - start);
+				return true;
+			}
+			return Error("unexpected character");
+		}
+
+		bool ParseObject(JsonValue& out, int depth)
+		{
+			out.type = JsonValue::Type::Object;
+			++pos;
+			if(Consume('}'))
+				return true;
+
+			do {
+				SkipWhitespace();
+				std::string key;
+				if(pos >= src.size() || src[pos] != '"' || !ParseString(key))
+					return Error("expected object key");
+				if(!Consume(':'))
+					return Error("expected ':'");
+
+				out.keys.push_back(std::move(key));
+				out.items.emplace_back();
+				if(!ParseValue(out.items.back(), depth + 1))
+					return false;
+			} while(Consume(','));
+
+			return Consume('}') || Error("expected ',' or '}'");
+		}
+
+		bool ParseArray(JsonValue& out, int depth)
+		{
+			out.type = JsonValue::Type::Array;
+			++pos;
+			if(Consume(']'))
+				return true;
+
+			do {
+				out.items.emplace_back();
+				if(!ParseValue(out.items.back(), depth + 1))
+					return false;
+			} while(Consume(','));
+
+			return Consume(']') || Error("expected ',' or ']'");
+		}
+
+		bool ParseString(std::string& out)
+		{
+			++pos;
+			while(pos < src.size())
+			{
+				const char c = src[pos++];
+				if(c == '"')
+					return true;
+				if(c != '\\') {
+					out += c;
+					continue;
+				}
+				if(pos >= src.size())
+					break;
+
+				const char escaped = src[pos++];
+				switch(escaped)
+				{
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u': {
+					if(pos + 4 > src.size())
+						return Error("truncated \\u escape");
+					const unsigned long code = std::strtoul(src.substr(pos, 4).c_str(), nullptr, 16);
+					pos += 4;
+					// Basic Multilingual Plane only; surrogate pairs are not expected in paths.
+					if(code < 0x80) {
+						out += static_cast<char>(code);
+					}
+					else if(code < 0x800) {
+						out += static_cast<char>(0xC0 | (code >> 6));
+						out += static_cast<char>(0x80 | (code & 0x3F));
+					}
+					else {
+						out += static_cast<char>(0xE0 | (code >> 12));
+						out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+						out += static_cast<char>(0x80 | (code & 0x3F));
+					}
+					break;
+				}
+				default:
+					return Error("invalid escape");
+				}
+			}
+			return Error("unterminated string");
+		}
+
+		const std::string& src;
+		size_t pos = 0;
+		const char* message = "";
+	};
+
+	// -----------------------------------------------------------------
+	// Shared helpers
+	// -----------------------------------------------------------------
+
+	std::string ToLower(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [] (unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return text;
+	}
+
+	std::string Trim(const std::string& text)
+	{
+		const size_t first = text.find_first_not_of(" \t\r\n");
+		if(first == std::string::npos)
+			return std::string();
+		const size_t last = text.find_last_not_of(" \t\r\n");
+		return text.substr(first, last - first + 1);
+	}
+
+	bool ReadFile(const std::string& path, std::string& contents, std::string& error)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if(!file) {
+			error = "Cannot open manifest: " + path;
+			return false;
+		}
+		std::ostringstream buffer;
+		buffer << file.rdbuf();
+		contents = buffer.str();
+		return true;
+	}
+
+	std::string Resolve(const fs::path& base, const std::string& path)
+	{
+		const fs::path p(path);
+		return (p.is_absolute() ? p : base / p).lexically_normal().string();
+	}
+
+	std::string DefaultOutputDir(const std::string& manifestPath, const std::string& outputDir)
+	{
+		if(!outputDir.empty())
+			return outputDir;
+		const fs::path parent = fs::path(manifestPath).parent_path();
+		return parent.empty() ? std::string(".") : parent.string();
+	}
+
+	void ApplyDefaultOutputs(ORMJob& job, const std::string& outputDir)
+	{
+		if(job.generateUnreal && job.unrealPath.empty())
+			job.unrealPath = (fs::path(outputDir) / (job.name + "_ORM_Unreal.png")).string();
+		if(job.generateUnity && job.unityPath.empty())
+			job.unityPath = (fs::path(outputDir) / (job.name + "_ORM_Unity.png")).string();
+	}
+
+	bool ValidateJob(const ORMJob& job, size_t index, std::string& error)
+	{
+		if(job.aoPath.empty() || job.roughnessPath.empty() || job.metallicPath.empty()) {
+			error = "Material #" + std::to_string(index + 1) + " (" + job.name + ") is missing an ao, roughness or metallic path";
+			return false;
+		}
+		if(!job.generateUnreal && !job.generateUnity) {
+			error = "Material #" + std::to_string(index + 1) + " (" + job.name + ") has no outputs";
+			return false;
+		}
+		return true;
+	}
+
+	/** Rejects two outputs (across all materials) that resolve to the same file; concurrent encodes would corrupt it. */
+	bool CheckUniqueOutputs(const std::vector<ORMJob>& jobs, std::string& error)
+	{
+		auto normalise = [] (const std::string& path) {
+			std::error_code ec;
+			const fs::path canonical = fs::weakly_canonical(path, ec);
+			return ec ? fs::absolute(path, ec).lexically_normal().string() : canonical.string();
+		};
+
+		std::map<std::string, std::string> owners;
+		for(const ORMJob& job : jobs)
+		{
+			const std::pair<bool, const std::string*> outputs[] = { { job.generateUnreal, &job.unrealPath }, { job.generateUnity, &job.unityPath } };
+			for(const auto& [enabled, path] : outputs)
+			{
+				if(!enabled || path->empty())
+					continue;
+				const auto [it, inserted] = owners.emplace(normalise(*path), job.name);
+				if(!inserted) {
+					error = "Output " + *path + " is written by both '" + it->second + "' and '" + job.name + "'";
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	std::vector<std::string> SplitCSVLine(const std::string& line)
+	{
+		std::vector<std::string> cells;
+		std::string cell;
+		bool quoted = false;
+		for(size_t i = 0; i < line.size(); ++i)
+		{
+			const char c = line[i];
+			if(quoted) {
+				if(c == '"' && i + 1 < line.size() && line[i + 1] == '"') { cell += '"'; ++i; }
+				else if(c == '"') quoted = false;
+				else cell += c;
+			}
+			else if(c == '"') quoted = true;
+			else if(c == ',') { cells.push_back(Trim(cell)); cell.clear(); }
+			else cell += c;
+		}
+		cells.push_back(Trim(cell));
+		return cells;
+	}
+}
+
+[[nodiscard]] bool BatchManifest::Load(const std::string& path, const std::string& outputDir, std::vector<ORMJob>& jobs, std::string& error)
+{
+	const std::string extension = ToLower(fs::path(path).extension().string());
+	if(extension == ".json")
+		return LoadJSON(path, outputDir, jobs, error);
+	if(extension == ".csv")
+		return LoadCSV(path, outputDir, jobs, error);
+
+	error = "Unsupported manifest type (expected .json or .csv): " + path;
+	return false;
+}
+
+[[nodiscard]] bool BatchManifest::LoadJSON(const std::string& path, const std::string& outputDir, std::vector<ORMJob>& jobs, std::string& error)
+{
+	std::string contents;
+	if(!ReadFile(path, contents, error))
+		return false;
+
+	JsonValue root;
+	if(!JsonParser(contents).Parse(root, error))
+		return false;
+
+	const JsonValue* materials = &root;
+	if(root.type == JsonValue::Type::Object)
+		materials = root.Find("materials");
+	if(!materials || materials->type != JsonValue::Type::Array) {
+		error = "Manifest must be an array of materials or an object with a \"materials\" array";
+		return false;
+	}
+
+	const fs::path base = fs::path(path).parent_path();
+	const std::string outDir = DefaultOutputDir(path, outputDir);
+
+	for(size_t i = 0; i < materials->items.size(); ++i)
+	{
+		const JsonValue& entry = materials->items[i];
+		if(entry.type != JsonValue::Type::Object) {
+			error = "Material #" + std::to_string(i + 1) + " is not an object";
+			return false;
+		}
+
+		auto getString = [&] (const char* key) {
+			const JsonValue* value = entry.Find(key);
+			return value && value->type == JsonValue::Type::String ? value->text : std::string();
+		};
+		auto getOutput = [&] (const char* key, std::string& target, bool& enabled) {
+			target.clear();
+			const JsonValue* value = entry.Find(key);
+			if(value && value->type == JsonValue::Type::Bool)
+				enabled = value->boolean;
+			else if(value && value->type == JsonValue::Type::String)
+				target = Resolve(outDir, value->text);
+		};
+
+		ORMJob job;
+		job.name = getString("name");
+		if(job.name.empty())
+			job.name = "material_" + std::to_string(i + 1);
+		job.aoPath = getString("ao").empty() ? std::string() : Resolve(base, getString("ao"));
+		job.roughnessPath = getString("roughness").empty() ? std::string() : Resolve(base, getString("roughness"));
+		job.metallicPath = getString("metallic").empty() ? std::string() : Resolve(base, getString("metallic"));
+		getOutput("unreal", job.unrealPath, job.generateUnreal);
+		getOutput("unity", job.unityPath, job.generateUnity);
+
+		if(!ValidateJob(job, i, error))
+			return false;
+		ApplyDefaultOutputs(job, outDir);
+		jobs.push_back(std::move(job));
+	}
+	return CheckUniqueOutputs(jobs, error);
+}
+
+[[nodiscard]] bool BatchManifest::LoadCSV(const std::string& path, const std::string& outputDir, std::vector<ORMJob>& jobs, std::string& error)
+{
+	std::string contents;
+	if(!ReadFile(path, contents, error))
+		return false;
+
+	std::istringstream lines(contents);
+	std::string line;
+	std::map<std::string, size_t> columns;
+	const fs::path base = fs::path(path).parent_path();
+	const std::string outDir = DefaultOutputDir(path, outputDir);
+
+	size_t index = 0;
+	while(std::getline(lines, line))
+	{
+		line = Trim(line);
+		if(line.empty() || line[0] == '#')
+			continue;
+
+		const std::vector<std::string> cells = SplitCSVLine(line);
+		if(columns.empty()) {
+			for(size_t c = 0; c < cells.size(); ++c)
+				columns[ToLower(cells[c])] = c;
+			if(!columns.count("ao") || !columns.count("roughness") || !columns.count("metallic")) {
+				error = "CSV header must name the ao, roughness and metallic columns";
+				return false;
+			}
+			continue;
+		}
+
+		auto cell = [&] (const char* name) {
+			const auto it = columns.find(name);
+			return it != columns.end() && it->second < cells.size() ? cells[it->second] : std::string();
+		};
+
+		ORMJob job;
+		job.name = cell("name").empty() ? "material_" + std::to_string(index + 1) : cell("name");
+		job.aoPath = cell("ao").empty() ? std::string() : Resolve(base, cell("ao"));
+		job.roughnessPath = cell("roughness").empty() ? std::string() : Resolve(base, cell("roughness"));
+		job.metallicPath = cell("metallic").empty() ? std::string() : Resolve(base, cell("metallic"));
+
+		// A present-but-empty output column disables that output for the row.
+		job.unrealPath = cell("unreal").empty() ? std::string() : Resolve(outDir, cell("unreal"));
+		job.unityPath = cell("unity").empty() ? std::string() : Resolve(outDir, cell("unity"));
+		if(columns.count("unreal") && job.unrealPath.empty()) job.generateUnreal = false;
+		if(columns.count("unity") && job.unityPath.empty()) job.generateUnity = false;
+
+		if(!ValidateJob(job, index, error))
+			return false;
+		ApplyDefaultOutputs(job, outDir);
+		jobs.push_back(std::move(job));
+		++index;
+	}
+
+	if(columns.empty()) {
+		error = "CSV manifest is empty: " + path;
+		return false;
+	}
+	return CheckUniqueOutputs(jobs, error);
+}
+
+[[nodiscard]] bool BatchManifest::ScanDirectory(const std::string& directory, const std::string& outputDir, std::vector<ORMJob>& jobs, std::string& error)
+{
+	static const char* const aoSuffixes[] = { "_ao", "_occlusion", "_ambientocclusion" };
+	static const char* const roughSuffixes[] = { "_roughness", "_rough" };
+	static const char* const metalSuffixes[] = { "_metallic", "_metalness", "_metal" };
+	static const char* const extensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".hdr", ".exr", ".ormraw" };
+
+	std::error_code ec;
+	if(!fs::is_directory(directory, ec)) {
+		error = "Not a directory: " + directory;
+		return false;
+	}
+
+	struct Triplet { std::string ao, roughness, metallic; };
+	std::map<std::string, Triplet> materials;
+
+	auto matchSuffix = [] (const std::string& lowerStem, const auto& suffixes) -> size_t {
+		for(const char* suffix : suffixes) {
+			const std::string s = suffix;
+			if(lowerStem.size() > s.size() && lowerStem.compare(lowerStem.size() - s.size(), s.size(), s) == 0)
+				return s.size();
+		}
+		return 0;
+	};
+
+	for(const fs::directory_entry& entry : fs::directory_iterator(directory, ec))
+	{
+		if(!entry.is_regular_file())
+			continue;
+
+		const std::string extension = ToLower(entry.path().extension().string());
+		if(std::find(std::begin(extensions), std::end(extensions), extension) == std::end(extensions))
+			continue;
+
+		const std::string stem = entry.path().stem().string();
+		const std::string lowerStem = ToLower(stem);
+		const std::string file = entry.path().string();
+
+		if(size_t n = matchSuffix(lowerStem, aoSuffixes)) materials[stem.substr(0, stem.size() - n)].ao = file;
+		else if(size_t n = matchSuffix(lowerStem, roughSuffixes)) materials[stem.substr(0, stem.size() - n)].roughness = file;
+		else if(size_t n = matchSuffix(lowerStem, metalSuffixes)) materials[stem.substr(0, stem.size() - n)].metallic = file;
+	}
+	if(ec) {
+		error = "Cannot read directory " + directory + ": " + ec.message();
+		return false;
+	}
+
+	const std::string outDir = outputDir.empty() ? directory : outputDir;
+	for(const auto& [name, triplet] : materials)
+	{
+		if(triplet.ao.empty() || triplet.roughness.empty() || triplet.metallic.empty()) {
+			std::cerr << "Skipping incomplete material '" << name << "' in " << directory << "\n";
+			continue;
+		}
+
+		ORMJob job;
+		job.name = name;
+		job.aoPath = triplet.ao;
+		job.roughnessPath = triplet.roughness;
+		job.metallicPath = triplet.metallic;
+		job.unrealPath.clear();
+		job.unityPath.clear();
+		ApplyDefaultOutputs(job, outDir);
+		jobs.push_back(std::move(job));
+	}
+
+	if(jobs.empty()) {
+		error = "No complete *_AO / *_Roughness / *_Metallic sets found in " + directory;
+		return false;
+	}
+	return CheckUniqueOutputs(jobs, error);
+}
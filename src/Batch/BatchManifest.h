@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "ORMGenerator.h"
+
+/**
+ * Class: BatchManifest
+ *
+ * Builds the list of materials for a batch run from one of three sources:
+ *
+ *   JSON  - { "materials": [ { "name": "Rock", "ao": "Rock_AO.png", "roughness": "...",
+ *            "metallic": "...", "unreal": "Rock_ORM.png", "unity": "Rock_Mask.png" } ] }
+ *           (a top-level array of material objects is accepted as well)
+ *   CSV   - header row naming the columns name,ao,roughness,metallic[,unreal][,unity]
+ *   Directory - every <Name>_AO / _Roughness / _Metallic triplet found in a folder
+ *
+ * Notes:
+ * - Relative source paths are resolved against the manifest's own directory.
+ * - Outputs not given explicitly default to <outputDir>/<Name>_ORM_Unreal.png and
+ *   <outputDir>/<Name>_ORM_Unity.png; outputDir defaults to the manifest directory.
+ * - "unreal": false / "unity": false (JSON) or an empty cell (CSV) skips that output.
+ * - Loading fails when two outputs resolve to the same file.
+ */
+class BatchManifest
+{
+public:
+	/** Picks the JSON or CSV reader from the file extension. */
+	[[nodiscard]] static bool Load(const std::string& path, const std::string& outputDir, std::vector<ORMJob>& jobs, std::string& error);
+
+	[[nodiscard]] static bool LoadJSON(const std::string& path, const std::string& outputDir, std::vector<ORMJob>& jobs, std::string& error);
+	[[nodiscard]] static bool LoadCSV(const std::string& path, const std::string& outputDir, std::vector<ORMJob>& jobs, std::string& error);
+	[[nodiscard]] static bool ScanDirectory(const std::string& directory, const std::string& outputDir, std::vector<ORMJob>& jobs, std::string& error);
+};
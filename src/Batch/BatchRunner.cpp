@@ -0,0 +1,353 @@
+#include "BatchRunner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "Constants.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	enum Stage
+	{
+		Decode,
+		Prepare,
+		Encode,
+		StageCount
+	};
+
+	constexpr const char* StageNames[StageCount] = { "decode", "prepare", "encode" };
+
+	// One material travelling through decode -> prepare -> encode.
+	struct MaterialTask
+	{
+		size_t index = 0;
+		Clock::time_point start;
+		ORMSources sources;
+		int width = 0;
+		int height = 0;
+		std::vector<ORMLevelReport> levels;
+		std::atomic<int> pendingDecodes{ 3 };
+		std::atomic<bool> decodeStarted{ false };
+
+		std::mutex errorMutex;
+		ORMResult error;
+
+		void Fail(ORMResult result)
+		{
+			std::lock_guard<std::mutex> lock(errorMutex);
+			if(error.Succeeded())
+				error = std::move(result);
+		}
+	};
+
+	/** Integrates queue depth and stage occupancy over time; the caller serializes access. */
+	class PipelineMeter
+	{
+	public:
+		explicit PipelineMeter(Clock::time_point start) : start(start), last(start) {}
+
+		void Queue(Stage stage)
+		{
+			Advance();
+			StageState& state = stages[stage];
+			state.maxQueued = std::max(state.maxQueued, ++state.queued);
+		}
+
+		void Start(Stage stage)
+		{
+			Advance();
+			--stages[stage].queued;
+			++stages[stage].active;
+		}
+
+		void Finish(Stage stage)
+		{
+			Advance();
+			--stages[stage].active;
+		}
+
+		std::vector<BatchStageReport> GetReports()
+		{
+			Advance();
+			const double total = std::max(std::chrono::duration<double>(last - start).count(), 1e-9);
+			std::vector<BatchStageReport> reports(StageCount);
+			for(int stage = 0; stage < StageCount; ++stage) {
+				const StageState& state = stages[stage];
+				reports[stage].name = StageNames[stage];
+				reports[stage].busyFraction = state.busySeconds / total;
+				reports[stage].averageActive = state.activeArea / total;
+				reports[stage].averageQueued = state.queuedArea / total;
+				reports[stage].maxQueued = state.maxQueued;
+			}
+			return reports;
+		}
+
+	private:
+		struct StageState
+		{
+			size_t queued = 0;
+			size_t active = 0;
+			size_t maxQueued = 0;
+			double queuedArea = 0.0;
+			double activeArea = 0.0;
+			double busySeconds = 0.0;
+		};
+
+		void Advance()
+		{
+			const Clock::time_point now = Clock::now();
+			const double seconds = std::chrono::duration<double>(now - last).count();
+			for(StageState& state : stages) {
+				state.queuedArea += state.queued * seconds;
+				state.activeArea += state.active * seconds;
+				if(state.active)
+					state.busySeconds += seconds;
+			}
+			last = now;
+		}
+
+		Clock::time_point start;
+		Clock::time_point last;
+		StageState stages[StageCount];
+	};
+
+	// State of one Run() call. Owned jointly by Run() and every queued task, so a
+	// continuation finishing after Run() has returned never touches freed memory.
+	class BatchExecution : public std::enable_shared_from_this<BatchExecution>
+	{
+	public:
+		BatchExecution(ThreadPool& pool, const ORMGenerator& generator, const std::vector<ORMJob>& jobs, BatchRunner::FinishedFn onFinished)
+			: pool(pool), generator(generator), jobs(jobs), onFinished(std::move(onFinished)), items(jobs.size()), meter(Clock::now())
+		{
+		}
+
+		void StartNext()
+		{
+			size_t index;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if(nextJob >= jobs.size())
+					return;
+				index = nextJob++;
+				meter.Queue(Decode);
+			}
+
+			auto task = std::make_shared<MaterialTask>();
+			task->index = index;
+			task->start = Clock::now();
+
+			const ORMJob& job = jobs[index];
+			const std::pair<const std::string*, GrayscalePlane*> decodes[] = {
+				{ &job.aoPath, &task->sources.ao },
+				{ &job.roughnessPath, &task->sources.roughness },
+				{ &job.metallicPath, &task->sources.metallic }
+			};
+
+			auto self = shared_from_this();
+			for(const auto& decode : decodes)
+			{
+				const std::string* path = decode.first;
+				GrayscalePlane* plane = decode.second;
+				pool.Submit([self, task, path, plane] {
+					if(!task->decodeStarted.exchange(true)) {
+						std::lock_guard<std::mutex> lock(self->mutex);
+						self->meter.Start(Decode);
+					}
+
+					ORMResult loaded = self->generator.LoadSource(*path, *plane);
+					if(!loaded.Succeeded())
+						task->Fail(std::move(loaded));
+					if(task->pendingDecodes.fetch_sub(1) != 1)
+						return;
+
+					{
+						std::lock_guard<std::mutex> lock(self->mutex);
+						self->meter.Finish(Decode);
+					}
+					if(task->error.Succeeded())
+						self->Enter(Prepare, task);
+					else
+						self->Finish(task);
+				});
+			}
+		}
+
+		void Wait()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			allDone.wait(lock, [this] { return finished == jobs.size(); });
+		}
+
+		std::vector<BatchItemResult> TakeItems()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return std::move(items);
+		}
+
+		std::vector<BatchStageReport> GetStageReports()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return meter.GetReports();
+		}
+
+	private:
+		// Starts the stage at once when it has a free slot, otherwise queues the material behind the others.
+		void Enter(Stage stage, const std::shared_ptr<MaterialTask>& task)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				meter.Queue(stage);
+				if(busySlots[stage] >= ORM::BatchStageSlots) {
+					waiting[stage].push_back(task);
+					return;
+				}
+				++busySlots[stage];
+				meter.Start(stage);
+			}
+			Run(stage, task);
+		}
+
+		void Run(Stage stage, const std::shared_ptr<MaterialTask>& task)
+		{
+			auto self = shared_from_this();
+			pool.Submit([self, stage, task] {
+				if(stage == Prepare)
+					self->RunPrepare(task);
+				else
+					self->RunEncode(task);
+			});
+		}
+
+		// Hands the slot to the next queued material, if any.
+		void Leave(Stage stage)
+		{
+			std::shared_ptr<MaterialTask> next;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				meter.Finish(stage);
+				if(waiting[stage].empty()) {
+					--busySlots[stage];
+					return;
+				}
+				next = std::move(waiting[stage].front());
+				waiting[stage].pop_front();
+				meter.Start(stage);
+			}
+			Run(stage, next);
+		}
+
+		void RunPrepare(const std::shared_ptr<MaterialTask>& task)
+		{
+			task->error = generator.ResampleSources(task->sources, jobs[task->index]);
+			if(task->error.Succeeded())
+				task->error = ORMGenerator::ValidateSources(task->sources);
+			Leave(Prepare);
+
+			if(task->error.Succeeded())
+				Enter(Encode, task);
+			else
+				Finish(task);
+		}
+
+		// Strips fan out to the pool from here.
+		void RunEncode(const std::shared_ptr<MaterialTask>& task)
+		{
+			task->width = task->sources.ao.width;
+			task->height = task->sources.ao.height;
+			ORMResult written = generator.WriteOutputs(task->sources, jobs[task->index]);
+			if(written.Succeeded())
+				task->levels = std::move(written.levels);
+			else
+				task->Fail(std::move(written));
+			Leave(Encode);
+			Finish(task);
+		}
+
+		void Finish(const std::shared_ptr<MaterialTask>& task)
+		{
+			BatchItemResult item;
+			item.name = jobs[task->index].name;
+			item.status = task->error.status;
+			item.message = task->error.message;
+			item.width = task->width;
+			item.height = task->height;
+			item.levels = std::move(task->levels);
+			item.milliseconds = MillisecondsSince(task->start);
+
+			task->sources = ORMSources();
+
+			// Admit the next material before reporting, so the pool never idles on the callback.
+			StartNext();
+
+			std::lock_guard<std::mutex> lock(mutex);
+			items[task->index] = item;
+			++finished;
+			if(onFinished)
+				onFinished(item, finished, jobs.size());
+			if(finished == jobs.size())
+				allDone.notify_all();
+		}
+
+		ThreadPool& pool;
+		const ORMGenerator& generator;
+		const std::vector<ORMJob> jobs;
+		const BatchRunner::FinishedFn onFinished;
+
+		std::mutex mutex;
+		std::condition_variable allDone;
+		std::vector<BatchItemResult> items;
+		size_t nextJob = 0;
+		size_t finished = 0;
+
+		PipelineMeter meter;
+		size_t busySlots[StageCount] = {};
+		std::deque<std::shared_ptr<MaterialTask>> waiting[StageCount];
+	};
+}
+
+size_t BatchReport::GetFailedCount() const
+{
+	return static_cast<size_t>(std::count_if(items.begin(), items.end(),
+		[] (const BatchItemResult& item) { return item.status != GenerateStatus::Success; }));
+}
+
+BatchRunner::BatchRunner(ThreadPool& pool, size_t maxInFlight, DecodeCache* cache)
+	: pool(pool), generator(pool, cache), maxInFlight(maxInFlight ? maxInFlight : pool.GetThreadCount() * 2)
+{
+}
+
+BatchReport BatchRunner::Run(const std::vector<ORMJob>& jobs, const FinishedFn& onFinished)
+{
+	BatchReport report;
+	if(jobs.empty())
+		return report;
+
+	const auto batchStart = Clock::now();
+	const size_t stealsBefore = pool.GetStealCount();
+
+	auto execution = std::make_shared<BatchExecution>(pool, generator, jobs, onFinished);
+	const size_t initial = std::min(maxInFlight, jobs.size());
+	for(size_t i = 0; i < initial; ++i)
+		execution->StartNext();
+
+	execution->Wait();
+
+	report.items = execution->TakeItems();
+	report.stages = execution->GetStageReports();
+	report.milliseconds = MillisecondsSince(batchStart);
+	report.steals = pool.GetStealCount() - stealsBefore;
+	return report;
+}
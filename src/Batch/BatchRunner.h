@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ORMGenerator.h"
+
+class ThreadPool;
+
+struct BatchItemResult
+{
+	std::string name;
+	GenerateStatus status = GenerateStatus::Success;
+	std::string message;
+	int width = 0;
+	int height = 0;
+	std::vector<ORMLevelReport> levels;
+	double milliseconds = 0.0;
+};
+
+/** Time-weighted view of one pipeline stage over a whole Run(). */
+struct BatchStageReport
+{
+	std::string name;
+	double busyFraction = 0.0;   // share of the batch's wall time with at least one material in the stage
+	double averageActive = 0.0;  // materials inside the stage, averaged over the batch
+	double averageQueued = 0.0;  // materials waiting to enter the stage, averaged over the batch
+	size_t maxQueued = 0;
+};
+
+struct BatchReport
+{
+	std::vector<BatchItemResult> items;
+	std::vector<BatchStageReport> stages;  // decode, prepare, encode
+	double milliseconds = 0.0;
+	size_t steals = 0;
+
+	size_t GetFailedCount() const;
+};
+
+/**
+ * Class: BatchRunner
+ *
+ * Packs many materials on a work-stealing ThreadPool as a three-stage pipeline:
+ * decode (the three sources, as parallel tasks), prepare (resample and
+ * validate) and encode (the streamed pack + PNG / DDS / KTX2 write, whose strips
+ * fan out across the pool). While material N encodes, N+1 is prepared and the
+ * ones after it decode, so no stage waits for a whole material to finish.
+ *
+ * Notes:
+ * - At most maxInFlight materials are admitted at once (default: 2x threads),
+ *   which bounds the queues between the stages and peak memory for large batches.
+ * - Prepare and encode run at most ORM::BatchStageSlots materials each; the rest
+ *   wait in a FIFO queue. Decodes are limited only by admission.
+ * - Packing is not a stage of its own: it happens strip by strip inside the
+ *   encoder, so no full-size packed image ever exists to hand over.
+ * - The report's per-stage occupancy and queue depths show the bottleneck: a
+ *   busy stage with a long queue in front of it.
+ * - onFinished is called once per material, serialized, from a worker thread.
+ * - With a DecodeCache, textures shared between materials (common masks,
+ *   flat black metallic maps) are decoded once for the whole batch.
+ */
+class BatchRunner
+{
+public:
+	using FinishedFn = std::function<void(const BatchItemResult&, size_t finished, size_t total)>;
+
+	explicit BatchRunner(ThreadPool& pool, size_t maxInFlight = 0, DecodeCache* cache = nullptr);
+
+	BatchReport Run(const std::vector<ORMJob>& jobs, const FinishedFn& onFinished = nullptr);
+
+private:
+	ThreadPool& pool;
+	ORMGenerator generator;
+	size_t maxInFlight;
+};
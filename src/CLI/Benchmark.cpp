@@ -0,0 +1,272 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "BufferPool.h"
+#include "ChannelKernels.h"
+#include "CommandLine.h"
+#include "ORMGenerator.h"
+#include "ORMPacker.h"
+#include "PngWriter.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	constexpr int Iterations = 5;
+
+	std::vector<unsigned char> MakePlane(int size, uint32_t seed)
+	{
+		std::vector<unsigned char> plane(static_cast<size_t>(size) * size);
+		uint32_t state = seed;
+		for(unsigned char& value : plane) {
+			state = state * 1664525u + 1013904223u;
+			value = static_cast<unsigned char>(state >> 24);
+		}
+		return plane;
+	}
+
+	// Smooth gradients with mild grain: closer to real material maps than white noise, which no codec handles well.
+	std::vector<unsigned char> MakeMaterialPlane(int size, uint32_t seed)
+	{
+		std::vector<unsigned char> plane = MakePlane(size, seed);
+		const double frequency = 6.2831853 * (2 + seed) / size;
+		for(int y = 0; y < size; ++y) {
+			for(int x = 0; x < size; ++x) {
+				unsigned char& value = plane[static_cast<size_t>(y) * size + x];
+				const double wave = std::sin(x * frequency + seed) * std::cos(y * frequency * 0.7);
+				value = static_cast<unsigned char>(std::clamp(128.0 + 100.0 * wave + (value - 128) / 16, 0.0, 255.0));
+			}
+		}
+		return plane;
+	}
+
+	/** PSNR in dB over the first channels of two interleaved images; the original may have fewer channels than the decoded one. */
+	double GetPsnr(const unsigned char* original, int originalChannels, const unsigned char* decoded, int decodedChannels,
+		size_t pixels, int channels)
+	{
+		double squared = 0.0;
+		for(size_t i = 0; i < pixels; ++i) {
+			for(int c = 0; c < channels; ++c) {
+				const double d = static_cast<double>(original[i * originalChannels + c]) - decoded[i * decodedChannels + c];
+				squared += d * d;
+			}
+		}
+		const double mse = squared / (static_cast<double>(pixels) * channels);
+		return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+	}
+
+	double MillisecondsOf(const std::function<void()>& fn)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		fn();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	std::vector<unsigned int> ThreadCounts(unsigned int maxThreads)
+	{
+		std::vector<unsigned int> counts;
+		for(unsigned int t = 1; t < maxThreads; t *= 2)
+			counts.push_back(t);
+		counts.push_back(maxThreads);
+		return counts;
+	}
+
+	template<typename Fn>
+	double BestOf(Fn&& fn)
+	{
+		fn();
+		double best = 1e30;
+		for(int i = 0; i < Iterations; ++i) {
+			const auto start = std::chrono::steady_clock::now();
+			fn();
+			const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			best = std::min(best, ms);
+		}
+		return best;
+	}
+}
+
+bool Benchmark::Run(const CommandLineOptions& options, std::ostream& out)
+{
+	const int size = options.benchmarkSize;
+	const unsigned int maxThreads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+	const double megapixels = static_cast<double>(size) * size / 1.0e6;
+
+	const std::vector<unsigned char> ao = MakePlane(size, 1);
+	const std::vector<unsigned char> rough = MakePlane(size, 2);
+	const std::vector<unsigned char> metal = MakePlane(size, 3);
+	std::vector<unsigned char> rgb(static_cast<size_t>(size) * size * 3);
+	std::vector<unsigned char> rgba(static_cast<size_t>(size) * size * 4);
+
+	const ORMPackSource source{ ao.data(), rough.data(), metal.data(), size, size };
+	ORMPackTargets targets;
+	targets.unrealRGB = rgb.data();
+	targets.unityRGBA = rgba.data();
+
+	out << "Packing benchmark: " << size << "x" << size << ", Unreal + Unity, "
+		<< ChannelKernels::GetSimdLevelName(ChannelKernels::GetSimdLevel()) << " kernels, best of " << Iterations << "\n";
+	out << std::setw(8) << "threads" << std::setw(12) << "ms" << std::setw(12) << "MPix/s"
+		<< std::setw(10) << "speedup" << std::setw(12) << "efficiency" << "\n";
+
+	double singleThreadMs = 0.0;
+	for(unsigned int threads : ThreadCounts(maxThreads))
+	{
+		ThreadPool pool(threads);
+		ORMPacker packer(pool);
+		const double ms = BestOf([&] { packer.Pack(source, targets); });
+		if(threads == 1)
+			singleThreadMs = ms;
+
+		const double speedup = singleThreadMs / ms;
+		out << std::fixed << std::setprecision(2)
+			<< std::setw(8) << threads << std::setw(12) << ms << std::setw(12) << megapixels / (ms / 1000.0)
+			<< std::setw(10) << speedup << std::setw(11) << speedup / threads * 100.0 << "%\n";
+	}
+
+	return RunStreamingEncode(options, ao, rough, metal, out) && RunBlockCompression(options, out);
+}
+
+bool Benchmark::RunStreamingEncode(const CommandLineOptions& options, const std::vector<unsigned char>& ao,
+	const std::vector<unsigned char>& rough, const std::vector<unsigned char>& metal, std::ostream& out)
+{
+	const int size = options.benchmarkSize;
+	auto borrow = [size] (const std::vector<unsigned char>& plane) {
+		GrayscalePlane view;
+		view.pixels = std::shared_ptr<unsigned char>(const_cast<unsigned char*>(plane.data()), [] (unsigned char*) {});
+		view.width = size;
+		view.height = size;
+		return view;
+	};
+
+	ORMSources sources;
+	sources.ao = borrow(ao);
+	sources.roughness = borrow(rough);
+	sources.metallic = borrow(metal);
+
+	std::error_code ec;
+	const std::filesystem::path directory = std::filesystem::temp_directory_path(ec);
+	ORMJob job = options.job;
+	job.unrealPath = (directory / "ormtool_benchmark_unreal.png").string();
+	job.unityPath = (directory / "ormtool_benchmark_unity.png").string();
+	job.generateUnreal = true;
+	job.generateUnity = true;
+
+	ThreadPool pool(options.threads);
+	ORMGenerator generator(pool);
+	PngStreamStats stats;
+
+	// A second pass reuses the first one's strip buffers from the pool.
+	double coldMs = 0.0;
+	double ms = 0.0;
+	ORMResult result;
+	for(double* elapsed : { &coldMs, &ms }) {
+		const auto start = std::chrono::steady_clock::now();
+		result = generator.WriteOutputs(sources, job, nullptr, &stats);
+		*elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if(!result.Succeeded())
+			break;
+	}
+	const BufferPoolStats poolStats = BufferPool::GetStats();
+
+	std::filesystem::remove(job.unrealPath, ec);
+	std::filesystem::remove(job.unityPath, ec);
+
+	if(!result.Succeeded()) {
+		out << "Streaming encode failed: " << result.message << "\n";
+		return false;
+	}
+
+	const double mib = 1024.0 * 1024.0;
+	const double fullBuffers = static_cast<double>(size) * size * 7;
+	out << "\nStreaming pack + PNG encode (level " << job.pngCompressionLevel << ", " << pool.GetThreadCount() << " threads): "
+		<< std::fixed << std::setprecision(2) << ms << " ms (first run " << coldMs << " ms), " << stats.stripCount << " strips\n"
+		<< "  peak strip buffers " << stats.peakBufferBytes / mib << " MiB"
+		<< " (full Unreal + Unity buffers would be " << fullBuffers / mib << " MiB)\n"
+		<< "  buffer pool: " << poolStats.hits << " reused, " << poolStats.misses << " new, peak " << poolStats.peakBytes / mib << " MiB in use\n";
+	return true;
+}
+
+bool Benchmark::RunBlockCompression(const CommandLineOptions& options, std::ostream& out)
+{
+	const int size = options.benchmarkSize;
+	const size_t pixels = static_cast<size_t>(size) * size;
+	const double megapixels = pixels / 1.0e6;
+	const double mib = 1024.0 * 1024.0;
+
+	const std::vector<unsigned char> ao = MakeMaterialPlane(size, 1);
+	const std::vector<unsigned char> rough = MakeMaterialPlane(size, 2);
+	const std::vector<unsigned char> metal = MakeMaterialPlane(size, 3);
+
+	ThreadPool pool(options.threads);
+	ORMPacker packer(pool);
+	std::vector<unsigned char> unreal(pixels * 3);
+	std::vector<unsigned char> roughMetal(pixels * 2);
+	packer.Pack(ORMPackSource{ ao.data(), rough.data(), metal.data(), size, size }, ORMLayout::Unreal_RGB, unreal.data());
+	for(size_t i = 0; i < pixels; ++i) {
+		roughMetal[i * 2] = rough[i];
+		roughMetal[i * 2 + 1] = metal[i];
+	}
+
+	out << "\nBlock compression vs PNG (" << size << "x" << size << " material-like image, " << pool.GetThreadCount()
+		<< " threads, single run)\n";
+	out << std::setw(14) << "encoder" << std::setw(12) << "ms" << std::setw(12) << "MPix/s"
+		<< std::setw(12) << "MiB" << std::setw(12) << "PSNR dB" << "\n";
+	auto report = [&] (const std::string& name, double ms, double bytes, double psnr) {
+		out << std::fixed << std::setprecision(2) << std::setw(14) << name << std::setw(12) << ms
+			<< std::setw(12) << megapixels / (ms / 1000.0) << std::setw(12) << bytes / mib;
+		if(psnr < 0.0)
+			out << std::setw(12) << "lossless" << "\n";
+		else
+			out << std::setw(12) << psnr << "\n";
+	};
+
+	std::error_code ec;
+	const std::string pngPath = (std::filesystem::temp_directory_path(ec) / "ormtool_benchmark_bc.png").string();
+	PngWriteOptions pngOptions;
+	pngOptions.compressionLevel = options.job.pngCompressionLevel;
+	const PngWriter pngWriter(pool);
+	bool written = false;
+	const double pngMs = MillisecondsOf([&] { written = pngWriter.Write(pngPath, size, size, 3, unreal.data(), pngOptions); });
+	const double pngBytes = static_cast<double>(std::filesystem::file_size(pngPath, ec));
+	std::filesystem::remove(pngPath, ec);
+	if(!written) {
+		out << "PNG encode failed: " << pngPath << "\n";
+		return false;
+	}
+	report("PNG RGB", pngMs, pngBytes, -1.0);
+
+	const BlockCompressor compressor(pool);
+	const BlockQuality qualities[] = { BlockQuality::Fast, BlockQuality::Normal, BlockQuality::High };
+	struct Case { BlockFormat format; const unsigned char* pixels; int channels; const char* label; };
+	const Case cases[] = {
+		{ BlockFormat::BC7, unreal.data(), 3, "BC7 RGB" },
+		{ BlockFormat::BC5, roughMetal.data(), 2, "BC5 RM" },
+		{ BlockFormat::BC4, ao.data(), 1, "BC4 AO" }
+	};
+
+	for(const Case& test : cases) {
+		const int decodedChannels = BlockCompressor::GetDecodedChannels(test.format);
+		std::vector<unsigned char> decoded(pixels * decodedChannels);
+		for(BlockQuality quality : qualities) {
+			std::vector<unsigned char> blocks;
+			const double ms = MillisecondsOf([&] {
+				blocks = compressor.Compress(test.pixels, size, size, test.channels, test.format, quality);
+			});
+			BlockCompressor::Decompress(blocks.data(), size, size, test.format, decoded.data());
+			const double psnr = GetPsnr(test.pixels, test.channels, decoded.data(), decodedChannels, pixels, test.channels);
+			report(std::string(test.label) + " " + std::string(BlockCompressor::GetQualityName(quality)), ms,
+				static_cast<double>(blocks.size()), psnr);
+		}
+	}
+	return true;
+}
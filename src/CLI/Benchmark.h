@@ -0,0 +1,26 @@
+#pragma once
+#include <ostream>
+#include <vector>
+
+struct CommandLineOptions;
+
+/**
+ * Class: Benchmark
+ *
+ * Synthetic throughput benchmark for the headless build. Packs a generated
+ * size x size material at increasing thread counts and reports time,
+ * megapixels per second and speedup relative to a single thread, then streams
+ * the same material through pack + PNG encode and reports the peak memory held
+ * by strip buffers. Finally a smoother, material-like image is encoded as PNG
+ * and as BC7 / BC5 / BC4 at every quality preset, reporting time, size and PSNR.
+ */
+class Benchmark
+{
+public:
+	static bool Run(const CommandLineOptions& options, std::ostream& out);
+
+private:
+	static bool RunStreamingEncode(const CommandLineOptions& options, const std::vector<unsigned char>& ao,
+		const std::vector<unsigned char>& rough, const std::vector<unsigned char>& metal, std::ostream& out);
+	static bool RunBlockCompression(const CommandLineOptions& options, std::ostream& out);
+};
@@ -0,0 +1,413 @@
+#include "CommandLine.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+#include "BatchManifest.h"
+#include "BatchRunner.h"
+#include "Benchmark.h"
+#include "BufferPool.h"
+#include "DecodeCache.h"
+#include "Constants.h"
+#include "Ktx2Writer.h"
+#include "RawImage.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// Per-level timings of a resolution ladder; nothing for a single output size.
+	void PrintLevels(std::ostream& out, const std::vector<ORMLevelReport>& levels)
+	{
+		if(levels.size() < 2)
+			return;
+		for(const ORMLevelReport& level : levels) {
+			out << "    " << level.width << "x" << level.height << ": ";
+			if(level.downsampleMilliseconds > 0.0)
+				out << "downsample " << level.downsampleMilliseconds << " ms, ";
+			out << "encode " << level.encodeMilliseconds << " ms\n";
+		}
+	}
+
+	// Two decimals are plenty for the pipeline averages.
+	double Round(double value)
+	{
+		return std::round(value * 100.0) / 100.0;
+	}
+
+	void UseRawOutputs(ORMJob& job)
+	{
+		job.unrealPath = std::filesystem::path(job.unrealPath).replace_extension(RawImage::Extension).string();
+		job.unityPath = std::filesystem::path(job.unityPath).replace_extension(RawImage::Extension).string();
+	}
+
+	bool ParseInt(const std::string& text, int minValue, int& out)
+	{
+		char* end = nullptr;
+		const long value = std::strtol(text.c_str(), &end, 10);
+		if(end == text.c_str() || *end != '\0' || value < minValue || value > 1 << 20)
+			return false;
+		out = static_cast<int>(value);
+		return true;
+	}
+}
+
+bool CommandLine::IsHeadlessInvocation(int argc, char** argv)
+{
+	return argc > 1 && argv != nullptr;
+}
+
+int CommandLine::Run(int argc, char** argv)
+{
+	CommandLineOptions options;
+	std::string error;
+	if(!Parse(argc, argv, options, error)) {
+		std::cerr << ORM::TitleStr << ": " << error << "\n\n";
+		PrintUsage(std::cerr);
+		return static_cast<int>(ExitCode::InvalidArguments);
+	}
+
+	if(options.showHelp) {
+		PrintUsage(std::cout);
+		return static_cast<int>(ExitCode::Success);
+	}
+
+	if(options.benchmark)
+		return Benchmark::Run(options, std::cout) ? static_cast<int>(ExitCode::Success) : static_cast<int>(ExitCode::GenerationFailed);
+
+	if(!options.manifestPath.empty() || !options.scanDirectory.empty())
+		return RunBatch(options);
+
+	ORMJob job = options.job;
+	if(options.rawOutputs)
+		UseRawOutputs(job);
+
+	ThreadPool pool(options.threads);
+	ORMGenerator generator(pool);
+
+	const auto start = std::chrono::steady_clock::now();
+	const ORMResult result = generator.Generate(job);
+	const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if(!result.Succeeded()) {
+		std::cerr << ORM::TitleStr << ": " << ORMGenerator::GetStatusString(result.status) << ": " << result.message << "\n";
+		return static_cast<int>(ExitCode::GenerationFailed);
+	}
+
+	if(!options.quiet) {
+		std::cout << "Packed " << result.width << "x" << result.height << " in " << elapsed << " ms\n";
+		if(job.generateUnreal) std::cout << "  Unreal: " << job.unrealPath << "\n";
+		if(job.generateUnity) std::cout << "  Unity:  " << job.unityPath << "\n";
+		PrintLevels(std::cout, result.levels);
+	}
+	return static_cast<int>(ExitCode::Success);
+}
+
+int CommandLine::RunBatch(const CommandLineOptions& options)
+{
+	std::vector<ORMJob> jobs;
+	std::string error;
+	const bool loaded = options.manifestPath.empty()
+		? BatchManifest::ScanDirectory(options.scanDirectory, options.outputDir, jobs, error)
+		: BatchManifest::Load(options.manifestPath, options.outputDir, jobs, error);
+	if(!loaded) {
+		std::cerr << ORM::TitleStr << ": " << error << "\n";
+		return static_cast<int>(ExitCode::InvalidArguments);
+	}
+
+	for(ORMJob& job : jobs) {
+		job.pngCompressionLevel = options.job.pngCompressionLevel;
+		job.outputSize = options.job.outputSize;
+		job.ladderLevels = options.job.ladderLevels;
+		job.blockFormat = options.job.blockFormat;
+		job.blockQuality = options.job.blockQuality;
+		job.generateKtx2 = options.job.generateKtx2;
+		job.ktx2Format = options.job.ktx2Format;
+		job.ktx2ZstdLevel = options.job.ktx2ZstdLevel;
+		job.outputBitDepth = options.job.outputBitDepth;
+		job.quantize = options.job.quantize;
+		if(options.rawOutputs)
+			UseRawOutputs(job);
+	}
+
+	if(!options.outputDir.empty()) {
+		std::error_code ec;
+		std::filesystem::create_directories(options.outputDir, ec);
+		if(ec) {
+			std::cerr << ORM::TitleStr << ": cannot create " << options.outputDir << ": " << ec.message() << "\n";
+			return static_cast<int>(ExitCode::GenerationFailed);
+		}
+	}
+
+	ThreadPool pool(options.threads);
+	DecodeCache cache(options.cacheBytes);
+	BatchRunner runner(pool, 0, options.cacheBytes ? &cache : nullptr);
+
+	if(!options.quiet)
+		std::cout << "Packing " << jobs.size() << " materials on " << pool.GetThreadCount() << " threads\n";
+
+	const BatchReport report = runner.Run(jobs, [&] (const BatchItemResult& item, size_t finished, size_t total) {
+		if(item.status != GenerateStatus::Success)
+			std::cerr << "[" << finished << "/" << total << "] " << item.name << ": FAILED: " << item.message << "\n";
+		else if(!options.quiet) {
+			std::cout << "[" << finished << "/" << total << "] " << item.name << " " << item.width << "x" << item.height
+				<< " in " << item.milliseconds << " ms\n";
+			PrintLevels(std::cout, item.levels);
+		}
+	});
+
+	const size_t failed = report.GetFailedCount();
+	if(!options.quiet || failed) {
+		std::cout << "Done: " << report.items.size() - failed << " succeeded, " << failed << " failed, "
+			<< report.milliseconds << " ms total, " << report.steals << " tasks stolen\n";
+		if(options.cacheBytes) {
+			const DecodeCacheStats stats = cache.GetStats();
+			std::cout << "Decode cache: " << stats.hits << " hits, " << stats.misses << " misses\n";
+		}
+		std::cout << "Pipeline (the bottleneck is busy with a queue in front of it):\n";
+		for(const BatchStageReport& stage : report.stages) {
+			std::cout << "  " << stage.name << ": busy " << Round(stage.busyFraction * 100.0) << "%, " << Round(stage.averageActive)
+				<< " active, " << Round(stage.averageQueued) << " queued on average (max " << stage.maxQueued << ")\n";
+		}
+		const BufferPoolStats poolStats = BufferPool::GetStats();
+		std::cout << "Buffer pool: peak " << poolStats.peakBytes / (1024 * 1024) << " MiB in use, " << poolStats.retainedBytes / (1024 * 1024)
+			<< " MiB retained, " << poolStats.hits << " reused, " << poolStats.misses << " new\n";
+	}
+	return static_cast<int>(failed ? ExitCode::GenerationFailed : ExitCode::Success);
+}
+
+[[nodiscard]] bool CommandLine::Parse(int argc, char** argv, CommandLineOptions& options, std::string& error)
+{
+	auto next = [&] (int& i, std::string& value) {
+		if(i + 1 >= argc) {
+			error = std::string("Missing value for ") + argv[i];
+			return false;
+		}
+		value = argv[++i];
+		return true;
+	};
+
+	for(int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		std::string value;
+
+		if(arg == "-h" || arg == "--help") {
+			options.showHelp = true;
+		}
+		else if(arg == "--ao") {
+			if(!next(i, options.job.aoPath)) return false;
+		}
+		else if(arg == "--roughness") {
+			if(!next(i, options.job.roughnessPath)) return false;
+		}
+		else if(arg == "--metallic") {
+			if(!next(i, options.job.metallicPath)) return false;
+		}
+		else if(arg == "--unreal") {
+			if(!next(i, options.job.unrealPath)) return false;
+			options.job.generateUnreal = true;
+		}
+		else if(arg == "--unity") {
+			if(!next(i, options.job.unityPath)) return false;
+			options.job.generateUnity = true;
+		}
+		else if(arg == "--manifest") {
+			if(!next(i, options.manifestPath)) return false;
+		}
+		else if(arg == "--scan") {
+			if(!next(i, options.scanDirectory)) return false;
+		}
+		else if(arg == "--output-dir") {
+			if(!next(i, options.outputDir)) return false;
+		}
+		else if(arg == "--raw") {
+			options.rawOutputs = true;
+		}
+		else if(arg == "--no-unreal") {
+			options.job.generateUnreal = false;
+		}
+		else if(arg == "--no-unity") {
+			options.job.generateUnity = false;
+		}
+		else if(arg == "--threads") {
+			int threads = 0;
+			if(!next(i, value)) return false;
+			if(!ParseInt(value, 0, threads)) {
+				error = "Invalid thread count: " + value;
+				return false;
+			}
+			options.threads = static_cast<unsigned int>(threads);
+		}
+		else if(arg == "--cache-mb") {
+			int megabytes = 0;
+			if(!next(i, value)) return false;
+			if(!ParseInt(value, 0, megabytes)) {
+				error = "Invalid cache size: " + value;
+				return false;
+			}
+			options.cacheBytes = static_cast<size_t>(megabytes) * 1024 * 1024;
+		}
+		else if(arg == "--png-level") {
+			if(!next(i, value)) return false;
+			if(!ParseInt(value, 0, options.job.pngCompressionLevel) || options.job.pngCompressionLevel > 9) {
+				error = "Invalid PNG compression level: " + value;
+				return false;
+			}
+		}
+		else if(arg == "--size") {
+			if(!next(i, value)) return false;
+			if(!ParseInt(value, 1, options.job.outputSize) || options.job.outputSize > 65536) {
+				error = "Invalid output size: " + value;
+				return false;
+			}
+		}
+		else if(arg == "--ladder") {
+			if(!next(i, value)) return false;
+			if(!ParseInt(value, 0, options.job.ladderLevels) || options.job.ladderLevels > 16) {
+				error = "Invalid ladder level count: " + value;
+				return false;
+			}
+		}
+		else if(arg == "--bit-depth") {
+			if(!next(i, value)) return false;
+			if(value == "8") options.job.outputBitDepth = 8;
+			else if(value == "16") options.job.outputBitDepth = 16;
+			else {
+				error = "Invalid bit depth: " + value;
+				return false;
+			}
+		}
+		else if(arg == "--quantize") {
+			if(!next(i, value)) return false;
+			if(value == "nearest") options.job.quantize = QuantizeMode::Nearest;
+			else if(value == "dither") options.job.quantize = QuantizeMode::OrderedDither;
+			else {
+				error = "Invalid quantization: " + value;
+				return false;
+			}
+		}
+		else if(arg == "--dds") {
+			if(!next(i, value)) return false;
+			if(value == "bc7") options.job.blockFormat = BlockFormat::BC7;
+			else if(value == "bc5") options.job.blockFormat = BlockFormat::BC5;
+			else if(value == "bc4") options.job.blockFormat = BlockFormat::BC4;
+			else {
+				error = "Invalid block format: " + value;
+				return false;
+			}
+		}
+		else if(arg == "--bc-quality") {
+			if(!next(i, value)) return false;
+			if(value == "fast") options.job.blockQuality = BlockQuality::Fast;
+			else if(value == "normal") options.job.blockQuality = BlockQuality::Normal;
+			else if(value == "high") options.job.blockQuality = BlockQuality::High;
+			else {
+				error = "Invalid block compression quality: " + value;
+				return false;
+			}
+		}
+		else if(arg == "--ktx2") {
+			if(!next(i, value)) return false;
+			if(value == "raw") options.job.ktx2Format = BlockFormat::None;
+			else if(value == "bc7") options.job.ktx2Format = BlockFormat::BC7;
+			else {
+				error = "Invalid KTX2 format: " + value;
+				return false;
+			}
+			options.job.generateKtx2 = true;
+		}
+		else if(arg == "--zstd") {
+			if(!next(i, value)) return false;
+			if(!ParseInt(value, 1, options.job.ktx2ZstdLevel) || options.job.ktx2ZstdLevel > 22) {
+				error = "Invalid Zstandard level: " + value;
+				return false;
+			}
+			if(!Ktx2Writer::SupportsZstd()) {
+				error = "--zstd needs a build with Zstandard support";
+				return false;
+			}
+		}
+		else if(arg == "--benchmark") {
+			options.benchmark = true;
+			if(i + 1 < argc && argv[i + 1][0] != '-') {
+				value = argv[++i];
+				if(!ParseInt(value, 16, options.benchmarkSize)) {
+					error = "Invalid benchmark size: " + value;
+					return false;
+				}
+			}
+		}
+		else if(arg == "-q" || arg == "--quiet") {
+			options.quiet = true;
+		}
+		else {
+			error = "Unknown argument: " + arg;
+			return false;
+		}
+	}
+
+	if(options.showHelp || options.benchmark)
+		return true;
+
+	if(options.job.ktx2ZstdLevel > 0 && !options.job.generateKtx2) {
+		error = "--zstd needs --ktx2";
+		return false;
+	}
+
+	if(!options.manifestPath.empty() || !options.scanDirectory.empty()) {
+		if(!options.manifestPath.empty() && !options.scanDirectory.empty()) {
+			error = "--manifest and --scan cannot be combined";
+			return false;
+		}
+		return true;
+	}
+
+	if(options.job.aoPath.empty() || options.job.roughnessPath.empty() || options.job.metallicPath.empty()) {
+		error = "--ao, --roughness and --metallic are required";
+		return false;
+	}
+	if(!options.job.generateUnreal && !options.job.generateUnity) {
+		error = "Nothing to generate: both outputs are disabled";
+		return false;
+	}
+	return true;
+}
+
+void CommandLine::PrintUsage(std::ostream& out)
+{
+	out << "Usage:\n"
+		<< "  " << ORM::TitleStr << "                       Start the interactive editor\n"
+		<< "  " << ORM::TitleStr << " --ao <file> --roughness <file> --metallic <file> [options]\n"
+		<< "  " << ORM::TitleStr << " --manifest <file.json|file.csv> [options]\n"
+		<< "  " << ORM::TitleStr << " --scan <directory> [options]\n"
+		<< "  " << ORM::TitleStr << " --benchmark [size]    Measure packing, PNG and BC throughput\n"
+		<< "\n"
+		<< "Options:\n"
+		<< "  --unreal <file>    Unreal ORM output (RGB), default orm_unreal.png\n"
+		<< "  --unity <file>     Unity mask map output (RGBA), default orm_unity.png\n"
+		<< "  --output-dir <dir> Batch output folder (default: next to the manifest / scanned folder)\n"
+		<< "  --raw              Write the packed outputs as uncompressed .ormraw instead of PNG\n"
+		<< "                     (outputs named *.ormraw are always raw; .ormraw sources are mapped, not decoded)\n"
+		<< "  --no-unreal        Skip the Unreal output\n"
+		<< "  --no-unity         Skip the Unity output\n"
+		<< "  --threads <n>      Worker threads (0 = all cores)\n"
+		<< "  --cache-mb <n>     Batch decode cache budget in MiB, 0 disables (default 512)\n"
+		<< "  --png-level <0-9>  PNG deflate level (0 = store, 1 = fastest, 9 = smallest), default 6\n"
+		<< "  --size <px>        Resample every source so the output's long edge is <px>; mixed sizes allowed\n"
+		<< "  --ladder <n>       Also write n halved sizes (Name_ORM_Unreal_1024.png, ...) from the same decode\n"
+		<< "  --bit-depth <8|16> PNG sample depth, default: 16 if any source is 16-bit or float (HDR / EXR), else 8\n"
+		<< "  --quantize <mode>  Rounding of float (HDR / EXR) sources: nearest (default) or dither (8x8 ordered)\n"
+		<< "  --dds <format>     Also write DDS: bc7 (each packed output), bc5 (roughness + metallic, AO as bc4)\n"
+		<< "                     or bc4 (one file per channel)\n"
+		<< "  --bc-quality <q>   Block encoder preset: fast, normal (default) or high; for BC7, fast uses\n"
+		<< "                     mode 6 only and high searches the separate-alpha and partitioned modes\n"
+		<< "  --ktx2 <raw|bc7>   Also write a KTX2 with the full mip chain for each packed output\n"
+		<< "  --zstd <1-22>      Zstandard-supercompress the --ktx2 levels (builds with Zstandard only)\n"
+		<< "  -q, --quiet        Only report errors\n"
+		<< "  -h, --help         Show this help\n"
+		<< "\n"
+		<< "Exit codes: 0 success, 1 generation failed, 2 invalid arguments\n";
+}
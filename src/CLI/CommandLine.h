@@ -0,0 +1,59 @@
+#pragma once
+#include <ostream>
+#include <string>
+
+#include "Constants.h"
+#include "ORMGenerator.h"
+
+enum class ExitCode : int
+{
+	Success = 0,
+	GenerationFailed = 1,
+	InvalidArguments = 2
+};
+
+struct CommandLineOptions
+{
+	ORMJob job;
+
+	// Batch mode: a JSON/CSV manifest or a folder of *_AO/*_Roughness/*_Metallic files.
+	std::string manifestPath;
+	std::string scanDirectory;
+	std::string outputDir;
+
+	// Write every packed output as .ormraw (RawImage) instead of PNG.
+	bool rawOutputs = false;
+
+	unsigned int threads = 0;
+	size_t cacheBytes = ORM::DecodeCacheBytes;
+	bool quiet = false;
+	bool showHelp = false;
+
+	bool benchmark = false;
+	int benchmarkSize = 4096;
+};
+
+/**
+ * Class: CommandLine
+ *
+ * Headless entry point. Any command-line argument switches ORMTool into batch
+ * mode: no window, GL context or ImGui state is created, the job runs through
+ * ORMGenerator and the process exit code reports the outcome.
+ *
+ * Usage Example:
+ *
+ *   ORMTool --ao Rock_AO.png --roughness Rock_Roughness.png --metallic Rock_Metallic.png
+ *           --unreal Rock_ORM.png --unity Rock_MaskMap.png
+ *   ORMTool --manifest materials.json --output-dir packed/
+ *   ORMTool --scan textures/ --threads 16
+ */
+class CommandLine
+{
+public:
+	static bool IsHeadlessInvocation(int argc, char** argv);
+	static int Run(int argc, char** argv);
+	static int RunBatch(const CommandLineOptions& options);
+
+	[[nodiscard]] static bool Parse(int argc, char** argv, CommandLineOptions& options, std::string& error);
+	static void PrintUsage(std::ostream& out);
+};
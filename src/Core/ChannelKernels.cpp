@@ -0,0 +1,529 @@
+#include "ChannelKernels.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define ORM_SIMD_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+	#endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || (defined(__ARM_NEON) && defined(__arm__))
+	#define ORM_SIMD_NEON 1
+	#include <arm_neon.h>
+#endif
+
+// GCC/Clang need per-function target attributes to emit instructions above the
+// compile-time baseline; MSVC accepts intrinsics anywhere.
+#if defined(ORM_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+	#define ORM_TARGET(isa) __attribute__((target(isa)))
+#else
+	#define ORM_TARGET(isa)
+#endif
+
+namespace
+{
+	using PackFn = void(*)(const unsigned char*, const unsigned char*, const unsigned char*, unsigned char*, size_t);
+	using FusedFn = void(*)(const unsigned char*, const unsigned char*, const unsigned char*, unsigned char*, unsigned char*, size_t);
+
+	struct KernelTable
+	{
+		SimdLevel level;
+		PackFn packUnreal;
+		PackFn packUnity;
+		FusedFn packBoth;
+	};
+
+	// ---------------------------------------------------------------------
+	// Scalar reference
+	// ---------------------------------------------------------------------
+
+	// Templated over the sample type; the 8-bit instances fill the scalar table and
+	// SIMD tails, the 16-bit ones are the whole 16-bit path (compilers vectorize them).
+	template<typename T>
+	void PackUnrealScalar(const T* ao, const T* rough, const T* metal, T* dst, size_t count)
+	{
+		for(size_t i = 0; i < count; ++i) {
+			dst[i * 3 + 0] = ao[i];
+			dst[i * 3 + 1] = rough[i];
+			dst[i * 3 + 2] = metal[i];
+		}
+	}
+
+	template<typename T>
+	void PackUnityScalar(const T* ao, const T* rough, const T* metal, T* dst, size_t count)
+	{
+		constexpr T Max = std::numeric_limits<T>::max();
+		for(size_t i = 0; i < count; ++i) {
+			dst[i * 4 + 0] = metal[i];
+			dst[i * 4 + 1] = ao[i];
+			dst[i * 4 + 2] = Max;
+			dst[i * 4 + 3] = static_cast<T>(Max - rough[i]);
+		}
+	}
+
+	template<typename T>
+	void PackBothScalar(const T* ao, const T* rough, const T* metal, T* rgbDst, T* rgbaDst, size_t count)
+	{
+		constexpr T Max = std::numeric_limits<T>::max();
+		for(size_t i = 0; i < count; ++i) {
+			const T a = ao[i];
+			const T r = rough[i];
+			const T m = metal[i];
+			rgbDst[i * 3 + 0] = a;
+			rgbDst[i * 3 + 1] = r;
+			rgbDst[i * 3 + 2] = m;
+			rgbaDst[i * 4 + 0] = m;
+			rgbaDst[i * 4 + 1] = a;
+			rgbaDst[i * 4 + 2] = Max;
+			rgbaDst[i * 4 + 3] = static_cast<T>(Max - r);
+		}
+	}
+
+	constexpr KernelTable ScalarTable{ SimdLevel::Scalar, PackUnrealScalar, PackUnityScalar, PackBothScalar };
+
+	// Float -> unorm: v clamped to [0, 1] (NaN -> 0), then floor(v * Max + threshold).
+	// The threshold is 0.5 for rounding, or an 8x8 Bayer entry for ordered dithering.
+	constexpr unsigned char Bayer8[8][8] = {
+		{  0, 32,  8, 40,  2, 34, 10, 42 },
+		{ 48, 16, 56, 24, 50, 18, 58, 26 },
+		{ 12, 44,  4, 36, 14, 46,  6, 38 },
+		{ 60, 28, 52, 20, 62, 30, 54, 22 },
+		{  3, 35, 11, 43,  1, 33,  9, 41 },
+		{ 51, 19, 59, 27, 49, 17, 57, 25 },
+		{ 15, 47,  7, 39, 13, 45,  5, 37 },
+		{ 63, 31, 55, 23, 61, 29, 53, 21 }
+	};
+
+	/** Thresholds for pixels x, x + 1, ... x + 7 of row y; the pattern repeats every 8 pixels. */
+	void GetThresholds(QuantizeMode mode, int x, int y, float (&thresholds)[8])
+	{
+		for(int k = 0; k < 8; ++k)
+			thresholds[k] = mode == QuantizeMode::OrderedDither ? (Bayer8[y & 7][(x + k) & 7] + 0.5f) / 64.0f : 0.5f;
+	}
+
+	template<typename T>
+	void QuantizeScalar(const float* src, T* dst, size_t count, const float (&thresholds)[8])
+	{
+		constexpr float Max = static_cast<float>(std::numeric_limits<T>::max());
+		for(size_t i = 0; i < count; ++i) {
+			const float v = src[i] > 0.0f ? (src[i] < 1.0f ? src[i] : 1.0f) : 0.0f;
+			const float scaled = v * Max;
+			dst[i] = static_cast<T>(static_cast<int32_t>(scaled + thresholds[i & 7]));
+		}
+	}
+
+#if defined(ORM_SIMD_X86)
+	// ---------------------------------------------------------------------
+	// x86: SSE2 / SSSE3 / AVX2
+	// ---------------------------------------------------------------------
+
+	// pshufb masks for 16 pixels -> 48 interleaved RGB bytes. Entry [c][k] selects,
+	// for output block k, the bytes taken from plane c; -1 (0x80) yields zero so the
+	// three shuffles can be OR-ed.
+	struct ShuffleTables
+	{
+		int8_t interleave[3][3][16];
+	};
+
+	constexpr ShuffleTables BuildShuffleTables()
+	{
+		ShuffleTables t{};
+		for(int c = 0; c < 3; ++c) {
+			for(int k = 0; k < 3; ++k) {
+				for(int j = 0; j < 16; ++j) {
+					const int index = 16 * k + j;
+					t.interleave[c][k][j] = static_cast<int8_t>(index % 3 == c ? index / 3 : -1);
+				}
+			}
+		}
+		return t;
+	}
+
+	alignas(16) constexpr ShuffleTables Shuffles = BuildShuffleTables();
+
+	ORM_TARGET("sse2")
+	inline void StoreUnity16(unsigned char* dst, __m128i a, __m128i r, __m128i m)
+	{
+		const __m128i white = _mm_set1_epi8(static_cast<char>(0xFF));
+		const __m128i inv = _mm_xor_si128(r, white);
+
+		const __m128i maLo = _mm_unpacklo_epi8(m, a);
+		const __m128i maHi = _mm_unpackhi_epi8(m, a);
+		const __m128i wiLo = _mm_unpacklo_epi8(white, inv);
+		const __m128i wiHi = _mm_unpackhi_epi8(white, inv);
+
+		__m128i* out = reinterpret_cast<__m128i*>(dst);
+		_mm_storeu_si128(out + 0, _mm_unpacklo_epi16(maLo, wiLo));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(maLo, wiLo));
+		_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(maHi, wiHi));
+		_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(maHi, wiHi));
+	}
+
+	ORM_TARGET("sse2")
+	void PackUnitySSE2(const unsigned char* ao, const unsigned char* rough, const unsigned char* metal,
+		unsigned char* dst, size_t count)
+	{
+		size_t i = 0;
+		for(; i + 16 <= count; i += 16) {
+			StoreUnity16(dst + i * 4,
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(ao + i)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(rough + i)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(metal + i)));
+		}
+		PackUnityScalar(ao + i, rough + i, metal + i, dst + i * 4, count - i);
+	}
+
+	ORM_TARGET("ssse3")
+	inline void StoreUnreal16(unsigned char* dst, __m128i r, __m128i g, __m128i b, const __m128i (&masks)[3][3])
+	{
+		__m128i* out = reinterpret_cast<__m128i*>(dst);
+		for(int k = 0; k < 3; ++k) {
+			const __m128i block = _mm_or_si128(
+				_mm_or_si128(_mm_shuffle_epi8(r, masks[0][k]), _mm_shuffle_epi8(g, masks[1][k])),
+				_mm_shuffle_epi8(b, masks[2][k]));
+			_mm_storeu_si128(out + k, block);
+		}
+	}
+
+	ORM_TARGET("ssse3")
+	inline void LoadInterleaveMasks(__m128i (&masks)[3][3])
+	{
+		for(int c = 0; c < 3; ++c)
+			for(int k = 0; k < 3; ++k)
+				masks[c][k] = _mm_load_si128(reinterpret_cast<const __m128i*>(Shuffles.interleave[c][k]));
+	}
+
+	ORM_TARGET("ssse3")
+	void PackUnrealSSSE3(const unsigned char* ao, const unsigned char* rough, const unsigned char* metal,
+		unsigned char* dst, size_t count)
+	{
+		__m128i masks[3][3];
+		LoadInterleaveMasks(masks);
+
+		size_t i = 0;
+		for(; i + 16 <= count; i += 16) {
+			StoreUnreal16(dst + i * 3,
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(ao + i)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(rough + i)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(metal + i)),
+				masks);
+		}
+		PackUnrealScalar(ao + i, rough + i, metal + i, dst + i * 3, count - i);
+	}
+
+	ORM_TARGET("ssse3")
+	void PackBothSSSE3(const unsigned char* ao, const unsigned char* rough, const unsigned char* metal,
+		unsigned char* rgbDst, unsigned char* rgbaDst, size_t count)
+	{
+		__m128i masks[3][3];
+		LoadInterleaveMasks(masks);
+
+		size_t i = 0;
+		for(; i + 16 <= count; i += 16) {
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ao + i));
+			const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rough + i));
+			const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(metal + i));
+			StoreUnreal16(rgbDst + i * 3, a, r, m, masks);
+			StoreUnity16(rgbaDst + i * 4, a, r, m);
+		}
+		PackBothScalar(ao + i, rough + i, metal + i, rgbDst + i * 3, rgbaDst + i * 4, count - i);
+	}
+
+	ORM_TARGET("avx2")
+	void PackUnityAVX2(const unsigned char* ao, const unsigned char* rough, const unsigned char* metal,
+		unsigned char* dst, size_t count)
+	{
+		const __m256i white = _mm256_set1_epi8(static_cast<char>(0xFF));
+		size_t i = 0;
+		for(; i + 32 <= count; i += 32) {
+			const __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(metal + i));
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ao + i));
+			const __m256i inv = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rough + i)), white);
+
+			// Unpacks work per 128-bit lane: lane 0 holds pixels 0-15, lane 1 pixels 16-31.
+			const __m256i maLo = _mm256_unpacklo_epi8(m, a);
+			const __m256i maHi = _mm256_unpackhi_epi8(m, a);
+			const __m256i wiLo = _mm256_unpacklo_epi8(white, inv);
+			const __m256i wiHi = _mm256_unpackhi_epi8(white, inv);
+
+			const __m256i p0 = _mm256_unpacklo_epi16(maLo, wiLo); // px 0-3   | 16-19
+			const __m256i p1 = _mm256_unpackhi_epi16(maLo, wiLo); // px 4-7   | 20-23
+			const __m256i p2 = _mm256_unpacklo_epi16(maHi, wiHi); // px 8-11  | 24-27
+			const __m256i p3 = _mm256_unpackhi_epi16(maHi, wiHi); // px 12-15 | 28-31
+
+			__m256i* out = reinterpret_cast<__m256i*>(dst + i * 4);
+			_mm256_storeu_si256(out + 0, _mm256_permute2x128_si256(p0, p1, 0x20));
+			_mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+			_mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+			_mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+		}
+		PackUnitySSE2(ao + i, rough + i, metal + i, dst + i * 4, count - i);
+	}
+
+	/** Eight floats per step; products and sums are the same IEEE operations as QuantizeScalar. */
+	template<typename T>
+	ORM_TARGET("sse2")
+	void QuantizeSSE2(const float* src, T* dst, size_t count, const float (&thresholds)[8])
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 max = _mm_set1_ps(static_cast<float>(std::numeric_limits<T>::max()));
+		const __m128 t0 = _mm_loadu_ps(thresholds);
+		const __m128 t1 = _mm_loadu_ps(thresholds + 4);
+
+		size_t i = 0;
+		for(; i + 8 <= count; i += 8) {
+			// max(v, 0) returns 0 for NaN, like the scalar clamp.
+			const __m128 v0 = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), zero), one);
+			const __m128 v1 = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), zero), one);
+			const __m128i q0 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v0, max), t0));
+			const __m128i q1 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v1, max), t1));
+			if constexpr(std::is_same_v<T, uint8_t>) {
+				const __m128i words = _mm_packs_epi32(q0, q1);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(words, words));
+			}
+			else {
+				// SSE2 has no unsigned 32 -> 16 pack: bias into the signed range and back.
+				const __m128i bias32 = _mm_set1_epi32(32768);
+				const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+				const __m128i words = _mm_packs_epi32(_mm_sub_epi32(q0, bias32), _mm_sub_epi32(q1, bias32));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(words, bias16));
+			}
+		}
+		QuantizeScalar(src + i, dst + i, count - i, thresholds);
+	}
+
+	constexpr KernelTable SSE2Table{ SimdLevel::SSE2, PackUnrealScalar, PackUnitySSE2, PackBothScalar };
+	constexpr KernelTable SSSE3Table{ SimdLevel::SSSE3, PackUnrealSSSE3, PackUnitySSE2, PackBothSSSE3 };
+	// 3-channel shuffles do not widen cleanly across AVX2 lanes, so RGB stays on SSSE3.
+	constexpr KernelTable AVX2Table{ SimdLevel::AVX2, PackUnrealSSSE3, PackUnityAVX2, PackBothSSSE3 };
+
+	SimdLevel DetectSimdLevel()
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4] = {};
+		__cpuid(info, 0);
+		const int maxLeaf = info[0];
+
+		__cpuid(info, 1);
+		const bool sse2 = (info[3] & (1 << 26)) != 0;
+		const bool ssse3 = (info[2] & (1 << 9)) != 0;
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+
+		bool avx2 = false;
+		if(maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+#else
+		__builtin_cpu_init();
+		const bool sse2 = __builtin_cpu_supports("sse2");
+		const bool ssse3 = __builtin_cpu_supports("ssse3");
+		const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+		if(avx2 && ssse3) return SimdLevel::AVX2;
+		if(ssse3) return SimdLevel::SSSE3;
+		if(sse2) return SimdLevel::SSE2;
+		return SimdLevel::Scalar;
+	}
+
+#elif defined(ORM_SIMD_NEON)
+	// ---------------------------------------------------------------------
+	// ARM: NEON structured loads/stores
+	// ---------------------------------------------------------------------
+
+	void PackUnrealNEON(const unsigned char* ao, const unsigned char* rough, const unsigned char* metal,
+		unsigned char* dst, size_t count)
+	{
+		size_t i = 0;
+		for(; i + 16 <= count; i += 16) {
+			uint8x16x3_t px;
+			px.val[0] = vld1q_u8(ao + i);
+			px.val[1] = vld1q_u8(rough + i);
+			px.val[2] = vld1q_u8(metal + i);
+			vst3q_u8(dst + i * 3, px);
+		}
+		PackUnrealScalar(ao + i, rough + i, metal + i, dst + i * 3, count - i);
+	}
+
+	void PackUnityNEON(const unsigned char* ao, const unsigned char* rough, const unsigned char* metal,
+		unsigned char* dst, size_t count)
+	{
+		size_t i = 0;
+		for(; i + 16 <= count; i += 16) {
+			uint8x16x4_t px;
+			px.val[0] = vld1q_u8(metal + i);
+			px.val[1] = vld1q_u8(ao + i);
+			px.val[2] = vdupq_n_u8(255);
+			px.val[3] = vmvnq_u8(vld1q_u8(rough + i));
+			vst4q_u8(dst + i * 4, px);
+		}
+		PackUnityScalar(ao + i, rough + i, metal + i, dst + i * 4, count - i);
+	}
+
+	void PackBothNEON(const unsigned char* ao, const unsigned char* rough, const unsigned char* metal,
+		unsigned char* rgbDst, unsigned char* rgbaDst, size_t count)
+	{
+		size_t i = 0;
+		for(; i + 16 <= count; i += 16) {
+			const uint8x16_t a = vld1q_u8(ao + i);
+			const uint8x16_t r = vld1q_u8(rough + i);
+			const uint8x16_t m = vld1q_u8(metal + i);
+
+			uint8x16x3_t rgb;
+			rgb.val[0] = a;
+			rgb.val[1] = r;
+			rgb.val[2] = m;
+			vst3q_u8(rgbDst + i * 3, rgb);
+
+			uint8x16x4_t rgba;
+			rgba.val[0] = m;
+			rgba.val[1] = a;
+			rgba.val[2] = vdupq_n_u8(255);
+			rgba.val[3] = vmvnq_u8(r);
+			vst4q_u8(rgbaDst + i * 4, rgba);
+		}
+		PackBothScalar(ao + i, rough + i, metal + i, rgbDst + i * 3, rgbaDst + i * 4, count - i);
+	}
+
+	constexpr KernelTable NEONTable{ SimdLevel::NEON, PackUnrealNEON, PackUnityNEON, PackBothNEON };
+
+	SimdLevel DetectSimdLevel()
+	{
+		return SimdLevel::NEON;
+	}
+
+#else
+	SimdLevel DetectSimdLevel()
+	{
+		return SimdLevel::Scalar;
+	}
+#endif
+
+	const KernelTable* GetTable(SimdLevel level)
+	{
+		switch(level)
+		{
+#if defined(ORM_SIMD_X86)
+		case SimdLevel::AVX2: return &AVX2Table;
+		case SimdLevel::SSSE3: return &SSSE3Table;
+		case SimdLevel::SSE2: return &SSE2Table;
+#elif defined(ORM_SIMD_NEON)
+		case SimdLevel::NEON: return &NEONTable;
+#endif
+		default: return &ScalarTable;
+		}
+	}
+
+	std::atomic<const KernelTable*> activeTable{ nullptr };
+
+	const KernelTable& Active()
+	{
+		const KernelTable* table = activeTable.load(std::memory_order_acquire);
+		if(!table) {
+			table = GetTable(ChannelKernels::GetBestSupportedLevel());
+			activeTable.store(table, std::memory_order_release);
+		}
+		return *table;
+	}
+}
+
+template<typename T>
+void ChannelKernels::PackUnrealRGB(const T* ao, const T* rough, const T* metal, T* dst, size_t count)
+{
+	if constexpr(std::is_same_v<T, uint8_t>)
+		Active().packUnreal(ao, rough, metal, dst, count);
+	else
+		PackUnrealScalar(ao, rough, metal, dst, count);
+}
+
+template<typename T>
+void ChannelKernels::PackUnityRGBA(const T* ao, const T* rough, const T* metal, T* dst, size_t count)
+{
+	if constexpr(std::is_same_v<T, uint8_t>)
+		Active().packUnity(ao, rough, metal, dst, count);
+	else
+		PackUnityScalar(ao, rough, metal, dst, count);
+}
+
+template<typename T>
+void ChannelKernels::PackUnrealAndUnity(const T* ao, const T* rough, const T* metal, T* rgbDst, T* rgbaDst, size_t count)
+{
+	if constexpr(std::is_same_v<T, uint8_t>)
+		Active().packBoth(ao, rough, metal, rgbDst, rgbaDst, count);
+	else
+		PackBothScalar(ao, rough, metal, rgbDst, rgbaDst, count);
+}
+
+template void ChannelKernels::PackUnrealRGB<uint8_t>(const uint8_t*, const uint8_t*, const uint8_t*, uint8_t*, size_t);
+template void ChannelKernels::PackUnrealRGB<uint16_t>(const uint16_t*, const uint16_t*, const uint16_t*, uint16_t*, size_t);
+template void ChannelKernels::PackUnityRGBA<uint8_t>(const uint8_t*, const uint8_t*, const uint8_t*, uint8_t*, size_t);
+template void ChannelKernels::PackUnityRGBA<uint16_t>(const uint16_t*, const uint16_t*, const uint16_t*, uint16_t*, size_t);
+template void ChannelKernels::PackUnrealAndUnity<uint8_t>(const uint8_t*, const uint8_t*, const uint8_t*, uint8_t*, uint8_t*, size_t);
+template void ChannelKernels::PackUnrealAndUnity<uint16_t>(const uint16_t*, const uint16_t*, const uint16_t*, uint16_t*, uint16_t*, size_t);
+
+template<typename T>
+void ChannelKernels::Quantize(const float* src, T* dst, size_t count, QuantizeMode mode, int x, int y)
+{
+	float thresholds[8];
+	GetThresholds(mode, x, y, thresholds);
+#if defined(ORM_SIMD_X86)
+	if(Active().level != SimdLevel::Scalar) {
+		QuantizeSSE2(src, dst, count, thresholds);
+		return;
+	}
+#endif
+	QuantizeScalar(src, dst, count, thresholds);
+}
+
+template void ChannelKernels::Quantize<uint8_t>(const float*, uint8_t*, size_t, QuantizeMode, int, int);
+template void ChannelKernels::Quantize<uint16_t>(const float*, uint16_t*, size_t, QuantizeMode, int, int);
+
+void ChannelKernels::NarrowTo8(const uint16_t* src, uint8_t* dst, size_t count)
+{
+	for(size_t i = 0; i < count; ++i)
+		dst[i] = static_cast<uint8_t>((src[i] * 255u + 32895u) >> 16);  // round(v / 257)
+}
+
+void ChannelKernels::WidenTo16(const uint8_t* src, uint16_t* dst, size_t count)
+{
+	for(size_t i = 0; i < count; ++i)
+		dst[i] = static_cast<uint16_t>(src[i] * 257u);
+}
+
+SimdLevel ChannelKernels::GetSimdLevel()
+{
+	return Active().level;
+}
+
+SimdLevel ChannelKernels::GetBestSupportedLevel()
+{
+	static const SimdLevel best = DetectSimdLevel();
+	return best;
+}
+
+void ChannelKernels::ForceSimdLevel(SimdLevel level)
+{
+	const SimdLevel best = GetBestSupportedLevel();
+	if(static_cast<int>(level) > static_cast<int>(best) || GetTable(level)->level != level)
+		level = best;
+	activeTable.store(GetTable(level), std::memory_order_release);
+}
+
+const char* ChannelKernels::GetSimdLevelName(SimdLevel level)
+{
+	switch(level)
+	{
+	case SimdLevel::Scalar: return "Scalar";
+	case SimdLevel::SSE2: return "SSE2";
+	case SimdLevel::SSSE3: return "SSSE3";
+	case SimdLevel::AVX2: return "AVX2";
+	case SimdLevel::NEON: return "NEON";
+	default: return "Unknown";
+	}
+}
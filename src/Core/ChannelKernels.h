@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/** Instruction set used by the channel kernels. */
+enum class SimdLevel
+{
+	Scalar,
+	SSE2,
+	SSSE3,
+	AVX2,
+	NEON
+};
+
+/** How float samples are rounded to integers. */
+enum class QuantizeMode
+{
+	Nearest,
+	OrderedDither  // 8x8 Bayer thresholds: no banding in smooth gradients, at the cost of fine noise
+};
+
+/**
+ * Class: ChannelKernels
+ *
+ * Interleave kernels for the ORM channel layouts.
+ * Each entry point dispatches at runtime to the widest instruction set the CPU
+ * supports (SSE2/SSSE3/AVX2 on x86, NEON on ARM) and falls back to scalar code
+ * for the tail and for unsupported targets. All paths are bit-exact with Scalar.
+ *
+ * Notes:
+ * - The packing kernels are templates over the sample type, instantiated for
+ *   uint8_t and uint16_t. The choice is made at compile time: 8-bit goes
+ *   through the SIMD dispatch above, 16-bit runs the scalar template. "255"
+ *   below means the type's maximum (65535 for 16-bit).
+ * - Quantize() converts float planes (HDR / EXR sources) row by row right
+ *   before packing. It uses SSE2 on x86 unless the scalar level is forced.
+ * - Dispatch is resolved once, on first use.
+ * - ForceSimdLevel() exists for verification and benchmarking; a level the CPU
+ *   cannot run is clamped down to the best supported one.
+ */
+class ChannelKernels
+{
+public:
+	/** Unreal layout: dst = { ao, rough, metal } per pixel. */
+	template<typename T>
+	static void PackUnrealRGB(const T* ao, const T* rough, const T* metal, T* dst, size_t count);
+
+	/** Unity layout: dst = { metal, ao, 255, 255 - rough } per pixel. */
+	template<typename T>
+	static void PackUnityRGBA(const T* ao, const T* rough, const T* metal, T* dst, size_t count);
+
+	/** Writes both layouts from a single read of the source planes. */
+	template<typename T>
+	static void PackUnrealAndUnity(const T* ao, const T* rough, const T* metal, T* rgbDst, T* rgbaDst, size_t count);
+
+	/**
+	 * Float -> unorm: clamps to [0, 1] (NaN to 0) and scales to the type's maximum.
+	 * (x, y) is the image position of src[0]; it selects the dither thresholds.
+	 */
+	template<typename T>
+	static void Quantize(const float* src, T* dst, size_t count, QuantizeMode mode, int x, int y);
+
+	/** Sample depth conversion: 16 -> 8 rounds to nearest, 8 -> 16 maps 255 to 65535. */
+	static void NarrowTo8(const uint16_t* src, uint8_t* dst, size_t count);
+	static void WidenTo16(const uint8_t* src, uint16_t* dst, size_t count);
+
+	static SimdLevel GetSimdLevel();
+	static SimdLevel GetBestSupportedLevel();
+	static void ForceSimdLevel(SimdLevel level);
+	static const char* GetSimdLevelName(SimdLevel level);
+};
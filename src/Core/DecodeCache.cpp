@@ -0,0 +1,108 @@
+#include "DecodeCache.h"
+
+namespace
+{
+	std::string MakeKey(const std::string& path)
+	{
+		std::error_code ec;
+		const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+		return ec ? path : canonical.string();
+	}
+}
+
+DecodeCache::DecodeCache(size_t budgetBytes) : budget(budgetBytes)
+{
+}
+
+[[nodiscard]] ORMResult DecodeCache::Load(const std::string& path, GrayscalePlane& plane)
+{
+	const std::string key = MakeKey(path);
+
+	std::error_code ec;
+	const std::filesystem::file_time_type modified = std::filesystem::last_write_time(path, ec);
+	const std::uintmax_t fileSize = ec ? 0 : std::filesystem::file_size(path, ec);
+	const bool cacheable = !ec;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = index.find(key);
+		if(found != index.end()) {
+			if(cacheable && found->second->modified == modified && found->second->fileSize == fileSize) {
+				entries.splice(entries.begin(), entries, found->second);
+				plane = found->second->plane;
+				++hits;
+				return ORMResult();
+			}
+			Erase(found->second);  // stale: the file changed on disk
+		}
+		++misses;
+	}
+
+	ORMResult result = ORMGenerator::DecodeSource(path, plane);
+	if(!result.Succeeded() || !cacheable)
+		return result;
+
+	const size_t bytes = static_cast<size_t>(plane.width) * plane.height * (plane.bitDepth / 8);
+	std::lock_guard<std::mutex> lock(mutex);
+	if(bytes > budget)
+		return result;
+
+	// Another thread may have decoded the same file meanwhile; keep the newest.
+	auto found = index.find(key);
+	if(found != index.end())
+		Erase(found->second);
+
+	entries.push_front(Entry{ key, modified, fileSize, plane, bytes });
+	index[key] = entries.begin();
+	usedBytes += bytes;
+	EvictToBudget();
+	return result;
+}
+
+void DecodeCache::SetBudget(size_t budgetBytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	budget = budgetBytes;
+	EvictToBudget();
+}
+
+size_t DecodeCache::GetBudget() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return budget;
+}
+
+void DecodeCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	index.clear();
+	usedBytes = 0;
+}
+
+DecodeCacheStats DecodeCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	DecodeCacheStats stats;
+	stats.hits = hits;
+	stats.misses = misses;
+	stats.evictions = evictions;
+	stats.entries = entries.size();
+	stats.bytes = usedBytes;
+	return stats;
+}
+
+void DecodeCache::Erase(std::list<Entry>::iterator entry)
+{
+	usedBytes -= entry->bytes;
+	index.erase(entry->key);
+	entries.erase(entry);
+}
+
+void DecodeCache::EvictToBudget()
+{
+	while(usedBytes > budget && !entries.empty()) {
+		Erase(std::prev(entries.end()));
+		++evictions;
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Constants.h"
+#include "ORMGenerator.h"
+
+struct DecodeCacheStats
+{
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t evictions = 0;
+	size_t entries = 0;
+	size_t bytes = 0;
+};
+
+/**
+ * Class: DecodeCache
+ *
+ * In-process LRU cache of decoded grayscale planes, keyed by the canonical file
+ * path and validated against the file's modification time and size, so an
+ * edited texture is decoded again while an unchanged one is returned at once.
+ *
+ * Notes:
+ * - Thread-safe. Decoding happens outside the lock, so concurrent misses on
+ *   different files decode in parallel.
+ * - Evicted planes stay alive for as long as a caller still holds them; the
+ *   budget only limits what the cache itself keeps. A plane larger than the
+ *   whole budget is returned but not cached.
+ */
+class DecodeCache
+{
+public:
+	explicit DecodeCache(size_t budgetBytes = ORM::DecodeCacheBytes);
+
+	[[nodiscard]] ORMResult Load(const std::string& path, GrayscalePlane& plane);
+
+	void SetBudget(size_t budgetBytes);
+	size_t GetBudget() const;
+	void Clear();
+
+	DecodeCacheStats GetStats() const;
+
+private:
+	struct Entry
+	{
+		std::string key;
+		std::filesystem::file_time_type modified;
+		std::uintmax_t fileSize = 0;
+		GrayscalePlane plane;
+		size_t bytes = 0;
+	};
+
+	void Erase(std::list<Entry>::iterator entry);
+	void EvictToBudget();
+
+	mutable std::mutex mutex;
+	std::list<Entry> entries;  // most recently used first
+	std::unordered_map<std::string, std::list<Entry>::iterator> index;
+
+	size_t budget;
+	size_t usedBytes = 0;
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t evictions = 0;
+};
@@ -0,0 +1,173 @@
+#include "ImageResampler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "BufferPool.h"
+#include "Constants.h"
+#include "ThreadPool.h"
+
+// The sampler scratch of a resize comes from BufferPool like the planes themselves.
+#define STBIR_MALLOC(size, user_data) ((void)(user_data), BufferPool::Allocate(size))
+#define STBIR_FREE(pointer, user_data) ((void)(user_data), BufferPool::Free(pointer))
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include "stb_image_resize2.h"
+
+namespace
+{
+	ResampledImage Allocate(int width, int height, int channels, int bitDepth)
+	{
+		ResampledImage image;
+		image.pixels = BufferPool::AllocateShared(static_cast<size_t>(width) * height * channels * (bitDepth / 8));
+		if(!image.pixels)
+			return ResampledImage();
+		image.width = width;
+		image.height = height;
+		image.channels = channels;
+		image.bitDepth = bitDepth;
+		return image;
+	}
+
+	bool IsSupportedDepth(int bitDepth)
+	{
+		return bitDepth == 8 || bitDepth == 16 || bitDepth == 32;
+	}
+
+	stbir_datatype GetDataType(int bitDepth)
+	{
+		return bitDepth == 32 ? STBIR_TYPE_FLOAT : bitDepth == 16 ? STBIR_TYPE_UINT16 : STBIR_TYPE_UINT8;
+	}
+
+	stbir_pixel_layout GetLayout(int channels)
+	{
+		switch(channels) {
+			case 1: return STBIR_1CHANNEL;
+			case 2: return STBIR_2CHANNEL;
+			case 3: return STBIR_RGB;
+			default: return STBIR_4CHANNEL;
+		}
+	}
+
+	template<typename T>
+	void DownsampleRows(const T* src, int srcWidth, int srcHeight, const ResampledImage& dst, int firstRow, int rowCount)
+	{
+		const int channels = dst.channels;
+		const size_t srcStride = static_cast<size_t>(srcWidth) * channels;
+		const size_t dstStride = static_cast<size_t>(dst.width) * channels;
+
+		for(int y = firstRow; y < firstRow + rowCount; ++y) {
+			// A level of odd size drops the last row/column of its parent, as glGenerateMipmap does.
+			const T* row0 = src + srcStride * std::min(2 * y, srcHeight - 1);
+			const T* row1 = src + srcStride * std::min(2 * y + 1, srcHeight - 1);
+			T* out = reinterpret_cast<T*>(dst.pixels.get()) + dstStride * y;
+
+			for(int x = 0; x < dst.width; ++x) {
+				const size_t x0 = static_cast<size_t>(std::min(2 * x, srcWidth - 1)) * channels;
+				const size_t x1 = static_cast<size_t>(std::min(2 * x + 1, srcWidth - 1)) * channels;
+				for(int c = 0; c < channels; ++c) {
+					if constexpr(std::is_floating_point_v<T>)
+						out[static_cast<size_t>(x) * channels + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+					else {
+						const uint32_t sum = uint32_t(row0[x0 + c]) + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+						out[static_cast<size_t>(x) * channels + c] = static_cast<T>((sum + 2) >> 2);
+					}
+				}
+			}
+		}
+	}
+}
+
+ImageResampler::ImageResampler(ThreadPool& pool) : pool(pool)
+{
+}
+
+ResampledImage ImageResampler::Resize(const unsigned char* src, int srcWidth, int srcHeight, int channels, int width, int height,
+	int bitDepth) const
+{
+	if(!src || srcWidth <= 0 || srcHeight <= 0 || width <= 0 || height <= 0 || channels < 1 || channels > 4
+		|| !IsSupportedDepth(bitDepth))
+		return ResampledImage();
+
+	ResampledImage dst = Allocate(width, height, channels, bitDepth);
+	if(!dst.pixels)
+		return dst;
+	if(width == srcWidth && height == srcHeight) {
+		std::memcpy(dst.pixels.get(), src, static_cast<size_t>(width) * height * channels * (bitDepth / 8));
+		return dst;
+	}
+
+	STBIR_RESIZE resize;
+	stbir_resize_init(&resize, src, srcWidth, srcHeight, 0, dst.pixels.get(), width, height, 0, GetLayout(channels),
+		GetDataType(bitDepth));
+
+	// Each split owns a band of output rows; the samplers are shared read-only.
+	const int splits = stbir_build_samplers_with_splits(&resize, static_cast<int>(std::max<size_t>(1, pool.GetThreadCount())));
+	if(splits <= 0) {
+		stbir_free_samplers(&resize);
+		return ResampledImage();
+	}
+	pool.ParallelFor(static_cast<size_t>(splits), [&] (size_t split) {
+		stbir_resize_extended_split(&resize, static_cast<int>(split), 1);
+	});
+	stbir_free_samplers(&resize);
+	return dst;
+}
+
+ResampledImage ImageResampler::Halve(const unsigned char* src, int width, int height, int channels, int bitDepth) const
+{
+	if(!src || width <= 0 || height <= 0 || channels < 1 || channels > 4 || !IsSupportedDepth(bitDepth))
+		return ResampledImage();
+
+	ResampledImage half = Allocate(std::max(1, width / 2), std::max(1, height / 2), channels, bitDepth);
+	if(!half.pixels)
+		return half;
+
+	const size_t rowBytes = static_cast<size_t>(width) * channels * (bitDepth / 8) * 2;
+	const int rowsPerTile = static_cast<int>(std::max<size_t>(1, ORM::PackTileBytes / rowBytes));
+	const size_t tileCount = (static_cast<size_t>(half.height) + rowsPerTile - 1) / rowsPerTile;
+	pool.ParallelFor(tileCount, [&] (size_t tile) {
+		const int firstRow = static_cast<int>(tile) * rowsPerTile;
+		const int rowCount = std::min(rowsPerTile, half.height - firstRow);
+		if(bitDepth == 32)
+			DownsampleRows(reinterpret_cast<const float*>(src), width, height, half, firstRow, rowCount);
+		else if(bitDepth == 16)
+			DownsampleRows(reinterpret_cast<const uint16_t*>(src), width, height, half, firstRow, rowCount);
+		else
+			DownsampleRows(src, width, height, half, firstRow, rowCount);
+	});
+	return half;
+}
+
+std::vector<ResampledImage> ImageResampler::BuildMipChain(const unsigned char* src, int width, int height, int channels) const
+{
+	std::vector<ResampledImage> levels;
+	if(!src || width <= 0 || height <= 0 || channels < 1 || channels > 4)
+		return levels;
+
+	const unsigned char* parent = src;
+	int parentWidth = width;
+	int parentHeight = height;
+	while(parentWidth > 1 || parentHeight > 1) {
+		ResampledImage level = Halve(parent, parentWidth, parentHeight, channels);
+		parent = level.pixels.get();
+		parentWidth = level.width;
+		parentHeight = level.height;
+		levels.push_back(std::move(level));
+	}
+	return levels;
+}
+
+void ImageResampler::FitWithin(int width, int height, int maxEdge, int& fitWidth, int& fitHeight)
+{
+	fitWidth = width;
+	fitHeight = height;
+	const int longEdge = std::max(width, height);
+	if(maxEdge <= 0 || longEdge <= maxEdge)
+		return;
+
+	const double scale = static_cast<double>(maxEdge) / longEdge;
+	fitWidth = std::max(1, static_cast<int>(width * scale + 0.5));
+	fitHeight = std::max(1, static_cast<int>(height * scale + 0.5));
+}
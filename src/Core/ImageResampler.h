@@ -0,0 +1,53 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+/** An interleaved image produced by ImageResampler; 16-bit samples are native-endian uint16_t, 32-bit ones float. */
+struct ResampledImage
+{
+	std::shared_ptr<unsigned char> pixels;
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	int bitDepth = 8;
+};
+
+/**
+ * Class: ImageResampler
+ *
+ * Scales 8-bit, 16-bit or float images (1-4 interleaved channels) for display and export.
+ * Resize() runs stb_image_resize2 with its default filters and hands the
+ * output rows to the ThreadPool as independent splits; Halve() and
+ * BuildMipChain() apply a 2x2 box filter, rows in parallel.
+ *
+ * Notes:
+ * - Channels are resampled independently and alpha is never premultiplied,
+ *   since every channel of an ORM map is data rather than coverage.
+ * - This is the only translation unit that compiles stb_image_resize2.
+ */
+class ImageResampler
+{
+public:
+	explicit ImageResampler(ThreadPool& pool);
+
+	/** Returns src resampled to width x height; a same-size request copies. */
+	ResampledImage Resize(const unsigned char* src, int srcWidth, int srcHeight, int channels, int width, int height,
+		int bitDepth = 8) const;
+
+	/** Returns src at floor(size / 2) (at least 1x1), each pixel the rounded mean of a 2x2 block. */
+	ResampledImage Halve(const unsigned char* src, int width, int height, int channels, int bitDepth = 8) const;
+
+	/**
+	 * Returns the levels below src (level 0), each floor(size / 2) of the previous
+	 * one as OpenGL expects, ending at 1x1.
+	 */
+	std::vector<ResampledImage> BuildMipChain(const unsigned char* src, int width, int height, int channels) const;
+
+	/** Scales width x height down to fit maxEdge, keeping the aspect ratio; never upscales. */
+	static void FitWithin(int width, int height, int maxEdge, int& fitWidth, int& fitHeight);
+
+private:
+	ThreadPool& pool;
+};
@@ -0,0 +1,599 @@
+#include "ORMGenerator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+
+#include "BufferPool.h"
+#include "ChannelKernels.h"
+#include "DdsWriter.h"
+#include "DecodeCache.h"
+#include "IOService.h"
+#include "Ktx2Writer.h"
+#include "RawImage.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	ORMResult Fail(GenerateStatus status, std::string message)
+	{
+		ORMResult result;
+		result.status = status;
+		result.message = std::move(message);
+		return result;
+	}
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	GrayscalePlane Halve(const ImageResampler& resampler, const GrayscalePlane& plane)
+	{
+		ResampledImage half = resampler.Halve(plane.pixels.get(), plane.width, plane.height, 1, plane.bitDepth);
+		return GrayscalePlane{ std::move(half.pixels), half.width, half.height, plane.bitDepth };
+	}
+
+	/** The next smaller level of every plane; false when one of them could not be allocated. */
+	bool HalveSources(const ImageResampler& resampler, const ORMSources& parent, ORMSources& half)
+	{
+		half.ao = Halve(resampler, parent.ao);
+		half.roughness = Halve(resampler, parent.roughness);
+		half.metallic = Halve(resampler, parent.metallic);
+		return half.ao.pixels && half.roughness.pixels && half.metallic.pixels;
+	}
+
+	/** Integer planes must already be at bitDepth; float planes are quantized to it while packing. */
+	ORMPackSource MakePackSource(const ORMSources& sources, int bitDepth, QuantizeMode quantize)
+	{
+		ORMPackSource source{ sources.ao.pixels.get(), sources.roughness.pixels.get(), sources.metallic.pixels.get(),
+			sources.ao.width, sources.ao.height, bitDepth };
+		source.aoFloat = sources.ao.bitDepth == 32;
+		source.roughnessFloat = sources.roughness.bitDepth == 32;
+		source.metallicFloat = sources.metallic.bitDepth == 32;
+		source.quantize = quantize;
+		return source;
+	}
+
+	/**
+	 * Rows [firstRow, firstRow + rowCount) of one plane of an 8-bit pack source. Integer planes are
+	 * returned in place; float planes are quantized into scratch with the same dither phase PackRows uses.
+	 */
+	const unsigned char* GetPlaneRows(const ORMPackSource& source, const unsigned char* plane, bool isFloat, int firstRow, int rowCount,
+		unsigned char* scratch)
+	{
+		const size_t width = static_cast<size_t>(source.width);
+		if(!isFloat)
+			return plane + width * firstRow;
+		for(int i = 0; i < rowCount; ++i) {
+			const int y = firstRow + i;
+			ChannelKernels::Quantize(reinterpret_cast<const float*>(plane) + width * y, scratch + width * i, width, source.quantize, 0, y);
+		}
+		return scratch;
+	}
+}
+
+ORMGenerator::ORMGenerator(ThreadPool& pool, DecodeCache* cache)
+	: pool(pool), packer(pool), resampler(pool), pngWriter(pool), blockCompressor(pool), cache(cache)
+{
+}
+
+[[nodiscard]] ORMResult ORMGenerator::Generate(const ORMJob& job, const ProgressFn& progress) const
+{
+	return Generate(ORMSources(), job, progress);
+}
+
+[[nodiscard]] ORMResult ORMGenerator::Generate(ORMSources sources, const ORMJob& job, const ProgressFn& progress,
+	const PreviewFn& onPreview) const
+{
+	if(!job.generateUnreal && !job.generateUnity)
+		return Fail(GenerateStatus::NothingToDo, "No output selected");
+
+	ORMResult result;
+	if(!sources.ao.pixels) result = LoadSource(job.aoPath, sources.ao);
+	if(result.Succeeded() && !sources.roughness.pixels) result = LoadSource(job.roughnessPath, sources.roughness);
+	if(result.Succeeded() && !sources.metallic.pixels) result = LoadSource(job.metallicPath, sources.metallic);
+	if(result.Succeeded()) result = ResampleSources(sources, job);
+	if(result.Succeeded()) result = ValidateSources(sources);
+	if(!result.Succeeded())
+		return result;
+
+	result.width = sources.ao.width;
+	result.height = sources.ao.height;
+
+	// The preview needs the packed Unreal pixels in memory; the files themselves are streamed.
+	if(job.keepUnrealPixels && job.generateUnreal) {
+		ORMJob previewJob = job;
+		previewJob.generateUnity = false;
+
+		ORMPackedImage packed;
+		ORMResult preview = Pack(sources, previewJob, packed);
+		if(!preview.Succeeded())
+			return preview;
+		if(onPreview)
+			onPreview(std::move(packed));
+		else
+			result.unrealPixels = std::move(packed.unrealRGB);
+	}
+
+	ORMResult written = WriteOutputs(sources, job, progress);
+	if(!written.Succeeded())
+		return written;
+
+	result.levels = std::move(written.levels);
+	if(progress) progress(1.0f);
+	return result;
+}
+
+[[nodiscard]] ORMResult ORMGenerator::LoadSource(const std::string& path, GrayscalePlane& plane) const
+{
+	return cache ? cache->Load(path, plane) : DecodeSource(path, plane);
+}
+
+[[nodiscard]] ORMResult ORMGenerator::DecodeSource(const std::string& path, GrayscalePlane& plane)
+{
+	// Raw planes are packed straight from the mapped pages; the plane keeps the mapping open.
+	if(RawImage::IsRawPath(path)) {
+		RawImageInfo info;
+		const char* error = nullptr;
+		plane.pixels = RawImage::MapPlane(path, info, error);
+		if(!plane.pixels)
+			return Fail(GenerateStatus::LoadFailed, "Failed to load: " + path + " (" + error + ")");
+		plane.width = info.width;
+		plane.height = info.height;
+		plane.bitDepth = info.bitDepth;
+		return ORMResult();
+	}
+
+	unsigned char* pixels = static_cast<unsigned char*>(IOService::LoadGrayscale(path, plane.width, plane.height, plane.bitDepth));
+	if(!pixels)
+		return Fail(GenerateStatus::LoadFailed, "Failed to load: " + path + " (" + IOService::GetLastError() + ")");
+
+	plane.pixels = std::shared_ptr<unsigned char>(pixels, IOService::FreePixels);
+	return ORMResult();
+}
+
+[[nodiscard]] ORMResult ORMGenerator::ResampleSources(ORMSources& sources, const ORMJob& job) const
+{
+	if(job.outputSize <= 0)
+		return ORMResult();
+
+	GrayscalePlane* planes[3] = { &sources.ao, &sources.roughness, &sources.metallic };
+
+	// The largest source carries the most detail; its aspect ratio decides the output shape.
+	const GrayscalePlane* reference = planes[0];
+	for(const GrayscalePlane* plane : planes) {
+		if(static_cast<size_t>(plane->width) * plane->height > static_cast<size_t>(reference->width) * reference->height)
+			reference = plane;
+	}
+
+	const double scale = static_cast<double>(job.outputSize) / std::max(reference->width, reference->height);
+	const int width = std::max(1, static_cast<int>(reference->width * scale + 0.5));
+	const int height = std::max(1, static_cast<int>(reference->height * scale + 0.5));
+
+	for(GrayscalePlane* plane : planes) {
+		if(plane->width == width && plane->height == height)
+			continue;
+
+		// A new plane: the original may be shared with the decode cache or the UI.
+		ResampledImage resized = resampler.Resize(plane->pixels.get(), plane->width, plane->height, 1, width, height, plane->bitDepth);
+		if(!resized.pixels)
+			return Fail(GenerateStatus::SizeMismatch, "Cannot resample " + std::to_string(plane->width) + "x" +
+				std::to_string(plane->height) + " to " + std::to_string(width) + "x" + std::to_string(height));
+
+		plane->pixels = std::move(resized.pixels);
+		plane->width = width;
+		plane->height = height;
+	}
+	return ORMResult();
+}
+
+[[nodiscard]] ORMResult ORMGenerator::ValidateSources(const ORMSources& sources)
+{
+	const GrayscalePlane& ao = sources.ao;
+	const GrayscalePlane& rough = sources.roughness;
+	const GrayscalePlane& metal = sources.metallic;
+
+	if(ao.width != rough.width || ao.width != metal.width || ao.height != rough.height || ao.height != metal.height)
+		return Fail(GenerateStatus::SizeMismatch,
+			"AO " + std::to_string(ao.width) + "x" + std::to_string(ao.height) +
+			", Roughness " + std::to_string(rough.width) + "x" + std::to_string(rough.height) +
+			", Metallic " + std::to_string(metal.width) + "x" + std::to_string(metal.height));
+
+	return ORMResult();
+}
+
+[[nodiscard]] ORMResult ORMGenerator::ConvertSources(ORMSources& sources, int bitDepth) const
+{
+	for(GrayscalePlane* plane : { &sources.ao, &sources.roughness, &sources.metallic }) {
+		if(plane->bitDepth == bitDepth || plane->bitDepth == 32 || !plane->pixels)
+			continue;
+
+		// A new plane: the original may be shared with the decode cache or the UI.
+		const size_t count = static_cast<size_t>(plane->width) * plane->height;
+		std::shared_ptr<unsigned char> converted = BufferPool::AllocateShared(count * (bitDepth == 16 ? 2 : 1));
+		if(!converted)
+			return Fail(GenerateStatus::WriteFailed, "Out of memory converting a " + std::to_string(plane->width) + "x" +
+				std::to_string(plane->height) + " plane to " + std::to_string(bitDepth) + "-bit");
+		const size_t tileSamples = ORM::PackTileBytes / 3;
+		const size_t tileCount = (count + tileSamples - 1) / tileSamples;
+		pool.ParallelFor(tileCount, [&] (size_t tile) {
+			const size_t first = tile * tileSamples;
+			const size_t samples = std::min(tileSamples, count - first);
+			if(bitDepth == 16)
+				ChannelKernels::WidenTo16(plane->pixels.get() + first, reinterpret_cast<uint16_t*>(converted.get()) + first, samples);
+			else
+				ChannelKernels::NarrowTo8(reinterpret_cast<const uint16_t*>(plane->pixels.get()) + first, converted.get() + first, samples);
+		});
+
+		plane->pixels = std::move(converted);
+		plane->bitDepth = bitDepth;
+	}
+	return ORMResult();
+}
+
+int ORMGenerator::GetOutputBitDepth(const ORMSources& sources, const ORMJob& job)
+{
+	if(job.outputBitDepth == 8 || job.outputBitDepth == 16)
+		return job.outputBitDepth;
+	const int deepest = std::max({ sources.ao.bitDepth, sources.roughness.bitDepth, sources.metallic.bitDepth });
+	return deepest > 8 ? 16 : 8;
+}
+
+[[nodiscard]] ORMResult ORMGenerator::Pack(const ORMSources& sources, const ORMJob& job, ORMPackedImage& packed,
+	const ProgressFn& progress) const
+{
+	ORMSources eight = sources;
+	ORMResult converted = ConvertSources(eight, 8);
+	if(!converted.Succeeded())
+		return converted;
+
+	const int width = sources.ao.width;
+	const int height = sources.ao.height;
+	const size_t count = static_cast<size_t>(width) * height;
+
+	packed.width = width;
+	packed.height = height;
+	packed.unrealRGB.assign(job.generateUnreal ? count * 3 : 0, 0);
+	packed.unityRGBA.assign(job.generateUnity ? count * 4 : 0, 0);
+
+	ORMPackTargets targets;
+	targets.unrealRGB = job.generateUnreal ? packed.unrealRGB.data() : nullptr;
+	targets.unityRGBA = job.generateUnity ? packed.unityRGBA.data() : nullptr;
+
+	const ORMPackSource source = MakePackSource(eight, 8, job.quantize);
+	packer.Pack(source, targets, progress);
+	return ORMResult();
+}
+
+[[nodiscard]] ORMResult ORMGenerator::WriteOutputs(const ORMSources& sources, const ORMJob& job, const ProgressFn& progress,
+	PngStreamStats* stats) const
+{
+	if(!job.generateUnreal && !job.generateUnity)
+		return Fail(GenerateStatus::NothingToDo, "No output selected");
+
+	// Level 0 writes the sources at the output depth; every further level halves the previous one.
+	std::vector<ORMSources> levels(1, sources);
+	ORMResult converted = ConvertSources(levels[0], GetOutputBitDepth(sources, job));
+	if(!converted.Succeeded())
+		return converted;
+	std::vector<ORMLevelReport> reports(1);
+	reports[0].width = sources.ao.width;
+	reports[0].height = sources.ao.height;
+	for(int i = 0; i < job.ladderLevels; ++i) {
+		const ORMSources& parent = levels.back();
+		if(parent.ao.width <= 1 && parent.ao.height <= 1)
+			break;
+
+		const auto start = Clock::now();
+		ORMSources half;
+		if(!HalveSources(resampler, parent, half))
+			return Fail(GenerateStatus::WriteFailed, "Out of memory downsampling the " + std::to_string(std::max(1, parent.ao.width / 2)) +
+				"x" + std::to_string(std::max(1, parent.ao.height / 2)) + " ladder level");
+
+		ORMLevelReport report;
+		report.width = half.ao.width;
+		report.height = half.ao.height;
+		report.downsampleMilliseconds = MillisecondsSince(start);
+		levels.push_back(std::move(half));
+		reports.push_back(report);
+	}
+
+	// Progress is the pixel-weighted sum over all levels, reported monotonically.
+	std::vector<double> weights(levels.size());
+	double totalPixels = 0.0;
+	for(size_t i = 0; i < levels.size(); ++i) {
+		weights[i] = static_cast<double>(levels[i].ao.width) * levels[i].ao.height;
+		totalPixels += weights[i];
+	}
+	std::vector<float> fractions(levels.size(), 0.0f);
+	std::mutex progressMutex;
+	float reported = 0.0f;
+
+	std::vector<ORMResult> results(levels.size());
+	pool.ParallelFor(levels.size(), [&] (size_t level) {
+		ORMJob levelJob = job;
+		if(level > 0) {
+			const int size = std::max(reports[level].width, reports[level].height);
+			levelJob.unrealPath = GetLadderPath(job.unrealPath, size);
+			levelJob.unityPath = GetLadderPath(job.unityPath, size);
+		}
+
+		ProgressFn levelProgress;
+		if(progress) {
+			levelProgress = [&, level] (float fraction) {
+				std::lock_guard<std::mutex> lock(progressMutex);
+				fractions[level] = fraction;
+				double total = 0.0;
+				for(size_t i = 0; i < fractions.size(); ++i)
+					total += weights[i] / totalPixels * fractions[i];
+				if(static_cast<float>(total) > reported) {
+					reported = static_cast<float>(total);
+					progress(reported);
+				}
+			};
+		}
+
+		const auto start = Clock::now();
+		results[level] = WriteLevel(levels[level], levelJob, levelProgress, level == 0 ? stats : nullptr);
+		reports[level].encodeMilliseconds = MillisecondsSince(start);
+	});
+
+	for(ORMResult& written : results) {
+		if(!written.Succeeded())
+			return std::move(written);
+	}
+
+	ORMResult result;
+	result.levels = std::move(reports);
+	return result;
+}
+
+std::string ORMGenerator::GetLadderPath(const std::string& path, int size)
+{
+	const std::filesystem::path file(path);
+	std::filesystem::path ladder = file.parent_path();
+	ladder /= file.stem().string() + "_" + std::to_string(size) + file.extension().string();
+	return ladder.string();
+}
+
+std::string ORMGenerator::GetCompanionPath(const std::string& path, std::string_view extension, std::string_view suffix)
+{
+	const std::filesystem::path file(path);
+	std::filesystem::path companion = file.parent_path();
+	companion /= file.stem().string() + std::string(suffix) + std::string(extension);
+	return companion.string();
+}
+
+[[nodiscard]] ORMResult ORMGenerator::WriteLevel(const ORMSources& sources, const ORMJob& job, const ProgressFn& progress,
+	PngStreamStats* stats) const
+{
+	// .ormraw outputs skip the codec; everything else is a PNG. Both share the packing fill.
+	std::vector<PngStreamOutput> outputs;
+	std::vector<RawImageOutput> rawOutputs;
+	auto addOutput = [&] (bool enabled, const std::string& path, ORMLayout layout) {
+		if(!enabled) return;
+		const int channels = ORMPacker::GetChannelCount(layout);
+		if(RawImage::IsRawPath(path)) rawOutputs.push_back(RawImageOutput{ path, channels });
+		else outputs.push_back(PngStreamOutput{ path, channels });
+	};
+	addOutput(job.generateUnreal, job.unrealPath, ORMLayout::Unreal_RGB);
+	addOutput(job.generateUnity, job.unityPath, ORMLayout::Unity_RGBA);
+	if(outputs.empty() && rawOutputs.empty())
+		return Fail(GenerateStatus::NothingToDo, "No output selected");
+
+	const int bitDepth = GetOutputBitDepth(sources, job);
+	for(PngStreamOutput& output : outputs)
+		output.bitDepth = bitDepth;
+
+	const ORMPackSource source = MakePackSource(sources, bitDepth, job.quantize);
+
+	// Each strip reads the source rows once and packs every requested layout of one writer from them.
+	auto makeFill = [&] (bool raw) {
+		return [&, raw] (int firstRow, int rowCount, unsigned char* const* rows) {
+			ORMPackTargets targets;
+			size_t next = 0;
+			if(job.generateUnreal && RawImage::IsRawPath(job.unrealPath) == raw) targets.unrealRGB = rows[next++];
+			if(job.generateUnity && RawImage::IsRawPath(job.unityPath) == raw) targets.unityRGBA = rows[next++];
+			ORMPacker::PackRows(source, targets, firstRow, rowCount);
+		};
+	};
+
+	if(!rawOutputs.empty()) {
+		int failed = -1;
+		if(!RawImage::WriteInterleaved(rawOutputs, source.width, source.height, bitDepth, makeFill(true), &failed))
+			return Fail(GenerateStatus::WriteFailed, "Failed to write: " + rawOutputs[std::max(failed, 0)].path);
+	}
+
+	PngWriteOptions options;
+	options.compressionLevel = job.pngCompressionLevel;
+
+	PngStreamStats localStats;
+	PngStreamStats& result = stats ? *stats : localStats;
+	if(!outputs.empty() && !pngWriter.WriteStreams(outputs, source.width, source.height, makeFill(false), options, &result, progress)) {
+		const std::string& path = result.failedOutput >= 0 ? outputs[result.failedOutput].path : outputs.front().path;
+		return Fail(GenerateStatus::WriteFailed, "Failed to write: " + path);
+	}
+
+	if(job.blockFormat == BlockFormat::None && !job.generateKtx2)
+		return ORMResult();
+
+	// DDS and KTX2 hold 8-bit texels only; float planes stay float and are quantized as they are read.
+	ORMSources eight = sources;
+	ORMResult converted = ConvertSources(eight, 8);
+	if(!converted.Succeeded())
+		return converted;
+	const ORMPackSource eightSource = MakePackSource(eight, 8, job.quantize);
+	ORMResult written = WriteBlockCompressed(eightSource, job);
+	return written.Succeeded() ? WriteKtx2(eight, job) : written;
+}
+
+[[nodiscard]] ORMResult ORMGenerator::WriteBlockCompressed(const ORMPackSource& source, const ORMJob& job) const
+{
+	if(job.blockFormat == BlockFormat::None)
+		return ORMResult();
+
+	const int width = source.width;
+	const int height = source.height;
+	// No blocks means a band's rows could not be allocated.
+	auto write = [&] (const std::string& path, BlockFormat format, std::vector<unsigned char>&& blocks) {
+		if(blocks.empty())
+			return Fail(GenerateStatus::WriteFailed, "Out of memory compressing: " + path);
+		std::vector<std::vector<unsigned char>> levels;
+		levels.push_back(std::move(blocks));
+		return DdsWriter::Write(path, width, height, format, levels)
+			? ORMResult() : Fail(GenerateStatus::WriteFailed, "Failed to write: " + path);
+	};
+
+	if(job.blockFormat == BlockFormat::BC7) {
+		// Packed rows are produced band by band, as for the PNGs.
+		const ORMLayout layouts[] = { ORMLayout::Unreal_RGB, ORMLayout::Unity_RGBA };
+		for(ORMLayout layout : layouts) {
+			const bool unreal = layout == ORMLayout::Unreal_RGB;
+			if(!(unreal ? job.generateUnreal : job.generateUnity))
+				continue;
+
+			const int channels = ORMPacker::GetChannelCount(layout);
+			std::vector<unsigned char> blocks = blockCompressor.Compress(width, height, channels, BlockFormat::BC7, job.blockQuality,
+				[&] (int firstRow, int rowCount, unsigned char* rows) {
+					ORMPackTargets targets;
+					(unreal ? targets.unrealRGB : targets.unityRGBA) = rows;
+					ORMPacker::PackRows(source, targets, firstRow, rowCount);
+				});
+
+			ORMResult result = write(GetCompanionPath(unreal ? job.unrealPath : job.unityPath, ".dds"), BlockFormat::BC7, std::move(blocks));
+			if(!result.Succeeded())
+				return result;
+		}
+		return ORMResult();
+	}
+
+	// Per-channel files are named after the first packed output. Float planes are quantized band by band.
+	const std::string& basePath = job.generateUnreal ? job.unrealPath : job.unityPath;
+	auto writePlane = [&] (const unsigned char* plane, bool isFloat, std::string_view suffix) {
+		std::vector<unsigned char> blocks = isFloat
+			? blockCompressor.Compress(width, height, 1, BlockFormat::BC4, job.blockQuality,
+				[&] (int firstRow, int rowCount, unsigned char* rows) { GetPlaneRows(source, plane, true, firstRow, rowCount, rows); })
+			: blockCompressor.Compress(plane, width, height, 1, BlockFormat::BC4, job.blockQuality);
+		return write(GetCompanionPath(basePath, ".dds", suffix), BlockFormat::BC4, std::move(blocks));
+	};
+
+	ORMResult result = writePlane(source.ao, source.aoFloat, "_AO");
+	if(!result.Succeeded())
+		return result;
+
+	if(job.blockFormat == BlockFormat::BC4) {
+		result = writePlane(source.roughness, source.roughnessFloat, "_Roughness");
+		return result.Succeeded() ? writePlane(source.metallic, source.metallicFloat, "_Metallic") : result;
+	}
+
+	std::atomic<bool> allocated{ true };
+	std::vector<unsigned char> blocks = blockCompressor.Compress(width, height, 2, BlockFormat::BC5, job.blockQuality,
+		[&] (int firstRow, int rowCount, unsigned char* rows) {
+			const size_t count = static_cast<size_t>(rowCount) * width;
+			const bool quantized = source.roughnessFloat || source.metallicFloat;
+			PooledBuffer scratch(quantized ? count * 2 : 0);
+			if(quantized && !scratch.GetData()) {
+				allocated = false;
+				return;
+			}
+			const unsigned char* roughness = GetPlaneRows(source, source.roughness, source.roughnessFloat, firstRow, rowCount, scratch.GetData());
+			const unsigned char* metallic = GetPlaneRows(source, source.metallic, source.metallicFloat, firstRow, rowCount,
+				source.metallicFloat ? scratch.GetData() + count : nullptr);
+			for(size_t i = 0; i < count; ++i) {
+				rows[i * 2] = roughness[i];
+				rows[i * 2 + 1] = metallic[i];
+			}
+		});
+	if(!allocated)
+		blocks.clear();
+	return write(GetCompanionPath(basePath, ".dds", "_RoughnessMetallic"), BlockFormat::BC5, std::move(blocks));
+}
+
+[[nodiscard]] ORMResult ORMGenerator::WriteKtx2(const ORMSources& sources, const ORMJob& job) const
+{
+	if(!job.generateKtx2)
+		return ORMResult();
+	if(job.ktx2ZstdLevel > 0 && !Ktx2Writer::SupportsZstd())
+		return Fail(GenerateStatus::WriteFailed, "Zstandard supercompression is not available in this build");
+
+	// Mip planes halve the previous level, down to 1x1.
+	const int mipCount = Ktx2Writer::GetFullMipCount(sources.ao.width, sources.ao.height);
+	std::vector<ORMSources> mips(1, sources);
+	while(static_cast<int>(mips.size()) < mipCount) {
+		const ORMSources& parent = mips.back();
+		ORMSources half;
+		if(!HalveSources(resampler, parent, half))
+			return Fail(GenerateStatus::WriteFailed, "Out of memory downsampling KTX2 mip " + std::to_string(mips.size()));
+		mips.push_back(std::move(half));
+	}
+
+	std::vector<ORMLayout> layouts;
+	if(job.generateUnreal) layouts.push_back(ORMLayout::Unreal_RGB);
+	if(job.generateUnity) layouts.push_back(ORMLayout::Unity_RGBA);
+
+	// Every level of every layout is packed, encoded and supercompressed as its own task.
+	std::vector<std::vector<Ktx2Level>> files(layouts.size(), std::vector<Ktx2Level>(mips.size()));
+	std::atomic<bool> compressed{ true };
+	std::atomic<bool> allocated{ true };
+	pool.ParallelFor(layouts.size() * mips.size(), [&] (size_t task) {
+		const ORMLayout layout = layouts[task / mips.size()];
+		const ORMSources& mip = mips[task % mips.size()];
+		Ktx2Level& level = files[task / mips.size()][task % mips.size()];
+
+		const ORMPackSource source = MakePackSource(mip, 8, job.quantize);
+		const int channels = ORMPacker::GetChannelCount(layout);
+		if(job.ktx2Format == BlockFormat::BC7) {
+			level.data = blockCompressor.Compress(source.width, source.height, channels, BlockFormat::BC7, job.blockQuality,
+				[&] (int firstRow, int rowCount, unsigned char* rows) {
+					ORMPackTargets targets;
+					(layout == ORMLayout::Unreal_RGB ? targets.unrealRGB : targets.unityRGBA) = rows;
+					ORMPacker::PackRows(source, targets, firstRow, rowCount);
+				});
+			if(level.data.empty()) {
+				allocated = false;
+				return;
+			}
+		}
+		else {
+			level.data.resize(static_cast<size_t>(source.width) * source.height * channels);
+			packer.Pack(source, layout, level.data.data());
+		}
+
+		level.uncompressedBytes = level.data.size();
+		if(job.ktx2ZstdLevel > 0 && !Ktx2Writer::Supercompress(level, job.ktx2ZstdLevel))
+			compressed = false;
+	});
+
+	if(!allocated)
+		return Fail(GenerateStatus::WriteFailed, "Out of memory compressing KTX2 levels");
+	if(!compressed)
+		return Fail(GenerateStatus::WriteFailed, "Zstandard supercompression failed");
+
+	const BlockFormat format = job.ktx2Format == BlockFormat::BC7 ? BlockFormat::BC7 : BlockFormat::None;
+	for(size_t i = 0; i < layouts.size(); ++i) {
+		const bool unreal = layouts[i] == ORMLayout::Unreal_RGB;
+		const std::string path = GetCompanionPath(unreal ? job.unrealPath : job.unityPath, ".ktx2");
+		if(!Ktx2Writer::Write(path, sources.ao.width, sources.ao.height, ORMPacker::GetChannelCount(layouts[i]), format,
+			files[i], job.ktx2ZstdLevel > 0))
+			return Fail(GenerateStatus::WriteFailed, "Failed to write: " + path);
+	}
+	return ORMResult();
+}
+
+std::string_view ORMGenerator::GetStatusString(GenerateStatus status)
+{
+	switch(status)
+	{
+	case GenerateStatus::Success: return "Success";
+	case GenerateStatus::LoadFailed: return "Failed to load source image";
+	case GenerateStatus::SizeMismatch: return "Source sizes do not match";
+	case GenerateStatus::WriteFailed: return "Failed to write output image";
+	case GenerateStatus::NothingToDo: return "No output selected";
+	default: return "Unknown error";
+	}
+}
@@ -0,0 +1,232 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "ImageResampler.h"
+#include "ORMPacker.h"
+#include "PngWriter.h"
+
+class DecodeCache;
+class ThreadPool;
+
+enum class GenerateStatus
+{
+	Success,
+	LoadFailed,
+	SizeMismatch,
+	WriteFailed,
+	NothingToDo
+};
+
+/**
+ * Struct: ORMJob
+ *
+ * Describes one material: three grayscale source files and the packed outputs to write.
+ */
+struct ORMJob
+{
+	std::string name;
+	std::string aoPath;
+	std::string roughnessPath;
+	std::string metallicPath;
+
+	/** A path ending in .ormraw gets an uncompressed RawImage instead of a PNG. */
+	std::string unrealPath = "orm_unreal.png";
+	std::string unityPath = "orm_unity.png";
+	bool generateUnreal = true;
+	bool generateUnity = true;
+
+	/** Deflate level for the PNG outputs (0-9). */
+	int pngCompressionLevel = Deflate::DefaultLevel;
+
+	/**
+	 * Bits per channel of the PNG outputs: 8, 16, or 0 to follow the sources (16 as soon as one
+	 * source is 16-bit or float). Sources of the other depth are converted; DDS and KTX2 stay 8-bit.
+	 */
+	int outputBitDepth = 0;
+
+	/** Rounding of float (HDR / EXR) sources to the output depth. */
+	QuantizeMode quantize = QuantizeMode::Nearest;
+
+	/**
+	 * Long edge of the packed outputs in pixels; every source is resampled to it, keeping the
+	 * aspect ratio of the largest source. 0 keeps the source size, which must then match.
+	 */
+	int outputSize = 0;
+
+	/**
+	 * Extra outputs, each half the size of the previous one, written next to the main
+	 * outputs with the long edge as a suffix (Rock_ORM_1024.png). All levels come from
+	 * the same decoded sources and are encoded concurrently.
+	 */
+	int ladderLevels = 0;
+
+	/**
+	 * Block-compressed DDS files written next to the PNG outputs. BC7 stores each packed layout
+	 * (Rock_ORM.png -> Rock_ORM.dds); BC5 stores roughness + metallic in one file plus AO as BC4
+	 * (_RoughnessMetallic.dds, _AO.dds); BC4 stores one file per channel (_AO, _Roughness, _Metallic).
+	 */
+	BlockFormat blockFormat = BlockFormat::None;
+	BlockQuality blockQuality = BlockQuality::Normal;
+
+	/**
+	 * KTX2 file of each packed layout (Rock_ORM.png -> Rock_ORM.ktx2) holding the full mip chain,
+	 * as 8-bit texels (ktx2Format None) or BC7 blocks. ktx2ZstdLevel > 0 supercompresses every
+	 * level with Zstandard, which needs a build with ORM_HAS_ZSTD.
+	 */
+	bool generateKtx2 = false;
+	BlockFormat ktx2Format = BlockFormat::None;
+	int ktx2ZstdLevel = 0;
+
+	/** Keep the packed Unreal RGB pixels in the result (used by the preview). */
+	bool keepUnrealPixels = false;
+};
+
+/** Timing of one output size; level 0 is the full-size output. Levels encode concurrently, so times overlap. */
+struct ORMLevelReport
+{
+	int width = 0;
+	int height = 0;
+	double downsampleMilliseconds = 0.0;
+	double encodeMilliseconds = 0.0;
+};
+
+struct ORMResult
+{
+	GenerateStatus status = GenerateStatus::Success;
+	std::string message;
+	int width = 0;
+	int height = 0;
+
+	/** One entry per written output size, filled by WriteOutputs(). */
+	std::vector<ORMLevelReport> levels;
+
+	/** Packed Unreal RGB pixels, only filled when ORMJob::keepUnrealPixels is set and no preview callback is given. */
+	std::vector<unsigned char> unrealPixels;
+
+	bool Succeeded() const { return status == GenerateStatus::Success; }
+};
+
+/**
+ * Decoded single-channel source image of 8 or 16 bits per sample (16-bit samples are native-endian
+ * uint16_t behind the byte pointer), or 32 for linear float samples from HDR / EXR files.
+ * Immutable once loaded, so it can be shared between threads.
+ */
+struct GrayscalePlane
+{
+	std::shared_ptr<unsigned char> pixels;
+	int width = 0;
+	int height = 0;
+	int bitDepth = 8;
+};
+
+struct ORMSources
+{
+	GrayscalePlane ao;
+	GrayscalePlane roughness;
+	GrayscalePlane metallic;
+};
+
+/** Packed 8-bit outputs of one material (the preview); a layout that was not requested stays empty. */
+struct ORMPackedImage
+{
+	std::vector<unsigned char> unrealRGB;
+	std::vector<unsigned char> unityRGBA;
+	int width = 0;
+	int height = 0;
+};
+
+/**
+ * Class: ORMGenerator
+ *
+ * Window-independent ORM generation: decodes the three sources, packs them with
+ * ORMPacker and writes the requested outputs. Used by both the UI and the
+ * headless command line, and never touches OpenGL. Outputs are encoded with
+ * the strip-parallel PngWriter on the same pool as the packer.
+ *
+ * Notes:
+ * - Generate() runs the whole material on the calling thread (packing and
+ *   resampling themselves are parallel). The individual stages are public so schedulers such as
+ *   BatchRunner can run decode, prepare and encode as separate pipeline stages.
+ * - WriteOutputs() packs and encodes strip by strip, so the full-size packed
+ *   images are never allocated; Pack() is only used when the caller needs
+ *   the packed pixels themselves (the UI preview).
+ * - 16-bit sources stay 16-bit through resampling, packing and PNG encoding.
+ *   WriteOutputs() first converts all three planes to the output depth, so
+ *   mixed 8/16-bit sources are fine. Float sources stay float through
+ *   resampling and the ladder and are quantized row by row inside the
+ *   packer (ORMJob::quantize), never as a separate pass over the image.
+ * - Block-compressed outputs are encoded after the PNGs of the same level,
+ *   also band by band from the source planes. KTX2 mip chains halve the planes
+ *   like the ladder does, then pack, encode and supercompress every level in
+ *   parallel; unlike the PNGs, each packed level is held in memory.
+ * - .ormraw sources (RawImage) are not decoded at all: the plane points into
+ *   the file mapping. .ormraw outputs are written interleaved from the same
+ *   packing fill as the PNGs, without any encoder.
+ * - Resolution ladders halve the source planes rather than the packed image:
+ *   packing is per pixel, so the result is the same up to rounding, and the
+ *   planes are less than half the bytes.
+ */
+class ORMGenerator
+{
+public:
+	using ProgressFn = std::function<void(float)>;
+
+	/** Receives the packed Unreal preview before the outputs are encoded. */
+	using PreviewFn = std::function<void(ORMPackedImage&&)>;
+
+	/** Sources are decoded through cache when one is given, otherwise always from disk. */
+	explicit ORMGenerator(ThreadPool& pool, DecodeCache* cache = nullptr);
+
+	[[nodiscard]] ORMResult Generate(const ORMJob& job, const ProgressFn& progress = nullptr) const;
+
+	/**
+	 * Like Generate(job), but reuses already decoded planes; any plane without pixels is loaded from the job.
+	 * With keepUnrealPixels and onPreview set, the packed pixels go to onPreview instead of the result.
+	 */
+	[[nodiscard]] ORMResult Generate(ORMSources sources, const ORMJob& job, const ProgressFn& progress = nullptr,
+		const PreviewFn& onPreview = nullptr) const;
+
+	// Stages
+	[[nodiscard]] ORMResult LoadSource(const std::string& path, GrayscalePlane& plane) const;
+	[[nodiscard]] static ORMResult DecodeSource(const std::string& path, GrayscalePlane& plane);
+	[[nodiscard]] ORMResult ResampleSources(ORMSources& sources, const ORMJob& job) const;
+	[[nodiscard]] static ORMResult ValidateSources(const ORMSources& sources);
+
+	/**
+	 * Converts the integer planes to bitDepth (8 or 16); float planes are left for the packer to quantize.
+	 * Fails with WriteFailed when a converted plane cannot be allocated.
+	 */
+	[[nodiscard]] ORMResult ConvertSources(ORMSources& sources, int bitDepth) const;
+	[[nodiscard]] ORMResult Pack(const ORMSources& sources, const ORMJob& job, ORMPackedImage& packed, const ProgressFn& progress = nullptr) const;
+	[[nodiscard]] ORMResult WriteOutputs(const ORMSources& sources, const ORMJob& job, const ProgressFn& progress = nullptr,
+		PngStreamStats* stats = nullptr) const;
+
+	/** Bit depth the PNG outputs of job get for these sources. */
+	static int GetOutputBitDepth(const ORMSources& sources, const ORMJob& job);
+
+	/** Output path of a ladder level: the long edge is appended to the file name. */
+	static std::string GetLadderPath(const std::string& path, int size);
+
+	/** Path of a DDS / KTX2 output next to a PNG one: the extension is replaced and suffix appended to the file name. */
+	static std::string GetCompanionPath(const std::string& path, std::string_view extension, std::string_view suffix = {});
+
+	static std::string_view GetStatusString(GenerateStatus status);
+
+private:
+	[[nodiscard]] ORMResult WriteLevel(const ORMSources& sources, const ORMJob& job, const ProgressFn& progress,
+		PngStreamStats* stats) const;
+	[[nodiscard]] ORMResult WriteBlockCompressed(const ORMPackSource& source, const ORMJob& job) const;
+	[[nodiscard]] ORMResult WriteKtx2(const ORMSources& sources, const ORMJob& job) const;
+
+	ThreadPool& pool;
+	ORMPacker packer;
+	ImageResampler resampler;
+	PngWriter pngWriter;
+	BlockCompressor blockCompressor;
+	DecodeCache* cache;
+};
@@ -0,0 +1,122 @@
+#include "ORMPacker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "ChannelKernels.h"
+#include "Constants.h"
+#include "ThreadPool.h"
+
+ORMPacker::ORMPacker(ThreadPool& pool) : pool(pool)
+{
+}
+
+void ORMPacker::Pack(const ORMPackSource& src, ORMLayout layout, unsigned char* dst, const ProgressFn& progress) const
+{
+	ORMPackTargets targets;
+	if(layout == ORMLayout::Unreal_RGB)
+		targets.unrealRGB = dst;
+	else
+		targets.unityRGBA = dst;
+
+	Pack(src, targets, progress);
+}
+
+void ORMPacker::Pack(const ORMPackSource& src, const ORMPackTargets& targets, const ProgressFn& progress) const
+{
+	if(src.width <= 0 || src.height <= 0 || (!targets.unrealRGB && !targets.unityRGBA))
+		return;
+
+	const size_t width = static_cast<size_t>(src.width);
+	const size_t sampleBytes = src.bitDepth == 16 ? 2 : 1;
+	const int packedBytes = (targets.unrealRGB ? 3 : 0) + (targets.unityRGBA ? 4 : 0);
+	const int rowsPerTile = GetRowsPerTile(src.width * static_cast<int>(sampleBytes), packedBytes);
+	const size_t tileCount = (static_cast<size_t>(src.height) + rowsPerTile - 1) / rowsPerTile;
+
+	std::atomic<size_t> tilesDone{ 0 };
+	std::mutex progressMutex;
+	size_t reportedTiles = 0;
+
+	pool.ParallelFor(tileCount, [&] (size_t tile) {
+		const int firstRow = static_cast<int>(tile) * rowsPerTile;
+		const int rows = std::min(rowsPerTile, src.height - firstRow);
+		const size_t offset = static_cast<size_t>(firstRow) * width * sampleBytes;
+
+		ORMPackTargets tileTargets;
+		tileTargets.unrealRGB = targets.unrealRGB ? targets.unrealRGB + offset * 3 : nullptr;
+		tileTargets.unityRGBA = targets.unityRGBA ? targets.unityRGBA + offset * 4 : nullptr;
+		PackRows(src, tileTargets, firstRow, rows);
+
+		const size_t finished = tilesDone.fetch_add(1) + 1;
+		if(progress) {
+			std::lock_guard<std::mutex> lock(progressMutex);
+			if(finished > reportedTiles) {
+				reportedTiles = finished;
+				progress(static_cast<float>(finished) / tileCount);
+			}
+		}
+	});
+}
+
+void ORMPacker::PackRows(const ORMPackSource& src, const ORMPackTargets& targets, int firstRow, int rowCount)
+{
+	if(src.bitDepth == 16)
+		PackRowsOf<uint16_t>(src, targets, firstRow, rowCount);
+	else
+		PackRowsOf<uint8_t>(src, targets, firstRow, rowCount);
+}
+
+template<typename T>
+void ORMPacker::PackRowsOf(const ORMPackSource& src, const ORMPackTargets& targets, int firstRow, int rowCount)
+{
+	T* unreal = reinterpret_cast<T*>(targets.unrealRGB);
+	T* unity = reinterpret_cast<T*>(targets.unityRGBA);
+	auto packSpan = [&] (const T* ao, const T* rough, const T* metal, size_t count, size_t pixel) {
+		if(unreal && unity)
+			ChannelKernels::PackUnrealAndUnity(ao, rough, metal, unreal + pixel * 3, unity + pixel * 4, count);
+		else if(unreal)
+			ChannelKernels::PackUnrealRGB(ao, rough, metal, unreal + pixel * 3, count);
+		else if(unity)
+			ChannelKernels::PackUnityRGBA(ao, rough, metal, unity + pixel * 4, count);
+	};
+
+	const size_t width = static_cast<size_t>(src.width);
+	const size_t offset = static_cast<size_t>(firstRow) * width;
+	if(!src.aoFloat && !src.roughnessFloat && !src.metallicFloat) {
+		packSpan(reinterpret_cast<const T*>(src.ao) + offset, reinterpret_cast<const T*>(src.roughness) + offset,
+			reinterpret_cast<const T*>(src.metallic) + offset, static_cast<size_t>(rowCount) * width, 0);
+		return;
+	}
+
+	// Float planes are quantized one row at a time into a scratch row that stays in cache
+	// until the pack kernel reads it, so no quantized copy of the plane is ever made.
+	std::vector<T> scratch(width * 3);
+	auto row = [&] (const unsigned char* plane, bool isFloat, int index, int y) -> const T* {
+		const size_t start = static_cast<size_t>(y) * width;
+		if(!isFloat)
+			return reinterpret_cast<const T*>(plane) + start;
+		T* quantized = scratch.data() + width * index;
+		ChannelKernels::Quantize(reinterpret_cast<const float*>(plane) + start, quantized, width, src.quantize, 0, y);
+		return quantized;
+	};
+
+	for(int y = firstRow; y < firstRow + rowCount; ++y) {
+		packSpan(row(src.ao, src.aoFloat, 0, y), row(src.roughness, src.roughnessFloat, 1, y), row(src.metallic, src.metallicFloat, 2, y),
+			width, static_cast<size_t>(y - firstRow) * width);
+	}
+}
+
+int ORMPacker::GetRowsPerTile(int width, int packedBytesPerPixel)
+{
+	// Each packed pixel touches three source bytes plus its packed output bytes.
+	const size_t bytesPerRow = static_cast<size_t>(std::max(width, 1)) * (3 + std::max(packedBytesPerPixel, 0));
+	return static_cast<int>(std::max<size_t>(1, ORM::PackTileBytes / bytesPerRow));
+}
+
+int ORMPacker::GetChannelCount(ORMLayout layout)
+{
+	return layout == ORMLayout::Unity_RGBA ? 4 : 3;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+#include "ChannelKernels.h"
+
+class ThreadPool;
+
+/** Channel layout of a packed ORM texture. */
+enum class ORMLayout
+{
+	Unreal_RGB,   // AO (R), Roughness (G), Metallic (B)
+	Unity_RGBA    // Metallic (R), AO (G), White (B), Inverted Roughness (A)
+};
+
+/**
+ * Struct: ORMPackSource
+ *
+ * Three planar grayscale inputs of identical size and bit depth.
+ * The packer only reads from these pointers; ownership stays with the caller.
+ * With a bitDepth of 16 the pointers hold native-endian uint16_t samples, and
+ * the targets receive 16-bit samples as well.
+ * A plane flagged as float holds linear float samples instead (HDR / EXR
+ * sources); it is quantized to bitDepth row by row as part of packing.
+ */
+struct ORMPackSource
+{
+	const unsigned char* ao = nullptr;
+	const unsigned char* roughness = nullptr;
+	const unsigned char* metallic = nullptr;
+	int width = 0;
+	int height = 0;
+	int bitDepth = 8;
+	bool aoFloat = false;
+	bool roughnessFloat = false;
+	bool metallicFloat = false;
+	QuantizeMode quantize = QuantizeMode::Nearest;
+};
+
+/**
+ * Struct: ORMPackTargets
+ *
+ * Output buffers for one packing pass. A null pointer skips that layout;
+ * when both are set, each source row is read once and emitted to both.
+ */
+struct ORMPackTargets
+{
+	unsigned char* unrealRGB = nullptr;
+	unsigned char* unityRGBA = nullptr;
+};
+
+/**
+ * Class: ORMPacker
+ *
+ * Interleaves planar AO/Roughness/Metallic data into a packed ORM image.
+ * The image is split into horizontal row tiles sized to ORM::PackTileBytes,
+ * and tiles are packed concurrently on the given ThreadPool.
+ *
+ * Notes:
+ * - Progress is reported once per finished tile, never per pixel.
+ * - The progress callback may be invoked from any worker thread, but calls
+ *   are serialized and the reported value never decreases.
+ */
+class ORMPacker
+{
+public:
+	using ProgressFn = std::function<void(float)>;
+
+	explicit ORMPacker(ThreadPool& pool);
+
+	/** Packs src into dst, which must hold width * height * GetChannelCount(layout) samples. */
+	void Pack(const ORMPackSource& src, ORMLayout layout, unsigned char* dst, const ProgressFn& progress = nullptr) const;
+
+	/** Packs src into every non-null target in a single pass over the source planes. */
+	void Pack(const ORMPackSource& src, const ORMPackTargets& targets, const ProgressFn& progress = nullptr) const;
+
+	/**
+	 * Packs rows [firstRow, firstRow + rowCount) on the calling thread. Targets point
+	 * at the packed copy of firstRow, so callers can stream strips through small buffers.
+	 */
+	static void PackRows(const ORMPackSource& src, const ORMPackTargets& targets, int firstRow, int rowCount);
+
+	/** Returns the number of rows per tile for a given width and packed bytes per pixel (8-bit sources). */
+	static int GetRowsPerTile(int width, int packedBytesPerPixel);
+
+	/** Returns the number of interleaved channels of the layout (3 or 4). */
+	static int GetChannelCount(ORMLayout layout);
+
+private:
+	template<typename T>
+	static void PackRowsOf(const ORMPackSource& src, const ORMPackTargets& targets, int firstRow, int rowCount);
+
+	ThreadPool& pool;
+};
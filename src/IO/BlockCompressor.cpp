@@ -0,0 +1,1126 @@
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include "BufferPool.h"
+#include "Constants.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// BC7 2-, 3- and 4-bit index interpolation weights (out of 64).
+	constexpr int Bc7Weights2[4] = { 0, 21, 43, 64 };
+	constexpr int Bc7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	constexpr int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	const int* GetBc7Weights(int indexBits)
+	{
+		return indexBits == 2 ? Bc7Weights2 : indexBits == 3 ? Bc7Weights3 : Bc7Weights;
+	}
+
+	enum class Bc7PBits
+	{
+		None,
+		Shared,  // one per subset
+		Unique   // one per endpoint
+	};
+
+	/** Field widths of one BC7 mode, as in the format specification. */
+	struct Bc7Mode
+	{
+		int subsets;
+		int partitionBits;
+		int rotationBits;
+		int indexModeBits;
+		int colorBits;
+		int alphaBits;
+		Bc7PBits pbits;
+		int indexBits;
+		int secondaryIndexBits;
+	};
+
+	constexpr Bc7Mode Bc7Modes[8] = {
+		{ 3, 4, 0, 0, 4, 0, Bc7PBits::Unique, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, Bc7PBits::Shared, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, Bc7PBits::None, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, Bc7PBits::Unique, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, Bc7PBits::None, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, Bc7PBits::None, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, Bc7PBits::Unique, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, Bc7PBits::Unique, 2, 0 }
+	};
+
+	// Two-subset partitions: bit i is the subset of texel i (row by row).
+	constexpr uint16_t Bc7Partitions[64] = {
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+		0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+		0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+		0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+		0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+	};
+
+	// Texel holding the anchor index of the second subset of each partition.
+	constexpr int Bc7SecondAnchors[64] = {
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+		15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+		6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+	};
+
+	/** The 16 texels of one 4x4 block as RGBA, row by row. */
+	struct Block
+	{
+		int texels[16][4];
+	};
+
+	void LoadBlock(const unsigned char* rows, int width, int rowCount, int channels, int blockX, int blockY, Block& block)
+	{
+		for(int y = 0; y < 4; ++y) {
+			const int sy = std::min(blockY * 4 + y, rowCount - 1);
+			for(int x = 0; x < 4; ++x) {
+				const int sx = std::min(blockX * 4 + x, width - 1);
+				const unsigned char* p = rows + (static_cast<size_t>(sy) * width + sx) * channels;
+				int* t = block.texels[y * 4 + x];
+				switch(channels) {
+					case 1: t[0] = t[1] = t[2] = p[0]; t[3] = 255; break;
+					case 2: t[0] = p[0]; t[1] = p[1]; t[2] = 0; t[3] = 255; break;
+					case 3: t[0] = p[0]; t[1] = p[1]; t[2] = p[2]; t[3] = 255; break;
+					default: t[0] = p[0]; t[1] = p[1]; t[2] = p[2]; t[3] = p[3]; break;
+				}
+			}
+		}
+	}
+
+	/** Writes little-endian bit fields, least significant bit first, as BC7 stores them. */
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(unsigned char* out) : out(out) { std::memset(out, 0, 16); }
+
+		void Put(uint32_t value, int count)
+		{
+			for(int i = 0; i < count; ++i, ++position) {
+				if((value >> i) & 1u)
+					out[position >> 3] |= static_cast<unsigned char>(1u << (position & 7));
+			}
+		}
+
+	private:
+		unsigned char* out;
+		int position = 0;
+	};
+
+	class BitReader
+	{
+	public:
+		explicit BitReader(const unsigned char* in) : in(in) {}
+
+		uint32_t Get(int count)
+		{
+			uint32_t value = 0;
+			for(int i = 0; i < count; ++i, ++position)
+				value |= static_cast<uint32_t>((in[position >> 3] >> (position & 7)) & 1u) << i;
+			return value;
+		}
+
+	private:
+		const unsigned char* in;
+		int position = 0;
+	};
+
+	// ---- BC4 -------------------------------------------------------------------
+
+	void GetBc4Palette(int r0, int r1, int palette[8])
+	{
+		palette[0] = r0;
+		palette[1] = r1;
+		if(r0 > r1) {
+			for(int i = 1; i < 7; ++i)
+				palette[i + 1] = ((7 - i) * r0 + i * r1 + 3) / 7;
+		}
+		else {
+			for(int i = 1; i < 5; ++i)
+				palette[i + 1] = ((5 - i) * r0 + i * r1 + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	/** Picks the nearest palette entry for every texel and returns the squared error. */
+	int FitBc4(const int values[16], int r0, int r1, int indices[16])
+	{
+		int palette[8];
+		GetBc4Palette(r0, r1, palette);
+
+		int error = 0;
+		for(int i = 0; i < 16; ++i) {
+			int best = 0;
+			int bestError = INT_MAX;
+			for(int p = 0; p < 8; ++p) {
+				const int d = values[i] - palette[p];
+				if(d * d < bestError) {
+					bestError = d * d;
+					best = p;
+				}
+			}
+			indices[i] = best;
+			error += bestError;
+		}
+		return error;
+	}
+
+	void EncodeBc4(const int values[16], BlockQuality quality, unsigned char* out)
+	{
+		int lo = 255, hi = 0;
+		for(int i = 0; i < 16; ++i) {
+			lo = std::min(lo, values[i]);
+			hi = std::max(hi, values[i]);
+		}
+
+		// r0 > r1 selects the eight-step ramp; equal endpoints fall into the six-step one, which still hits them exactly.
+		int bestR0 = hi, bestR1 = lo;
+		int bestIndices[16];
+		int bestError = FitBc4(values, hi, lo, bestIndices);
+
+		auto consider = [&] (int r0, int r1) {
+			int indices[16];
+			const int error = FitBc4(values, r0, r1, indices);
+			if(error < bestError) {
+				bestError = error;
+				bestR0 = r0;
+				bestR1 = r1;
+				std::copy(indices, indices + 16, bestIndices);
+			}
+		};
+
+		if(quality != BlockQuality::Fast && bestError > 0) {
+			// Six-step ramp between the inner values, with 0 and 255 available for free.
+			int innerLo = 255, innerHi = 0;
+			for(int i = 0; i < 16; ++i) {
+				if(values[i] != 0 && values[i] != 255) {
+					innerLo = std::min(innerLo, values[i]);
+					innerHi = std::max(innerHi, values[i]);
+				}
+			}
+			if(innerLo > innerHi)
+				innerLo = innerHi = 0;
+			consider(innerLo, innerHi);
+		}
+
+		if(quality == BlockQuality::High && bestError > 0) {
+			for(int d0 = 0; d0 <= 3; ++d0) {
+				for(int d1 = 0; d1 <= 3; ++d1) {
+					if(hi - d0 > lo + d1 && (d0 || d1))
+						consider(hi - d0, lo + d1);
+				}
+			}
+		}
+
+		out[0] = static_cast<unsigned char>(bestR0);
+		out[1] = static_cast<unsigned char>(bestR1);
+		uint64_t bits = 0;
+		for(int i = 0; i < 16; ++i)
+			bits |= static_cast<uint64_t>(bestIndices[i]) << (3 * i);
+		for(int i = 0; i < 6; ++i)
+			out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+	}
+
+	void DecodeBc4(const unsigned char* in, int values[16])
+	{
+		int palette[8];
+		GetBc4Palette(in[0], in[1], palette);
+		uint64_t bits = 0;
+		for(int i = 0; i < 6; ++i)
+			bits |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+		for(int i = 0; i < 16; ++i)
+			values[i] = palette[(bits >> (3 * i)) & 7];
+	}
+
+	// ---- BC7 endpoints -----------------------------------------------------------
+
+	/**
+	 * Mean and principal axis (power iteration on the covariance) of count texels, using their first
+	 * channels components; returns the scatter left off that axis.
+	 */
+	float GetPrincipalAxis(const int texels[][4], int count, int channels, float mean[4], float axis[4])
+	{
+		for(int c = 0; c < 4; ++c) {
+			mean[c] = 0.0f;
+			axis[c] = c < channels ? 1.0f : 0.0f;
+		}
+		for(int i = 0; i < count; ++i)
+			for(int c = 0; c < channels; ++c)
+				mean[c] += texels[i][c] / static_cast<float>(count);
+
+		float covariance[4][4] = {};
+		for(int i = 0; i < count; ++i) {
+			float d[4];
+			for(int c = 0; c < channels; ++c)
+				d[c] = texels[i][c] - mean[c];
+			for(int a = 0; a < channels; ++a)
+				for(int b = 0; b < channels; ++b)
+					covariance[a][b] += d[a] * d[b];
+		}
+
+		for(int iteration = 0; iteration < 8; ++iteration) {
+			float next[4] = {};
+			for(int a = 0; a < channels; ++a)
+				for(int b = 0; b < channels; ++b)
+					next[a] += covariance[a][b] * axis[b];
+			const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+			if(length < 1e-6f)
+				break;
+			for(int c = 0; c < channels; ++c)
+				axis[c] = next[c] / length;
+		}
+
+		float trace = 0.0f, along = 0.0f, axisLength = 0.0f;
+		for(int a = 0; a < channels; ++a) {
+			trace += covariance[a][a];
+			axisLength += axis[a] * axis[a];
+			for(int b = 0; b < channels; ++b)
+				along += axis[a] * covariance[a][b] * axis[b];
+		}
+		return trace - along / axisLength;
+	}
+
+	/** Initial endpoints: the extent of the texels along their principal axis. */
+	void GetPrincipalEndpoints(const int texels[][4], int count, int channels, float e0[4], float e1[4])
+	{
+		float mean[4], axis[4];
+		GetPrincipalAxis(texels, count, channels, mean, axis);
+
+		float tMin = 0.0f, tMax = 0.0f;
+		for(int i = 0; i < count; ++i) {
+			float t = 0.0f;
+			for(int c = 0; c < channels; ++c)
+				t += (texels[i][c] - mean[c]) * axis[c];
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+
+		for(int c = 0; c < 4; ++c) {
+			e0[c] = std::clamp(mean[c] + tMin * axis[c], 0.0f, 255.0f);
+			e1[c] = std::clamp(mean[c] + tMax * axis[c], 0.0f, 255.0f);
+		}
+	}
+
+	/** Least-squares endpoints for fixed indices; false when every texel uses the same weight. */
+	bool RefineEndpoints(const int texels[][4], int count, int channels, const int indices[16], const int* weights,
+		float e0[4], float e1[4])
+	{
+		float a = 0.0f, b = 0.0f, c = 0.0f;
+		float x0[4] = {}, x1[4] = {};
+		for(int i = 0; i < count; ++i) {
+			const float t = weights[indices[i]] / 64.0f;
+			const float s = 1.0f - t;
+			a += s * s;
+			b += s * t;
+			c += t * t;
+			for(int ch = 0; ch < channels; ++ch) {
+				x0[ch] += s * texels[i][ch];
+				x1[ch] += t * texels[i][ch];
+			}
+		}
+
+		const float determinant = a * c - b * b;
+		if(std::fabs(determinant) < 1e-6f)
+			return false;
+
+		for(int ch = 0; ch < channels; ++ch) {
+			e0[ch] = std::clamp((c * x0[ch] - b * x1[ch]) / determinant, 0.0f, 255.0f);
+			e1[ch] = std::clamp((a * x1[ch] - b * x0[ch]) / determinant, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	// ---- BC7 mode 6 ------------------------------------------------------------
+
+	/** 7-bit endpoint colors plus one p-bit per endpoint; the stored color is (q << 1) | p. */
+	struct Bc7Endpoints
+	{
+		int q[2][4];
+		int p[2];
+	};
+
+	int Expand(int q, int p)
+	{
+		return (q << 1) | p;
+	}
+
+	void Quantize(const float color[4], int p, int q[4])
+	{
+		for(int c = 0; c < 4; ++c)
+			q[c] = std::clamp(static_cast<int>(std::lround((color[c] - p) * 0.5f)), 0, 127);
+	}
+
+	int GetQuantizeError(const float color[4], int p)
+	{
+		int q[4];
+		Quantize(color, p, q);
+		float error = 0.0f;
+		for(int c = 0; c < 4; ++c) {
+			const float d = Expand(q[c], p) - color[c];
+			error += d * d;
+		}
+		return static_cast<int>(error);
+	}
+
+	void GetBc7Palette(const Bc7Endpoints& endpoints, int palette[16][4])
+	{
+		for(int c = 0; c < 4; ++c) {
+			const int e0 = Expand(endpoints.q[0][c], endpoints.p[0]);
+			const int e1 = Expand(endpoints.q[1][c], endpoints.p[1]);
+			for(int i = 0; i < 16; ++i)
+				palette[i][c] = ((64 - Bc7Weights[i]) * e0 + Bc7Weights[i] * e1 + 32) >> 6;
+		}
+	}
+
+	/**
+	 * Picks an index for every texel and returns the squared error. The exhaustive search tries all
+	 * 16 entries; otherwise the texel is projected onto the endpoint line and only the neighbours of
+	 * the nearest weight are tried, which is almost always the same answer.
+	 */
+	int FitBc7(const Block& block, const Bc7Endpoints& endpoints, bool exhaustive, int indices[16])
+	{
+		int palette[16][4];
+		GetBc7Palette(endpoints, palette);
+
+		float axis[4];
+		float axisLength = 0.0f;
+		for(int c = 0; c < 4; ++c) {
+			axis[c] = static_cast<float>(palette[15][c] - palette[0][c]);
+			axisLength += axis[c] * axis[c];
+		}
+		const float invLength = axisLength > 0.0f ? 15.0f / axisLength : 0.0f;
+
+		int error = 0;
+		for(int i = 0; i < 16; ++i) {
+			const int* texel = block.texels[i];
+			int first = 0, last = 15;
+			if(!exhaustive) {
+				float t = 0.0f;
+				for(int c = 0; c < 4; ++c)
+					t += (texel[c] - palette[0][c]) * axis[c];
+				const int guess = std::clamp(static_cast<int>(std::lround(t * invLength)), 0, 15);
+				first = std::max(guess - 1, 0);
+				last = std::min(guess + 1, 15);
+			}
+
+			int best = first;
+			int bestError = INT_MAX;
+			for(int p = first; p <= last; ++p) {
+				int d = 0;
+				for(int c = 0; c < 4; ++c) {
+					const int diff = texel[c] - palette[p][c];
+					d += diff * diff;
+				}
+				if(d < bestError) {
+					bestError = d;
+					best = p;
+				}
+			}
+			indices[i] = best;
+			error += bestError;
+		}
+		return error;
+	}
+
+	/** Quantizes the float endpoints and fits indices, choosing the p-bits; returns the squared error. */
+	int QuantizeAndFit(const Block& block, const float e0[4], const float e1[4], BlockQuality quality,
+		Bc7Endpoints& endpoints, int indices[16])
+	{
+		const bool exhaustive = quality == BlockQuality::High;
+
+		if(quality == BlockQuality::Fast) {
+			// Each endpoint takes the p-bit that represents it best on its own.
+			endpoints.p[0] = GetQuantizeError(e0, 1) < GetQuantizeError(e0, 0) ? 1 : 0;
+			endpoints.p[1] = GetQuantizeError(e1, 1) < GetQuantizeError(e1, 0) ? 1 : 0;
+			Quantize(e0, endpoints.p[0], endpoints.q[0]);
+			Quantize(e1, endpoints.p[1], endpoints.q[1]);
+			return FitBc7(block, endpoints, exhaustive, indices);
+		}
+
+		int bestError = INT_MAX;
+		for(int pbits = 0; pbits < 4; ++pbits) {
+			Bc7Endpoints candidate;
+			candidate.p[0] = pbits & 1;
+			candidate.p[1] = pbits >> 1;
+			Quantize(e0, candidate.p[0], candidate.q[0]);
+			Quantize(e1, candidate.p[1], candidate.q[1]);
+
+			int candidateIndices[16];
+			const int error = FitBc7(block, candidate, exhaustive, candidateIndices);
+			if(error < bestError) {
+				bestError = error;
+				endpoints = candidate;
+				std::copy(candidateIndices, candidateIndices + 16, indices);
+			}
+		}
+		return bestError;
+	}
+
+	/** Returns the squared error of the written block. */
+	int EncodeBc7Mode6(const Block& block, BlockQuality quality, unsigned char* out)
+	{
+		float e0[4], e1[4];
+		GetPrincipalEndpoints(block.texels, 16, 4, e0, e1);
+
+		Bc7Endpoints endpoints;
+		int indices[16];
+		int error = QuantizeAndFit(block, e0, e1, quality, endpoints, indices);
+
+		const int refinements = quality == BlockQuality::High ? 3 : quality == BlockQuality::Normal ? 1 : 0;
+		for(int pass = 0; pass < refinements && error > 0; ++pass) {
+			if(!RefineEndpoints(block.texels, 16, 4, indices, Bc7Weights, e0, e1))
+				break;
+
+			Bc7Endpoints refined;
+			int refinedIndices[16];
+			const int refinedError = QuantizeAndFit(block, e0, e1, quality, refined, refinedIndices);
+			if(refinedError >= error)
+				break;
+			error = refinedError;
+			endpoints = refined;
+			std::copy(refinedIndices, refinedIndices + 16, indices);
+		}
+
+		// The anchor (first) index is stored without its top bit, so it must be below 8.
+		if(indices[0] >= 8) {
+			std::swap(endpoints.q[0], endpoints.q[1]);
+			std::swap(endpoints.p[0], endpoints.p[1]);
+			for(int& index : indices)
+				index = 15 - index;
+		}
+
+		BitWriter bits(out);
+		bits.Put(1u << 6, 7);  // mode 6
+		for(int c = 0; c < 4; ++c) {
+			bits.Put(static_cast<uint32_t>(endpoints.q[0][c]), 7);
+			bits.Put(static_cast<uint32_t>(endpoints.q[1][c]), 7);
+		}
+		bits.Put(static_cast<uint32_t>(endpoints.p[0]), 1);
+		bits.Put(static_cast<uint32_t>(endpoints.p[1]), 1);
+		bits.Put(static_cast<uint32_t>(indices[0]), 3);
+		for(int i = 1; i < 16; ++i)
+			bits.Put(static_cast<uint32_t>(indices[i]), 4);
+		return error;
+	}
+
+	// ---- BC7 modes 1, 3, 4, 5 and 7 ---------------------------------------------
+
+	/** Endpoint precision and index width of one set of endpoints in a given mode. */
+	struct Bc7Precision
+	{
+		int bits;  // stored bits per component, without the p-bit
+		Bc7PBits pbits;
+		int indexBits;
+	};
+
+	/** Stored endpoints of one subset, or of the color / scalar part of modes 4 and 5. */
+	struct Bc7Subset
+	{
+		int q[2][4] = {};
+		int p[2] = {};
+	};
+
+	int Unquantize(int value, int bits)
+	{
+		return bits >= 8 ? value : (value << (8 - bits)) | (value >> (2 * bits - 8));
+	}
+
+	int ExpandEndpoint(int q, int p, const Bc7Precision& precision)
+	{
+		return precision.pbits == Bc7PBits::None ? Unquantize(q, precision.bits) : Unquantize((q << 1) | p, precision.bits + 1);
+	}
+
+	/** The stored value (for p-bit p) that expands closest to value. */
+	int QuantizeEndpoint(float value, int p, const Bc7Precision& precision)
+	{
+		const int top = (1 << precision.bits) - 1;
+		const bool hasPBit = precision.pbits != Bc7PBits::None;
+		const float scaled = value * static_cast<float>((1 << (precision.bits + hasPBit)) - 1) / 255.0f;
+		const int guess = std::clamp(static_cast<int>(std::lround(hasPBit ? (scaled - p) * 0.5f : scaled)), 0, top);
+
+		int best = guess;
+		float bestError = FLT_MAX;
+		for(int q = std::max(guess - 1, 0); q <= std::min(guess + 1, top); ++q) {
+			const float error = std::fabs(ExpandEndpoint(q, p, precision) - value);
+			if(error < bestError) {
+				bestError = error;
+				best = q;
+			}
+		}
+		return best;
+	}
+
+	/** Nearest palette entry of every texel, exhaustively (at most 8 entries); returns the squared error. */
+	int FitSubset(const int texels[][4], int count, int channels, const Bc7Subset& subset, const Bc7Precision& precision,
+		int indices[16])
+	{
+		const int* weights = GetBc7Weights(precision.indexBits);
+		const int entries = 1 << precision.indexBits;
+		int palette[16][4];
+		for(int c = 0; c < channels; ++c) {
+			const int e0 = ExpandEndpoint(subset.q[0][c], subset.p[0], precision);
+			const int e1 = ExpandEndpoint(subset.q[1][c], subset.p[1], precision);
+			for(int i = 0; i < entries; ++i)
+				palette[i][c] = ((64 - weights[i]) * e0 + weights[i] * e1 + 32) >> 6;
+		}
+
+		int error = 0;
+		for(int i = 0; i < count; ++i) {
+			int best = 0;
+			int bestError = INT_MAX;
+			for(int e = 0; e < entries; ++e) {
+				int d = 0;
+				for(int c = 0; c < channels; ++c) {
+					const int diff = texels[i][c] - palette[e][c];
+					d += diff * diff;
+				}
+				if(d < bestError) {
+					bestError = d;
+					best = e;
+				}
+			}
+			indices[i] = best;
+			error += bestError;
+		}
+		return error;
+	}
+
+	/** Quantizes the float endpoints for every p-bit choice of the mode and keeps the best fit. */
+	int QuantizeSubset(const int texels[][4], int count, int channels, const float e0[4], const float e1[4],
+		const Bc7Precision& precision, Bc7Subset& subset, int indices[16])
+	{
+		const int choices = precision.pbits == Bc7PBits::Unique ? 4 : precision.pbits == Bc7PBits::Shared ? 2 : 1;
+		int bestError = INT_MAX;
+		for(int choice = 0; choice < choices; ++choice) {
+			Bc7Subset candidate;
+			candidate.p[0] = choice & 1;
+			candidate.p[1] = precision.pbits == Bc7PBits::Unique ? choice >> 1 : candidate.p[0];
+			for(int c = 0; c < channels; ++c) {
+				candidate.q[0][c] = QuantizeEndpoint(e0[c], candidate.p[0], precision);
+				candidate.q[1][c] = QuantizeEndpoint(e1[c], candidate.p[1], precision);
+			}
+
+			int candidateIndices[16];
+			const int error = FitSubset(texels, count, channels, candidate, precision, candidateIndices);
+			if(error < bestError) {
+				bestError = error;
+				subset = candidate;
+				std::copy(candidateIndices, candidateIndices + count, indices);
+			}
+		}
+		return bestError;
+	}
+
+	/** Principal-axis endpoints of count texels, refined by least squares (twice for High); returns the squared error. */
+	int EncodeSubset(const int texels[][4], int count, int channels, const Bc7Precision& precision, BlockQuality quality,
+		Bc7Subset& subset, int indices[16])
+	{
+		float e0[4], e1[4];
+		GetPrincipalEndpoints(texels, count, channels, e0, e1);
+		int error = QuantizeSubset(texels, count, channels, e0, e1, precision, subset, indices);
+
+		const int refinements = quality == BlockQuality::High ? 2 : 1;
+		for(int pass = 0; pass < refinements && error > 0; ++pass) {
+			if(!RefineEndpoints(texels, count, channels, indices, GetBc7Weights(precision.indexBits), e0, e1))
+				break;
+
+			Bc7Subset refined;
+			int refinedIndices[16];
+			const int refinedError = QuantizeSubset(texels, count, channels, e0, e1, precision, refined, refinedIndices);
+			if(refinedError >= error)
+				break;
+			error = refinedError;
+			subset = refined;
+			std::copy(refinedIndices, refinedIndices + count, indices);
+		}
+		return error;
+	}
+
+	/** The anchor index of a subset is stored without its top bit: swap the endpoints if it is set. */
+	void FixAnchor(Bc7Subset& subset, int indexBits, int anchor, uint16_t texelMask, int indices[16])
+	{
+		const int top = (1 << indexBits) - 1;
+		if(indices[anchor] <= top >> 1)
+			return;
+		std::swap(subset.q[0], subset.q[1]);
+		std::swap(subset.p[0], subset.p[1]);
+		for(int i = 0; i < 16; ++i) {
+			if((texelMask >> i) & 1)
+				indices[i] = top - indices[i];
+		}
+	}
+
+	void PutIndices(BitWriter& bits, const int indices[16], int indexBits, uint16_t anchors)
+	{
+		for(int i = 0; i < 16; ++i)
+			bits.Put(static_cast<uint32_t>(indices[i]), indexBits - ((anchors >> i) & 1));
+	}
+
+	/**
+	 * Mode 4 or 5: RGB and one scalar channel with separate endpoints and indices. The rotation swaps
+	 * alpha with R, G or B first, so any one channel can be the scalar one; mode 4's index mode picks
+	 * which part gets the 3-bit indices. Returns the squared error of the written block.
+	 */
+	int EncodeBc7Separate(const Block& block, int mode, int rotation, int indexMode, BlockQuality quality, unsigned char* out)
+	{
+		const Bc7Mode& info = Bc7Modes[mode];
+		const Bc7Precision color{ info.colorBits, Bc7PBits::None, indexMode ? info.secondaryIndexBits : info.indexBits };
+		const Bc7Precision scalar{ info.alphaBits, Bc7PBits::None, indexMode ? info.indexBits : info.secondaryIndexBits };
+
+		int colors[16][4], scalars[16][4];
+		for(int i = 0; i < 16; ++i) {
+			int texel[4] = { block.texels[i][0], block.texels[i][1], block.texels[i][2], block.texels[i][3] };
+			if(rotation)
+				std::swap(texel[3], texel[rotation - 1]);
+			std::copy(texel, texel + 4, colors[i]);
+			scalars[i][0] = texel[3];
+		}
+
+		Bc7Subset colorEndpoints, scalarEndpoints;
+		int colorIndices[16], scalarIndices[16];
+		const int error = EncodeSubset(colors, 16, 3, color, quality, colorEndpoints, colorIndices)
+			+ EncodeSubset(scalars, 16, 1, scalar, quality, scalarEndpoints, scalarIndices);
+		FixAnchor(colorEndpoints, color.indexBits, 0, 0xFFFF, colorIndices);
+		FixAnchor(scalarEndpoints, scalar.indexBits, 0, 0xFFFF, scalarIndices);
+
+		BitWriter bits(out);
+		bits.Put(1u << mode, mode + 1);
+		bits.Put(static_cast<uint32_t>(rotation), info.rotationBits);
+		bits.Put(static_cast<uint32_t>(indexMode), info.indexModeBits);
+		for(int c = 0; c < 3; ++c) {
+			bits.Put(static_cast<uint32_t>(colorEndpoints.q[0][c]), color.bits);
+			bits.Put(static_cast<uint32_t>(colorEndpoints.q[1][c]), color.bits);
+		}
+		bits.Put(static_cast<uint32_t>(scalarEndpoints.q[0][0]), scalar.bits);
+		bits.Put(static_cast<uint32_t>(scalarEndpoints.q[1][0]), scalar.bits);
+
+		// The primary index set comes first; index mode 1 hands it to the scalar channel.
+		PutIndices(bits, indexMode ? scalarIndices : colorIndices, info.indexBits, 1);
+		PutIndices(bits, indexMode ? colorIndices : scalarIndices, info.secondaryIndexBits, 1);
+		return error;
+	}
+
+	/**
+	 * Mode 1 or 3 (RGB, for opaque blocks) or 7 (RGBA): two subsets split by one of the 64 partitions.
+	 * Returns the squared error of the written block.
+	 */
+	int EncodeBc7Partitioned(const Block& block, int mode, int partition, BlockQuality quality, unsigned char* out)
+	{
+		const Bc7Mode& info = Bc7Modes[mode];
+		const Bc7Precision precision{ info.colorBits, info.pbits, info.indexBits };
+		const int channels = info.alphaBits ? 4 : 3;
+		const uint16_t mask = Bc7Partitions[partition];
+		const int anchors[2] = { 0, Bc7SecondAnchors[partition] };
+
+		Bc7Subset subsets[2];
+		int indices[16];
+		int error = 0;
+		for(int s = 0; s < 2; ++s) {
+			int texels[16][4];
+			int count = 0;
+			for(int i = 0; i < 16; ++i) {
+				if(((mask >> i) & 1) == s)
+					std::copy(block.texels[i], block.texels[i] + 4, texels[count++]);
+			}
+
+			int subsetIndices[16];
+			error += EncodeSubset(texels, count, channels, precision, quality, subsets[s], subsetIndices);
+			for(int i = 0, next = 0; i < 16; ++i) {
+				if(((mask >> i) & 1) == s)
+					indices[i] = subsetIndices[next++];
+			}
+			FixAnchor(subsets[s], precision.indexBits, anchors[s], static_cast<uint16_t>(s ? mask : ~mask), indices);
+		}
+
+		BitWriter bits(out);
+		bits.Put(1u << mode, mode + 1);
+		bits.Put(static_cast<uint32_t>(partition), info.partitionBits);
+		for(int c = 0; c < channels; ++c)
+			for(const Bc7Subset& subset : subsets)
+				for(int e = 0; e < 2; ++e)
+					bits.Put(static_cast<uint32_t>(subset.q[e][c]), info.colorBits);
+		for(const Bc7Subset& subset : subsets) {
+			bits.Put(static_cast<uint32_t>(subset.p[0]), 1);
+			if(info.pbits == Bc7PBits::Unique)
+				bits.Put(static_cast<uint32_t>(subset.p[1]), 1);
+		}
+		PutIndices(bits, indices, info.indexBits, static_cast<uint16_t>(1u | 1u << anchors[1]));
+		return error;
+	}
+
+	/** The count partitions whose two subsets lie closest to a line each, best first. */
+	int RankPartitions(const Block& block, int channels, int ranked[], int count)
+	{
+		std::pair<float, int> scores[64];
+		for(int partition = 0; partition < 64; ++partition) {
+			float score = 0.0f;
+			for(int s = 0; s < 2; ++s) {
+				int texels[16][4];
+				int texelCount = 0;
+				for(int i = 0; i < 16; ++i) {
+					if(((Bc7Partitions[partition] >> i) & 1) == s)
+						std::copy(block.texels[i], block.texels[i] + 4, texels[texelCount++]);
+				}
+				float mean[4], axis[4];
+				score += GetPrincipalAxis(texels, texelCount, channels, mean, axis);
+			}
+			scores[partition] = { score, partition };
+		}
+
+		count = std::min(count, 64);
+		std::partial_sort(scores, scores + count, scores + 64);
+		for(int i = 0; i < count; ++i)
+			ranked[i] = scores[i].second;
+		return count;
+	}
+
+	void DecodeBc7(const unsigned char* in, int texels[16][4])
+	{
+		BitReader bits(in);
+		int mode = 0;
+		while(mode < 8 && !bits.Get(1))
+			++mode;
+		if(mode == 8 || Bc7Modes[mode].subsets == 3) {
+			// Reserved, or a three-subset mode the encoder never writes.
+			std::memset(texels, 0, sizeof(int) * 16 * 4);
+			return;
+		}
+
+		const Bc7Mode& info = Bc7Modes[mode];
+		const int partition = static_cast<int>(bits.Get(info.partitionBits));
+		const int rotation = static_cast<int>(bits.Get(info.rotationBits));
+		const int indexMode = static_cast<int>(bits.Get(info.indexModeBits));
+
+		int endpoints[2][2][4] = {};
+		for(int c = 0; c < 3; ++c)
+			for(int s = 0; s < info.subsets; ++s)
+				for(int e = 0; e < 2; ++e)
+					endpoints[s][e][c] = static_cast<int>(bits.Get(info.colorBits));
+		for(int s = 0; s < info.subsets && info.alphaBits; ++s)
+			for(int e = 0; e < 2; ++e)
+				endpoints[s][e][3] = static_cast<int>(bits.Get(info.alphaBits));
+
+		int pbits[2][2] = {};
+		for(int s = 0; s < info.subsets && info.pbits != Bc7PBits::None; ++s) {
+			pbits[s][0] = static_cast<int>(bits.Get(1));
+			pbits[s][1] = info.pbits == Bc7PBits::Unique ? static_cast<int>(bits.Get(1)) : pbits[s][0];
+		}
+
+		const Bc7Precision color{ info.colorBits, info.pbits, 0 };
+		const Bc7Precision alpha{ info.alphaBits, info.pbits, 0 };
+		for(int s = 0; s < info.subsets; ++s) {
+			for(int e = 0; e < 2; ++e) {
+				for(int c = 0; c < 3; ++c)
+					endpoints[s][e][c] = ExpandEndpoint(endpoints[s][e][c], pbits[s][e], color);
+				endpoints[s][e][3] = info.alphaBits ? ExpandEndpoint(endpoints[s][e][3], pbits[s][e], alpha) : 255;
+			}
+		}
+
+		const uint16_t mask = info.subsets == 2 ? Bc7Partitions[partition] : 0;
+		const uint16_t anchors = static_cast<uint16_t>(1u | (info.subsets == 2 ? 1u << Bc7SecondAnchors[partition] : 0u));
+		int primary[16], secondary[16] = {};
+		for(int i = 0; i < 16; ++i)
+			primary[i] = static_cast<int>(bits.Get(info.indexBits - ((anchors >> i) & 1)));
+		for(int i = 0; i < 16 && info.secondaryIndexBits; ++i)
+			secondary[i] = static_cast<int>(bits.Get(info.secondaryIndexBits - (i == 0)));
+
+		// Color and alpha share the primary indices unless the mode has a second set.
+		const bool separate = info.secondaryIndexBits > 0;
+		const int* colorWeights = GetBc7Weights(separate && indexMode ? info.secondaryIndexBits : info.indexBits);
+		const int* alphaWeights = GetBc7Weights(separate && !indexMode ? info.secondaryIndexBits : info.indexBits);
+		for(int i = 0; i < 16; ++i) {
+			const int (&pair)[2][4] = endpoints[(mask >> i) & 1];
+			const int colorWeight = colorWeights[separate && indexMode ? secondary[i] : primary[i]];
+			const int alphaWeight = alphaWeights[separate && !indexMode ? secondary[i] : primary[i]];
+			for(int c = 0; c < 4; ++c) {
+				const int weight = c < 3 ? colorWeight : alphaWeight;
+				texels[i][c] = ((64 - weight) * pair[0][c] + weight * pair[1][c] + 32) >> 6;
+			}
+			if(rotation)
+				std::swap(texels[i][3], texels[i][rotation - 1]);
+		}
+	}
+
+	/** Rotation that moves the channel lying furthest off the block's principal axis into the scalar slot of mode 4 / 5. */
+	int GetSeparateRotation(const Block& block)
+	{
+		float mean[4], axis[4];
+		GetPrincipalAxis(block.texels, 16, 4, mean, axis);
+
+		float axisLength = 0.0f;
+		for(int c = 0; c < 4; ++c)
+			axisLength += axis[c] * axis[c];
+
+		float residual[4] = {};
+		for(int i = 0; i < 16; ++i) {
+			float d[4], t = 0.0f;
+			for(int c = 0; c < 4; ++c) {
+				d[c] = block.texels[i][c] - mean[c];
+				t += d[c] * axis[c];
+			}
+			for(int c = 0; c < 4; ++c) {
+				const float off = d[c] - t * axis[c] / axisLength;
+				residual[c] += off * off;
+			}
+		}
+
+		// Alpha is rotation 0; R, G and B are rotations 1 to 3.
+		const int channel = static_cast<int>(std::max_element(residual, residual + 4) - residual);
+		return channel == 3 ? 0 : channel + 1;
+	}
+
+	/**
+	 * Fast writes mode 6 only. Normal also tries mode 5 once, separating the channel that mode 6's
+	 * single line fits worst. High tries mode 5 and mode 4 with every rotation and index mode, then the
+	 * best-ranked partitions of mode 1 and 3 (opaque blocks) or 7. The candidate with the smallest
+	 * error is kept.
+	 */
+	void EncodeBc7(const Block& block, BlockQuality quality, unsigned char* out)
+	{
+		int bestError = EncodeBc7Mode6(block, quality, out);
+		if(quality == BlockQuality::Fast)
+			return;
+
+		bool opaque = true;
+		for(int i = 0; i < 16; ++i)
+			opaque = opaque && block.texels[i][3] == 255;
+
+		unsigned char candidate[16];
+		auto consider = [&] (int error) {
+			if(error < bestError) {
+				bestError = error;
+				std::memcpy(out, candidate, 16);
+			}
+		};
+
+		if(quality != BlockQuality::High) {
+			if(bestError > 0) {
+				consider(EncodeBc7Separate(block, 5, GetSeparateRotation(block), 0, quality, candidate));
+			}
+			return;
+		}
+
+		// Rotation 0 separates alpha, which an opaque block does not need.
+		for(int rotation = opaque ? 1 : 0; rotation < 4 && bestError > 0; ++rotation) {
+			consider(EncodeBc7Separate(block, 5, rotation, 0, quality, candidate));
+			for(int indexMode = 0; indexMode < 2 && bestError > 0; ++indexMode) {
+				consider(EncodeBc7Separate(block, 4, rotation, indexMode, quality, candidate));
+			}
+		}
+
+		int partitions[ORM::Bc7PartitionCandidates];
+		const int partitionCount = bestError > 0 ? RankPartitions(block, opaque ? 3 : 4, partitions, ORM::Bc7PartitionCandidates) : 0;
+		for(int i = 0; i < partitionCount && bestError > 0; ++i) {
+			for(int mode : { 1, 3, 7 }) {
+				if((mode == 7) == opaque)
+					continue;
+				consider(EncodeBc7Partitioned(block, mode, partitions[i], quality, candidate));
+			}
+		}
+	}
+
+	// ---- Bands -----------------------------------------------------------------
+
+	void EncodeBlockRows(const unsigned char* rows, int width, int rowCount, int channels, BlockFormat format,
+		BlockQuality quality, unsigned char* out)
+	{
+		const int blocksWide = (width + 3) / 4;
+		const int blockRows = (rowCount + 3) / 4;
+		const int blockBytes = BlockCompressor::GetBlockBytes(format);
+
+		Block block;
+		int values[16];
+		for(int by = 0; by < blockRows; ++by) {
+			for(int bx = 0; bx < blocksWide; ++bx, out += blockBytes) {
+				LoadBlock(rows, width, rowCount, channels, bx, by, block);
+				switch(format) {
+					case BlockFormat::BC4:
+					case BlockFormat::BC5:
+						for(int plane = 0; plane < (format == BlockFormat::BC5 ? 2 : 1); ++plane) {
+							for(int i = 0; i < 16; ++i)
+								values[i] = block.texels[i][plane];
+							EncodeBc4(values, quality, out + plane * 8);
+						}
+						break;
+					case BlockFormat::BC7:
+						EncodeBc7(block, quality, out);
+						break;
+					default:
+						break;
+				}
+			}
+		}
+	}
+
+	/** Splits the image into bands of whole block rows sized like a packing tile and runs encode(band) for each. */
+	template<typename EncodeFn>
+	void ForEachBand(ThreadPool& pool, int width, int height, int channels, EncodeFn&& encode)
+	{
+		const size_t bandBytes = static_cast<size_t>(width) * channels * 4;
+		const int blocksHigh = (height + 3) / 4;
+		const int blockRowsPerBand = static_cast<int>(std::max<size_t>(1, ORM::PackTileBytes / bandBytes));
+		const size_t bandCount = (static_cast<size_t>(blocksHigh) + blockRowsPerBand - 1) / blockRowsPerBand;
+
+		pool.ParallelFor(bandCount, [&] (size_t band) {
+			const int firstBlockRow = static_cast<int>(band) * blockRowsPerBand;
+			const int firstRow = firstBlockRow * 4;
+			const int rowCount = std::min(blockRowsPerBand * 4, height - firstRow);
+			encode(firstBlockRow, firstRow, rowCount);
+		});
+	}
+
+	/** Sizes the output for the whole image; false when it cannot be allocated. */
+	bool ResizeBlocks(std::vector<unsigned char>& blocks, size_t bytes)
+	{
+		try {
+			blocks.resize(bytes);
+		}
+		catch(const std::bad_alloc&) {
+			return false;
+		}
+		return true;
+	}
+}
+
+BlockCompressor::BlockCompressor(ThreadPool& pool) : pool(pool)
+{
+}
+
+std::vector<unsigned char> BlockCompressor::Compress(const unsigned char* pixels, int width, int height, int channels,
+	BlockFormat format, BlockQuality quality) const
+{
+	std::vector<unsigned char> blocks;
+	if(!pixels || format == BlockFormat::None || width <= 0 || height <= 0 || channels < 1 || channels > 4)
+		return blocks;
+
+	if(!ResizeBlocks(blocks, GetCompressedSize(format, width, height)))
+		return blocks;
+	const size_t blockRowBytes = static_cast<size_t>((width + 3) / 4) * GetBlockBytes(format);
+	const size_t rowBytes = static_cast<size_t>(width) * channels;
+
+	ForEachBand(pool, width, height, channels, [&] (int firstBlockRow, int firstRow, int rowCount) {
+		EncodeBlockRows(pixels + firstRow * rowBytes, width, rowCount, channels, format, quality,
+			blocks.data() + firstBlockRow * blockRowBytes);
+	});
+	return blocks;
+}
+
+std::vector<unsigned char> BlockCompressor::Compress(int width, int height, int channels, BlockFormat format,
+	BlockQuality quality, const RowFiller& fill) const
+{
+	std::vector<unsigned char> blocks;
+	if(!fill || format == BlockFormat::None || width <= 0 || height <= 0 || channels < 1 || channels > 4)
+		return blocks;
+
+	if(!ResizeBlocks(blocks, GetCompressedSize(format, width, height)))
+		return blocks;
+	const size_t blockRowBytes = static_cast<size_t>((width + 3) / 4) * GetBlockBytes(format);
+	const size_t rowBytes = static_cast<size_t>(width) * channels;
+
+	std::atomic<bool> allocated{ true };
+	ForEachBand(pool, width, height, channels, [&] (int firstBlockRow, int firstRow, int rowCount) {
+		PooledBuffer rows(rowCount * rowBytes);
+		if(!rows.GetData()) {
+			allocated = false;
+			return;
+		}
+		fill(firstRow, rowCount, rows.GetData());
+		EncodeBlockRows(rows.GetData(), width, rowCount, channels, format, quality, blocks.data() + firstBlockRow * blockRowBytes);
+	});
+	if(!allocated)
+		blocks.clear();
+	return blocks;
+}
+
+void BlockCompressor::Decompress(const unsigned char* blocks, int width, int height, BlockFormat format, unsigned char* pixels)
+{
+	const int channels = GetDecodedChannels(format);
+	const int blockBytes = GetBlockBytes(format);
+	if(!blocks || !pixels || !channels)
+		return;
+
+	int texels[16][4];
+	int values[16];
+	for(int by = 0; by < (height + 3) / 4; ++by) {
+		for(int bx = 0; bx < (width + 3) / 4; ++bx, blocks += blockBytes) {
+			if(format == BlockFormat::BC7)
+				DecodeBc7(blocks, texels);
+			else {
+				for(int plane = 0; plane < channels; ++plane) {
+					DecodeBc4(blocks + plane * 8, values);
+					for(int i = 0; i < 16; ++i)
+						texels[i][plane] = values[i];
+				}
+			}
+
+			for(int i = 0; i < 16; ++i) {
+				const int x = bx * 4 + (i & 3);
+				const int y = by * 4 + (i >> 2);
+				if(x >= width || y >= height)
+					continue;
+				unsigned char* out = pixels + (static_cast<size_t>(y) * width + x) * channels;
+				for(int c = 0; c < channels; ++c)
+					out[c] = static_cast<unsigned char>(texels[i][c]);
+			}
+		}
+	}
+}
+
+int BlockCompressor::GetBlockBytes(BlockFormat format)
+{
+	switch(format) {
+		case BlockFormat::BC4: return 8;
+		case BlockFormat::BC5: return 16;
+		case BlockFormat::BC7: return 16;
+		default: return 0;
+	}
+}
+
+size_t BlockCompressor::GetCompressedSize(BlockFormat format, int width, int height)
+{
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+}
+
+int BlockCompressor::GetDecodedChannels(BlockFormat format)
+{
+	switch(format) {
+		case BlockFormat::BC4: return 1;
+		case BlockFormat::BC5: return 2;
+		case BlockFormat::BC7: return 4;
+		default: return 0;
+	}
+}
+
+std::string_view BlockCompressor::GetFormatName(BlockFormat format)
+{
+	switch(format) {
+		case BlockFormat::BC4: return "BC4";
+		case BlockFormat::BC5: return "BC5";
+		case BlockFormat::BC7: return "BC7";
+		default: return "None";
+	}
+}
+
+std::string_view BlockCompressor::GetQualityName(BlockQuality quality)
+{
+	switch(quality) {
+		case BlockQuality::Fast: return "fast";
+		case BlockQuality::High: return "high";
+		default: return "normal";
+	}
+}
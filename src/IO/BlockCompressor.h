@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
+
+/** GPU block-compressed formats ORMTool can write. */
+enum class BlockFormat
+{
+	None,
+	BC4,  // one channel, 8 bytes per 4x4 block
+	BC5,  // two channels (two BC4 blocks), 16 bytes per block
+	BC7   // RGBA, 16 bytes per block
+};
+
+/** Speed / quality trade-off of the block encoder. */
+enum class BlockQuality
+{
+	Fast,
+	Normal,
+	High
+};
+
+/**
+ * Class: BlockCompressor
+ *
+ * Multithreaded BC4 / BC5 / BC7 encoder. The image is split into bands of
+ * 4-pixel block rows that are encoded concurrently on a ThreadPool and written
+ * straight into their place in the output, so the result does not depend on the
+ * thread count.
+ *
+ * Notes:
+ * - BC4 and BC5 read the first one or two interleaved channels of the input.
+ *   Fast fits the min / max ramp, Normal also tries the six-step ramp with
+ *   explicit 0 and 255, High additionally searches endpoints around min / max.
+ * - BC7 endpoints start on the principal axis of the block (or subset) and are
+ *   then refit by least squares. Fast writes mode 6 only (one subset, RGBA,
+ *   4-bit indices). Normal also tries mode 5 for the channel mode 6 fits worst
+ *   (rotated into its separate scalar endpoints, as Unity's roughness alpha
+ *   often is). High tries modes 4 and 5 with every rotation and the best-ranked
+ *   two-subset partitions of modes 1 and 3 (opaque) or 7, for hard multi-color
+ *   edges, at roughly 15-20 times the cost of Fast. The three-subset modes 0
+ *   and 2 are not used. Inputs with fewer than four channels get an opaque
+ *   alpha; one channel is replicated to gray.
+ * - Edge blocks of sizes that are not a multiple of 4 repeat the last row / column.
+ * - Decompress() exists to measure the error of the encoder and decodes every
+ *   BC7 mode Compress() emits (all but 0 and 2).
+ */
+class BlockCompressor
+{
+public:
+	/** Fills rowCount rows starting at firstRow into rows (rowCount * width * channels bytes). */
+	using RowFiller = std::function<void(int firstRow, int rowCount, unsigned char* rows)>;
+
+	explicit BlockCompressor(ThreadPool& pool);
+
+	std::vector<unsigned char> Compress(const unsigned char* pixels, int width, int height, int channels,
+		BlockFormat format, BlockQuality quality) const;
+
+	/**
+	 * Like Compress(pixels, ...), but pulls the rows band by band, so the whole source image is never allocated.
+	 * Returns no blocks when the output or a band's rows could not be allocated.
+	 */
+	std::vector<unsigned char> Compress(int width, int height, int channels, BlockFormat format, BlockQuality quality,
+		const RowFiller& fill) const;
+
+	/** Decodes into width * height * GetDecodedChannels(format) bytes. */
+	static void Decompress(const unsigned char* blocks, int width, int height, BlockFormat format, unsigned char* pixels);
+
+	static int GetBlockBytes(BlockFormat format);
+	static size_t GetCompressedSize(BlockFormat format, int width, int height);
+	static int GetDecodedChannels(BlockFormat format);
+
+	static std::string_view GetFormatName(BlockFormat format);
+	static std::string_view GetQualityName(BlockQuality quality);
+
+private:
+	ThreadPool& pool;
+};
@@ -0,0 +1,103 @@
+#include "DdsWriter.h"
+
+#include <cstdint>
+#include <fstream>
+
+namespace
+{
+	constexpr uint32_t HeaderSize = 124;
+	constexpr uint32_t PixelFormatSize = 32;
+
+	constexpr uint32_t FlagCaps = 0x1;
+	constexpr uint32_t FlagHeight = 0x2;
+	constexpr uint32_t FlagWidth = 0x4;
+	constexpr uint32_t FlagPixelFormat = 0x1000;
+	constexpr uint32_t FlagMipMapCount = 0x20000;
+	constexpr uint32_t FlagLinearSize = 0x80000;
+
+	constexpr uint32_t PixelFormatFourCC = 0x4;
+
+	constexpr uint32_t CapsComplex = 0x8;
+	constexpr uint32_t CapsTexture = 0x1000;
+	constexpr uint32_t CapsMipMap = 0x400000;
+
+	constexpr uint32_t ResourceDimensionTexture2D = 3;
+
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(static_cast<unsigned char>(a)) | static_cast<uint32_t>(static_cast<unsigned char>(b)) << 8
+			| static_cast<uint32_t>(static_cast<unsigned char>(c)) << 16 | static_cast<uint32_t>(static_cast<unsigned char>(d)) << 24;
+	}
+
+	void PutLittleEndian(std::vector<unsigned char>& out, uint32_t value)
+	{
+		out.push_back(static_cast<unsigned char>(value));
+		out.push_back(static_cast<unsigned char>(value >> 8));
+		out.push_back(static_cast<unsigned char>(value >> 16));
+		out.push_back(static_cast<unsigned char>(value >> 24));
+	}
+}
+
+[[nodiscard]] bool DdsWriter::Write(const std::string& path, int width, int height, BlockFormat format,
+	const std::vector<std::vector<unsigned char>>& levels)
+{
+	const uint32_t dxgiFormat = GetDxgiFormat(format);
+	if(!dxgiFormat || width <= 0 || height <= 0 || levels.empty())
+		return false;
+
+	const bool hasMips = levels.size() > 1;
+	uint32_t flags = FlagCaps | FlagHeight | FlagWidth | FlagPixelFormat | FlagLinearSize;
+	uint32_t caps = CapsTexture;
+	if(hasMips) {
+		flags |= FlagMipMapCount;
+		caps |= CapsComplex | CapsMipMap;
+	}
+
+	std::vector<unsigned char> header;
+	header.reserve(4 + HeaderSize + 20);
+	PutLittleEndian(header, MakeFourCC('D', 'D', 'S', ' '));
+	PutLittleEndian(header, HeaderSize);
+	PutLittleEndian(header, flags);
+	PutLittleEndian(header, static_cast<uint32_t>(height));
+	PutLittleEndian(header, static_cast<uint32_t>(width));
+	PutLittleEndian(header, static_cast<uint32_t>(BlockCompressor::GetCompressedSize(format, width, height)));
+	PutLittleEndian(header, 0);  // depth
+	PutLittleEndian(header, static_cast<uint32_t>(levels.size()));
+	for(int i = 0; i < 11; ++i)
+		PutLittleEndian(header, 0);  // reserved
+
+	PutLittleEndian(header, PixelFormatSize);
+	PutLittleEndian(header, PixelFormatFourCC);
+	PutLittleEndian(header, MakeFourCC('D', 'X', '1', '0'));
+	for(int i = 0; i < 5; ++i)
+		PutLittleEndian(header, 0);  // bit count and masks
+
+	PutLittleEndian(header, caps);
+	for(int i = 0; i < 4; ++i)
+		PutLittleEndian(header, 0);  // caps2-4, reserved
+
+	PutLittleEndian(header, dxgiFormat);
+	PutLittleEndian(header, ResourceDimensionTexture2D);
+	PutLittleEndian(header, 0);  // misc flags
+	PutLittleEndian(header, 1);  // array size
+	PutLittleEndian(header, 0);  // alpha mode unknown
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if(!file)
+		return false;
+
+	file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+	for(const std::vector<unsigned char>& level : levels)
+		file.write(reinterpret_cast<const char*>(level.data()), static_cast<std::streamsize>(level.size()));
+	return static_cast<bool>(file.flush());
+}
+
+unsigned int DdsWriter::GetDxgiFormat(BlockFormat format)
+{
+	switch(format) {
+		case BlockFormat::BC4: return 80;  // DXGI_FORMAT_BC4_UNORM
+		case BlockFormat::BC5: return 83;  // DXGI_FORMAT_BC5_UNORM
+		case BlockFormat::BC7: return 98;  // DXGI_FORMAT_BC7_UNORM
+		default: return 0;
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "BlockCompressor.h"
+
+/**
+ * Class: DdsWriter
+ *
+ * Writes block-compressed textures as DirectDraw Surface files with the DX10
+ * extended header (DXGI_FORMAT_BC4_UNORM / BC5_UNORM / BC7_UNORM), which
+ * Unreal, Unity, DirectXTex and most texture viewers read as-is.
+ *
+ * Notes:
+ * - levels[0] is the full-size image; further entries are successive mips,
+ *   each half the size of the previous one (rounded down, at least 1).
+ */
+class DdsWriter
+{
+public:
+	[[nodiscard]] static bool Write(const std::string& path, int width, int height, BlockFormat format,
+		const std::vector<std::vector<unsigned char>>& levels);
+
+	/** DXGI_FORMAT value of a block format, 0 for None. */
+	static unsigned int GetDxgiFormat(BlockFormat format);
+};
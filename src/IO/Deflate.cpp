@@ -0,0 +1,362 @@
+#include "Deflate.h"
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+	constexpr size_t WindowSize = 32768;
+	constexpr int HashBits = 15;
+	constexpr int MinMatch = 3;
+	constexpr int MaxMatch = 258;
+
+	constexpr uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	constexpr uint16_t DistBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	constexpr uint8_t DistExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	struct LevelParams
+	{
+		int maxChain;
+		int niceLength;
+		bool lazy;
+	};
+
+	constexpr LevelParams Levels[10] = {
+		{ 0, 0, false },
+		{ 4, 8, false }, { 8, 16, false }, { 16, 32, false },
+		{ 16, 32, true }, { 32, 64, true }, { 64, 128, true },
+		{ 128, MaxMatch, true }, { 256, MaxMatch, true }, { 1024, MaxMatch, true }
+	};
+
+	uint32_t ReverseBits(uint32_t code, int length)
+	{
+		uint32_t reversed = 0;
+		for(int i = 0; i < length; ++i) {
+			reversed = (reversed << 1) | (code & 1);
+			code >>= 1;
+		}
+		return reversed;
+	}
+
+	// Fixed Huffman codes (RFC 1951, 3.2.6), stored bit-reversed for LSB-first output.
+	struct FixedTables
+	{
+		uint16_t litCode[288];
+		uint8_t litLength[288];
+		uint8_t distCode[30];
+		uint8_t lengthIndex[MaxMatch + 1];
+		uint8_t distIndex[512];
+
+		FixedTables()
+		{
+			for(int s = 0; s < 288; ++s) {
+				uint32_t code;
+				int length;
+				if(s < 144) { code = 0x30 + s; length = 8; }
+				else if(s < 256) { code = 0x190 + (s - 144); length = 9; }
+				else if(s < 280) { code = s - 256; length = 7; }
+				else { code = 0xC0 + (s - 280); length = 8; }
+				litCode[s] = static_cast<uint16_t>(ReverseBits(code, length));
+				litLength[s] = static_cast<uint8_t>(length);
+			}
+			for(int d = 0; d < 30; ++d)
+				distCode[d] = static_cast<uint8_t>(ReverseBits(d, 5));
+
+			for(int len = MinMatch, index = 0; len <= MaxMatch; ++len) {
+				while(index + 1 < 29 && LengthBase[index + 1] <= len)
+					++index;
+				lengthIndex[len] = static_cast<uint8_t>(index);
+			}
+
+			// Distances 1..256 map directly; larger ones via (dist - 1) >> 7, as in zlib.
+			for(int d = 0, index = 0; d < 256; ++d) {
+				while(index + 1 < 30 && DistBase[index + 1] <= d + 1)
+					++index;
+				distIndex[d] = static_cast<uint8_t>(index);
+			}
+			for(int d = 256, index = 0; d < 512; ++d) {
+				const int dist = ((d - 256) << 7) + 1;
+				while(index + 1 < 30 && DistBase[index + 1] <= dist)
+					++index;
+				distIndex[d] = static_cast<uint8_t>(index);
+			}
+		}
+
+		int DistanceIndex(int dist) const
+		{
+			return dist <= 256 ? distIndex[dist - 1] : distIndex[256 + ((dist - 1) >> 7)];
+		}
+	};
+
+	const FixedTables& Tables()
+	{
+		static const FixedTables tables;
+		return tables;
+	}
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<unsigned char>& out) : out(out) {}
+
+		void Put(uint32_t bits, int count)
+		{
+			buffer |= static_cast<uint64_t>(bits) << bitCount;
+			bitCount += count;
+			while(bitCount >= 8) {
+				out.push_back(static_cast<unsigned char>(buffer));
+				buffer >>= 8;
+				bitCount -= 8;
+			}
+		}
+
+		void AlignToByte()
+		{
+			if(bitCount > 0)
+				Put(0, 8 - bitCount);
+		}
+
+	private:
+		std::vector<unsigned char>& out;
+		uint64_t buffer = 0;
+		int bitCount = 0;
+	};
+
+	void WriteStored(const unsigned char* data, size_t size, bool final, std::vector<unsigned char>& out)
+	{
+		BitWriter bits(out);
+		size_t offset = 0;
+		do {
+			const size_t chunk = std::min<size_t>(size - offset, 65535);
+			const bool last = offset + chunk == size;
+			bits.Put(final && last ? 1 : 0, 1);
+			bits.Put(0, 2);
+			bits.AlignToByte();
+			bits.Put(static_cast<uint32_t>(chunk), 16);
+			bits.Put(static_cast<uint32_t>(~chunk & 0xFFFF), 16);
+			out.insert(out.end(), data + offset, data + offset + chunk);
+			offset += chunk;
+		} while(offset < size);
+	}
+
+	class Compressor
+	{
+	public:
+		Compressor(const unsigned char* data, size_t size, const LevelParams& params, BitWriter& bits)
+			: data(data), size(size), params(params), bits(bits), tables(Tables()),
+			head(static_cast<size_t>(1) << HashBits, -1), prev(WindowSize, -1)
+		{
+		}
+
+		void Run()
+		{
+			struct Match { int length = 0; int distance = 0; };
+
+			size_t i = 0;
+			Match pending;
+			bool hasPending = false;
+
+			while(i < size)
+			{
+				Match current;
+				if(hasPending) {
+					current = pending;
+					hasPending = false;
+				}
+				else {
+					InsertUpTo(i);
+					current.length = FindMatch(i, current.distance);
+				}
+
+				// Lazy evaluation: prefer a literal now if the next position matches longer.
+				if(params.lazy && current.length >= MinMatch && current.length < params.niceLength && i + 1 < size) {
+					InsertUpTo(i + 1);
+					Match next;
+					next.length = FindMatch(i + 1, next.distance);
+					if(next.length > current.length) {
+						EmitLiteral(data[i]);
+						++i;
+						pending = next;
+						hasPending = true;
+						continue;
+					}
+				}
+
+				if(current.length >= MinMatch) {
+					EmitMatch(current.length, current.distance);
+					i += current.length;
+				}
+				else {
+					EmitLiteral(data[i]);
+					++i;
+				}
+			}
+			InsertUpTo(size);
+		}
+
+	private:
+		uint32_t Hash(size_t p) const
+		{
+			const uint32_t v = (static_cast<uint32_t>(data[p]) << 16) | (static_cast<uint32_t>(data[p + 1]) << 8) | data[p + 2];
+			return (v * 2654435761u) >> (32 - HashBits);
+		}
+
+		void InsertUpTo(size_t end)
+		{
+			const size_t limit = size >= MinMatch ? size - MinMatch + 1 : 0;
+			for(end = std::min(end, limit); inserted < end; ++inserted) {
+				const uint32_t h = Hash(inserted);
+				prev[inserted & (WindowSize - 1)] = head[h];
+				head[h] = static_cast<int32_t>(inserted);
+			}
+			inserted = std::max(inserted, end);
+		}
+
+		int FindMatch(size_t p, int& distance) const
+		{
+			if(p + MinMatch > size)
+				return 0;
+
+			const int maxLength = static_cast<int>(std::min<size_t>(MaxMatch, size - p));
+			int best = MinMatch - 1;
+			int chain = params.maxChain;
+			int32_t candidate = head[Hash(p)];
+			const unsigned char* target = data + p;
+
+			while(candidate >= 0 && p - candidate <= WindowSize && chain-- > 0)
+			{
+				const unsigned char* match = data + candidate;
+				if(match[best] == target[best] && match[0] == target[0] && match[1] == target[1]) {
+					int length = 2;
+					while(length < maxLength && match[length] == target[length])
+						++length;
+					if(length > best) {
+						best = length;
+						distance = static_cast<int>(p - candidate);
+						if(length >= params.niceLength || length == maxLength)
+							break;
+					}
+				}
+
+				const int32_t next = prev[candidate & (WindowSize - 1)];
+				if(next >= candidate)
+					break;
+				candidate = next;
+			}
+			return best >= MinMatch ? best : 0;
+		}
+
+		void EmitLiteral(unsigned char value)
+		{
+			bits.Put(tables.litCode[value], tables.litLength[value]);
+		}
+
+		void EmitMatch(int length, int distance)
+		{
+			const int li = tables.lengthIndex[length];
+			bits.Put(tables.litCode[257 + li], tables.litLength[257 + li]);
+			if(LengthExtra[li])
+				bits.Put(length - LengthBase[li], LengthExtra[li]);
+
+			const int di = tables.DistanceIndex(distance);
+			bits.Put(tables.distCode[di], 5);
+			if(DistExtra[di])
+				bits.Put(distance - DistBase[di], DistExtra[di]);
+		}
+
+		const unsigned char* data;
+		const size_t size;
+		const LevelParams& params;
+		BitWriter& bits;
+		const FixedTables& tables;
+		std::vector<int32_t> head;
+		std::vector<int32_t> prev;
+		size_t inserted = 0;
+	};
+
+	std::array<uint32_t, 256> BuildCrcTable()
+	{
+		std::array<uint32_t, 256> table{};
+		for(uint32_t n = 0; n < 256; ++n) {
+			uint32_t c = n;
+			for(int k = 0; k < 8; ++k)
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+		return table;
+	}
+}
+
+void Deflate::CompressSegment(const unsigned char* data, size_t size, int level, bool final, std::vector<unsigned char>& out)
+{
+	level = std::clamp(level, 0, 9);
+	if(level == 0) {
+		WriteStored(data, size, final, out);
+		return;
+	}
+
+	BitWriter bits(out);
+	if(size > 0 || final) {
+		bits.Put(final ? 1 : 0, 1);
+		bits.Put(1, 2);
+		Compressor(data, size, Levels[level], bits).Run();
+		bits.Put(Tables().litCode[256], Tables().litLength[256]);
+	}
+
+	if(!final) {
+		// Sync flush: an empty stored block realigns the stream to a byte boundary.
+		bits.Put(0, 3);
+		bits.AlignToByte();
+		bits.Put(0x0000, 16);
+		bits.Put(0xFFFF, 16);
+	}
+	bits.AlignToByte();
+}
+
+uint32_t Deflate::Adler32(const unsigned char* data, size_t size, uint32_t adler)
+{
+	constexpr uint32_t Base = 65521;
+	constexpr size_t NMax = 5552;
+
+	uint32_t a = adler & 0xFFFF;
+	uint32_t b = adler >> 16;
+	while(size > 0) {
+		const size_t block = std::min(size, NMax);
+		for(size_t i = 0; i < block; ++i) {
+			a += data[i];
+			b += a;
+		}
+		a %= Base;
+		b %= Base;
+		data += block;
+		size -= block;
+	}
+	return (b << 16) | a;
+}
+
+uint32_t Deflate::CombineAdler32(uint32_t adlerA, uint32_t adlerB, size_t sizeB)
+{
+	constexpr uint32_t Base = 65521;
+
+	const uint32_t rem = static_cast<uint32_t>(sizeB % Base);
+	uint32_t sum1 = adlerA & 0xFFFF;
+	uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(rem) * sum1) % Base);
+	sum1 += (adlerB & 0xFFFF) + Base - 1;
+	sum2 += (adlerA >> 16) + (adlerB >> 16) + Base - rem;
+	if(sum1 >= Base) sum1 -= Base;
+	if(sum1 >= Base) sum1 -= Base;
+	if(sum2 >= (Base << 1)) sum2 -= (Base << 1);
+	if(sum2 >= Base) sum2 -= Base;
+	return sum1 | (sum2 << 16);
+}
+
+uint32_t Deflate::Crc32(const unsigned char* data, size_t size, uint32_t crc)
+{
+	static const std::array<uint32_t, 256> table = BuildCrcTable();
+
+	uint32_t c = crc ^ 0xFFFFFFFFu;
+	for(size_t i = 0; i < size; ++i)
+		c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+	return c ^ 0xFFFFFFFFu;
+}
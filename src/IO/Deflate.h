@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Class: Deflate
+ *
+ * Small raw-DEFLATE (RFC 1951) encoder built for parallel compression.
+ * Each call compresses one independent segment; non-final segments end with an
+ * empty stored block (a "sync flush"), so segments produced on different threads
+ * can simply be concatenated into one valid stream, as pigz does.
+ *
+ * Notes:
+ * - LZ77 with hash chains over a 32 KiB window, encoded with the fixed Huffman
+ *   tables (the same scheme as stb_image_write). Level 0 emits stored blocks,
+ *   levels 1-9 trade chain depth and lazy matching for ratio.
+ * - Segments do not share a dictionary, so keep them at least a few hundred KiB.
+ */
+class Deflate
+{
+public:
+	static constexpr int DefaultLevel = 6;
+
+	/** Appends the compressed segment to out; the result always ends on a byte boundary. */
+	static void CompressSegment(const unsigned char* data, size_t size, int level, bool final, std::vector<unsigned char>& out);
+
+	static uint32_t Adler32(const unsigned char* data, size_t size, uint32_t adler = 1);
+
+	/** Adler-32 of A||B from adler(A), adler(B) and the length of B. */
+	static uint32_t CombineAdler32(uint32_t adlerA, uint32_t adlerB, size_t sizeB);
+
+	static uint32_t Crc32(const unsigned char* data, size_t size, uint32_t crc = 0);
+};
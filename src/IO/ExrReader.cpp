@@ -0,0 +1,361 @@
+#include "ExrReader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "BufferPool.h"
+
+// Declarations only, for stbi_zlib_decode_buffer: IOService.cpp compiles the implementation.
+#undef STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+namespace
+{
+	constexpr unsigned char Magic[4] = { 0x76, 0x2F, 0x31, 0x01 };
+
+	constexpr uint32_t FlagTiled = 0x200;
+	constexpr uint32_t FlagDeep = 0x800;
+	constexpr uint32_t FlagMultiPart = 0x1000;
+
+	constexpr uint8_t CompressionNone = 0;
+	constexpr uint8_t CompressionRle = 1;
+	constexpr uint8_t CompressionZips = 2;
+	constexpr uint8_t CompressionZip = 3;
+
+	constexpr int32_t PixelUInt = 0;
+	constexpr int32_t PixelHalf = 1;
+	constexpr int32_t PixelFloat = 2;
+
+	struct Channel
+	{
+		std::string name;
+		int32_t type = PixelHalf;
+		float weight = 0.0f;
+	};
+
+	/** Bounds-checked little-endian reads; a read past the end sets failed and yields zeros. */
+	class Reader
+	{
+	public:
+		Reader(const unsigned char* data, size_t size) : data(data), size(size) {}
+
+		uint32_t Get32()
+		{
+			uint32_t value = 0;
+			for(int i = 0; i < 4; ++i)
+				value |= static_cast<uint32_t>(GetByte()) << (8 * i);
+			return value;
+		}
+
+		uint64_t Get64()
+		{
+			const uint64_t low = Get32();
+			return low | static_cast<uint64_t>(Get32()) << 32;
+		}
+
+		uint8_t GetByte()
+		{
+			if(position >= size) {
+				failed = true;
+				return 0;
+			}
+			return data[position++];
+		}
+
+		std::string GetString()
+		{
+			std::string value;
+			for(uint8_t c = GetByte(); c && !failed; c = GetByte())
+				value.push_back(static_cast<char>(c));
+			return value;
+		}
+
+		const unsigned char* data;
+		size_t size;
+		size_t position = 0;
+		bool failed = false;
+	};
+
+	float HalfToFloat(uint16_t half)
+	{
+		const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+		uint32_t exponent = (half >> 10) & 0x1Fu;
+		uint32_t mantissa = half & 0x3FFu;
+
+		uint32_t bits = sign;
+		if(exponent == 31)
+			bits |= 0x7F800000u | (mantissa << 13);
+		else if(exponent != 0)
+			bits |= ((exponent + 112) << 23) | (mantissa << 13);
+		else if(mantissa != 0) {
+			// Subnormal half: normalize into a float exponent.
+			exponent = 113;
+			while(!(mantissa & 0x400u)) {
+				mantissa <<= 1;
+				--exponent;
+			}
+			bits |= (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+		}
+
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	int GetSampleBytes(int32_t type)
+	{
+		return type == PixelHalf ? 2 : 4;
+	}
+
+	float GetSample(const unsigned char* p, int32_t type)
+	{
+		if(type == PixelHalf)
+			return HalfToFloat(static_cast<uint16_t>(p[0] | p[1] << 8));
+
+		const uint32_t bits = p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+		if(type == PixelUInt)
+			return static_cast<float>(bits / 4294967295.0);
+
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	bool DecodeRle(const unsigned char* in, size_t size, unsigned char* out, size_t outSize)
+	{
+		size_t i = 0;
+		size_t o = 0;
+		while(i < size) {
+			const int count = static_cast<signed char>(in[i++]);
+			if(count < 0) {
+				const size_t run = static_cast<size_t>(-count);
+				if(run > size - i || run > outSize - o)
+					return false;
+				std::memcpy(out + o, in + i, run);
+				i += run;
+				o += run;
+			}
+			else {
+				const size_t run = static_cast<size_t>(count) + 1;
+				if(i >= size || run > outSize - o)
+					return false;
+				std::memset(out + o, in[i++], run);
+				o += run;
+			}
+		}
+		return o == outSize;
+	}
+
+	/** RLE and ZIP store byte deltas of the two byte halves of the block; undo both steps. */
+	void Reconstruct(std::vector<unsigned char>& packed, std::vector<unsigned char>& out)
+	{
+		const size_t n = packed.size();
+		for(size_t i = 1; i < n; ++i)
+			packed[i] = static_cast<unsigned char>(packed[i - 1] + packed[i] - 128);
+
+		const unsigned char* first = packed.data();
+		const unsigned char* second = packed.data() + (n + 1) / 2;
+		out.resize(n);
+		for(size_t i = 0; i < n; ++i)
+			out[i] = (i & 1) ? *second++ : *first++;
+	}
+
+	/** Weights of the channels that make up the gray value; see the class notes. */
+	bool SelectChannels(std::vector<Channel>& channels)
+	{
+		auto find = [&] (const char* name) -> Channel* {
+			for(Channel& channel : channels) {
+				if(channel.name == name)
+					return &channel;
+			}
+			return nullptr;
+		};
+
+		if(Channel* y = find("Y")) {
+			y->weight = 1.0f;
+			return true;
+		}
+
+		Channel* r = find("R");
+		Channel* g = find("G");
+		Channel* b = find("B");
+		if(r && g && b) {
+			r->weight = 77.0f / 256.0f;
+			g->weight = 150.0f / 256.0f;
+			b->weight = 29.0f / 256.0f;
+			return true;
+		}
+
+		for(Channel& channel : channels) {
+			if(channel.name != "A") {
+				channel.weight = 1.0f;
+				return true;
+			}
+		}
+		if(channels.empty())
+			return false;
+		channels.front().weight = 1.0f;
+		return true;
+	}
+}
+
+bool ExrReader::IsExr(const unsigned char* data, size_t size)
+{
+	return size >= sizeof(Magic) && std::memcmp(data, Magic, sizeof(Magic)) == 0;
+}
+
+float* ExrReader::LoadGrayscale(const unsigned char* data, size_t size, int& width, int& height, const char*& error)
+{
+	Reader reader(data, size);
+	if(size < 8 || !IsExr(data, size)) {
+		error = "not an OpenEXR file";
+		return nullptr;
+	}
+	reader.position = 4;
+	const uint32_t version = reader.Get32();
+	if((version & 0xFF) != 2 || (version & (FlagTiled | FlagDeep | FlagMultiPart))) {
+		error = "unsupported EXR: only single-part scanline images are read";
+		return nullptr;
+	}
+
+	std::vector<Channel> channels;
+	uint8_t compression = 0xFF;
+	int32_t window[4] = { 0, 0, -1, -1 };
+	bool hasWindow = false;
+	for(;;) {
+		const std::string name = reader.GetString();
+		if(name.empty() || reader.failed)
+			break;
+		reader.GetString();  // attribute type, implied by the name for the ones we read
+		const uint32_t attributeSize = reader.Get32();
+		const size_t next = reader.position + attributeSize;
+
+		if(name == "channels") {
+			for(std::string channel = reader.GetString(); !channel.empty() && !reader.failed; channel = reader.GetString()) {
+				Channel entry;
+				entry.name = channel;
+				entry.type = static_cast<int32_t>(reader.Get32());
+				reader.Get32();  // pLinear and reserved bytes
+				const int32_t xSampling = static_cast<int32_t>(reader.Get32());
+				const int32_t ySampling = static_cast<int32_t>(reader.Get32());
+				if(xSampling != 1 || ySampling != 1 || entry.type < PixelUInt || entry.type > PixelFloat) {
+					error = "unsupported EXR channel (subsampled or unknown pixel type)";
+					return nullptr;
+				}
+				channels.push_back(std::move(entry));
+			}
+		}
+		else if(name == "compression")
+			compression = reader.GetByte();
+		else if(name == "dataWindow") {
+			for(int32_t& value : window)
+				value = static_cast<int32_t>(reader.Get32());
+			hasWindow = true;
+		}
+		reader.position = next;
+	}
+
+	if(reader.failed || !hasWindow || channels.empty()) {
+		error = "corrupt EXR header";
+		return nullptr;
+	}
+
+	int linesPerBlock = 1;
+	switch(compression) {
+		case CompressionNone:
+		case CompressionRle:
+		case CompressionZips: linesPerBlock = 1; break;
+		case CompressionZip: linesPerBlock = 16; break;
+		default:
+			error = "unsupported EXR compression (only none, RLE, ZIPS and ZIP are read)";
+			return nullptr;
+	}
+
+	const int64_t fullWidth = static_cast<int64_t>(window[2]) - window[0] + 1;
+	const int64_t fullHeight = static_cast<int64_t>(window[3]) - window[1] + 1;
+	if(fullWidth <= 0 || fullHeight <= 0 || fullWidth > (1 << 24) || fullHeight > (1 << 24)) {
+		error = "invalid EXR data window";
+		return nullptr;
+	}
+	SelectChannels(channels);
+
+	size_t lineBytes = 0;
+	for(const Channel& channel : channels)
+		lineBytes += static_cast<size_t>(fullWidth) * GetSampleBytes(channel.type);
+
+	const size_t blockCount = static_cast<size_t>((fullHeight + linesPerBlock - 1) / linesPerBlock);
+	std::vector<uint64_t> offsets(blockCount);
+	for(uint64_t& offset : offsets)
+		offset = reader.Get64();
+	if(reader.failed) {
+		error = "truncated EXR offset table";
+		return nullptr;
+	}
+
+	const size_t pixelCount = static_cast<size_t>(fullWidth) * static_cast<size_t>(fullHeight);
+	float* pixels = static_cast<float*>(BufferPool::Allocate(pixelCount * sizeof(float)));
+	if(!pixels) {
+		error = "out of memory";
+		return nullptr;
+	}
+	std::fill(pixels, pixels + pixelCount, 0.0f);
+
+	std::vector<unsigned char> packed;
+	std::vector<unsigned char> block;
+	for(uint64_t offset : offsets) {
+		reader.position = static_cast<size_t>(std::min<uint64_t>(offset, size));
+		const int64_t y = static_cast<int32_t>(reader.Get32());
+		const uint32_t dataSize = reader.Get32();
+		if(reader.failed || y < window[1] || y > window[3] || dataSize > size - reader.position) {
+			BufferPool::Free(pixels);
+			error = "corrupt EXR scanline block";
+			return nullptr;
+		}
+
+		const int rows = static_cast<int>(std::min<int64_t>(linesPerBlock, window[3] - y + 1));
+		const size_t expected = lineBytes * rows;
+		const unsigned char* chunk = data + reader.position;
+
+		// Writers store a block as is when compression would not make it smaller.
+		const unsigned char* lines = chunk;
+		bool ok = dataSize == expected;
+		if(!ok && compression == CompressionRle) {
+			packed.resize(expected);
+			ok = DecodeRle(chunk, dataSize, packed.data(), expected);
+		}
+		else if(!ok && (compression == CompressionZips || compression == CompressionZip)) {
+			packed.resize(expected);
+			ok = stbi_zlib_decode_buffer(reinterpret_cast<char*>(packed.data()), static_cast<int>(expected),
+				reinterpret_cast<const char*>(chunk), static_cast<int>(dataSize)) == static_cast<int>(expected);
+		}
+		if(!ok) {
+			BufferPool::Free(pixels);
+			error = "corrupt EXR scanline data";
+			return nullptr;
+		}
+		if(dataSize != expected) {
+			Reconstruct(packed, block);
+			lines = block.data();
+		}
+
+		for(int row = 0; row < rows; ++row) {
+			float* out = pixels + static_cast<size_t>(y - window[1] + row) * static_cast<size_t>(fullWidth);
+			const unsigned char* sample = lines + lineBytes * row;
+			for(const Channel& channel : channels) {
+				const int sampleBytes = GetSampleBytes(channel.type);
+				if(channel.weight != 0.0f) {
+					for(int64_t x = 0; x < fullWidth; ++x)
+						out[x] += channel.weight * GetSample(sample + x * sampleBytes, channel.type);
+				}
+				sample += static_cast<size_t>(fullWidth) * sampleBytes;
+			}
+		}
+	}
+
+	width = static_cast<int>(fullWidth);
+	height = static_cast<int>(fullHeight);
+	return pixels;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * Class: ExrReader
+ *
+ * Minimal OpenEXR reader for baked data maps: single-part scanline files with
+ * HALF, FLOAT or UINT channels, stored uncompressed or with RLE, ZIPS or ZIP
+ * compression (what bakers write by default). The result is one float channel.
+ *
+ * Notes:
+ * - Channel choice: Y if present, otherwise the luminance of R, G and B with the
+ *   weights LoadGrayscale uses, otherwise the first channel that is not alpha.
+ * - Tiled, deep and multi-part files, subsampled channels and the lossy or
+ *   wavelet codecs (PIZ, PXR24, B44, DWA) are rejected with an error.
+ * - The pixels come from BufferPool, like stb's, so IOService::FreePixels
+ *   releases them.
+ */
+class ExrReader
+{
+public:
+	/** True when the data starts with the OpenEXR magic number. */
+	static bool IsExr(const unsigned char* data, size_t size);
+
+	/** Decodes the data window of a file held in memory; null on failure, with error set to a static message. */
+	static float* LoadGrayscale(const unsigned char* data, size_t size, int& width, int& height, const char*& error);
+};
@@ -1,21 +1,192 @@
 #include "IOService.h"
 
-bool IOService::SavePNG(const std::string& filename, unsigned int textureId, int width, int height)
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <filesystem>
+#include <type_traits>
+
+#include "BufferPool.h"
+
+// Decoded images come from BufferPool, so a batch reuses the previous material's pixel
+// buffers; stbi_image_free (FreePixels) hands them back.
+#define STBI_MALLOC(size) BufferPool::Allocate(size)
+#define STBI_REALLOC(pointer, size) BufferPool::Reallocate(pointer, size)
+#define STBI_FREE(pointer) BufferPool::Free(pointer)
+#include <stb_image.h>
+#include <stb_image_write.h>
+
+#include "ExrReader.h"
+#include "MappedFile.h"
+
+bool IOService::SavePNG(const std::string& filename, int width, int height, int channels, const unsigned char* pixels)
+{
+    return SavePixelsPNG(filename, width, height, channels, pixels);
+}
+
+bool IOService::SaveTGA(const std::string& filename, int width, int height, int channels, const unsigned char* pixels)
+{
+    return stbi_write_tga(filename.c_str(), width, height, channels, pixels) != 0;
+}
+
+bool IOService::SaveBMP(const std::string& filename, int width, int height, int channels, const unsigned char* pixels)
+{
+    return stbi_write_bmp(filename.c_str(), width, height, channels, pixels) != 0;
+}
+
+bool IOService::SaveJPG(const std::string& filename, int width, int height, int channels, const unsigned char* pixels, int quality)
+{
+    return stbi_write_jpg(filename.c_str(), width, height, channels, pixels, quality) != 0;
+}
+
+bool IOService::SaveImage(const std::string& filename, ImageFormat format, int width, int height, int channels,
+    const unsigned char* pixels, int jpgQuality)
+{
+    if(!pixels || width <= 0 || height <= 0 || channels < 1 || channels > 4)
+        return false;
+
+    switch(format)
+    {
+    case ImageFormat::TGA: return SaveTGA(filename, width, height, channels, pixels);
+    case ImageFormat::BMP: return SaveBMP(filename, width, height, channels, pixels);
+    case ImageFormat::JPG: return SaveJPG(filename, width, height, channels, pixels, jpgQuality);
+    default: return SavePNG(filename, width, height, channels, pixels);
+    }
+}
+
+ImageFormat IOService::GetFormatFromPath(const std::string& filename)
+{
+    std::string extension = std::filesystem::path(filename).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [] (unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    if(extension == ".tga") return ImageFormat::TGA;
+    if(extension == ".bmp") return ImageFormat::BMP;
+    if(extension == ".jpg" || extension == ".jpeg") return ImageFormat::JPG;
+    return ImageFormat::PNG;
+}
+
+const char* IOService::GetExtension(ImageFormat format)
+{
+    switch(format)
+    {
+    case ImageFormat::TGA: return "tga";
+    case ImageFormat::BMP: return "bmp";
+    case ImageFormat::JPG: return "jpg";
+    default: return "png";
+    }
+}
+
+namespace
 {
-    return false;
+    // Compacts a decoded image to the first channel (gray + alpha) or luminance (RGB/RGBA)
+    // front to back; the write index never overtakes the read index, so this is safe in place.
+    template<typename T>
+    T* ReduceToGray(T* pixels, int width, int height, int channels)
+    {
+        const size_t count = static_cast<size_t>(width) * height;
+        if(channels == 2) {
+            for(size_t i = 0; i < count; ++i)
+                pixels[i] = pixels[i * 2];
+        }
+        else {
+            for(size_t i = 0; i < count; ++i) {
+                const T* p = pixels + i * channels;
+                if constexpr(std::is_floating_point_v<T>)
+                    pixels[i] = (p[0] * 77.0f + p[1] * 150.0f + p[2] * 29.0f) / 256.0f;
+                else
+                    pixels[i] = static_cast<T>((p[0] * 77u + p[1] * 150u + p[2] * 29u) >> 8);
+            }
+        }
+
+        // Give back the unused tail with stb's own allocator (BufferPool) so FreePixels stays valid.
+        T* shrunk = static_cast<T*>(STBI_REALLOC_SIZED(pixels, count * channels * sizeof(T), count * sizeof(T)));
+        return shrunk ? shrunk : pixels;
+    }
+
+    // Failure reason of the last load on this thread when it failed outside stb
+    // (mapping, EXR); stb keeps its own for everything else.
+    thread_local const char* ioError = nullptr;
+
+    // stb's memory readers take an int length, which also bounds what it can decode.
+    bool MapSource(const std::string& filename, MappedFile& file)
+    {
+        ioError = nullptr;
+        if(!file.Open(filename)) {
+            ioError = "can't open file";
+            return false;
+        }
+        if(file.GetSize() > static_cast<size_t>(INT_MAX)) {
+            ioError = "file too large (2 GiB limit)";
+            return false;
+        }
+        return true;
+    }
+
+    template<typename T, typename LoadFn>
+    T* DecodeGray(const MappedFile& file, int& width, int& height, LoadFn load)
+    {
+        int channels = 0;
+        T* pixels = load(file.GetData(), static_cast<int>(file.GetSize()), &width, &height, &channels, 0);
+        return pixels && channels > 1 ? ReduceToGray(pixels, width, height, channels) : pixels;
+    }
+}
+
+unsigned char* IOService::LoadPixels(const std::string& filename, int& width, int& height, int desiredChannels)
+{
+    MappedFile file;
+    if(!MapSource(filename, file))
+        return nullptr;
+
+    int channels;
+    return stbi_load_from_memory(file.GetData(), static_cast<int>(file.GetSize()), &width, &height, &channels, desiredChannels);
+}
+
+unsigned char* IOService::LoadGrayscale(const std::string& filename, int& width, int& height)
+{
+    MappedFile file;
+    return MapSource(filename, file) ? DecodeGray<stbi_uc>(file, width, height, stbi_load_from_memory) : nullptr;
+}
+
+void* IOService::LoadGrayscale(const std::string& filename, int& width, int& height, int& bitDepth)
+{
+    // One mapping serves the format probes and the decode.
+    MappedFile file;
+    if(!MapSource(filename, file))
+        return nullptr;
+
+    const stbi_uc* data = file.GetData();
+    const int size = static_cast<int>(file.GetSize());
+    if(ExrReader::IsExr(data, file.GetSize())) {
+        bitDepth = 32;
+        return ExrReader::LoadGrayscale(data, file.GetSize(), width, height, ioError);
+    }
+    if(stbi_is_hdr_from_memory(data, size)) {
+        // stbi_loadf applies no gamma to Radiance files, so the samples stay linear.
+        bitDepth = 32;
+        return DecodeGray<float>(file, width, height, stbi_loadf_from_memory);
+    }
+    if(stbi_is_16_bit_from_memory(data, size)) {
+        bitDepth = 16;
+        return DecodeGray<stbi_us>(file, width, height, stbi_load_16_from_memory);
+    }
+    bitDepth = 8;
+    return DecodeGray<stbi_uc>(file, width, height, stbi_load_from_memory);
 }
 
-bool IOService::SaveTGA(const std::string& filename, unsigned int textureId, int width, int height)
+void IOService::FreePixels(void* pixels)
 {
-    return false;
+    if(pixels) stbi_image_free(pixels);
 }
 
-bool IOService::SaveBMP(const std::string& filename, unsigned int textureId, int width, int height)
+bool IOService::SavePixelsPNG(const std::string& filename, int width, int height, int channels, const unsigned char* pixels)
 {
-    return false;
+    return stbi_write_png(filename.c_str(), width, height, channels, pixels, width * channels) != 0;
 }
 
-bool IOService::SaveJPG(const std::string& filename, unsigned int textureId, int width, int height, int quality)
+const char* IOService::GetLastError()
 {
-    return false;
+    if(ioError)
+        return ioError;
+    const char* reason = stbi_failure_reason();
+    return reason ? reason : "unknown error";
 }
@@ -2,12 +2,44 @@
 
 #include <string>
 
+enum class ImageFormat
+{
+	PNG,
+	TGA,
+	BMP,
+	JPG
+};
+
 class IOService
 {
 public:
-	static bool SavePNG(const std::string& filename, unsigned int textureId, int width, int height);
-	static bool SaveTGA(const std::string& filename, unsigned int textureId, int width, int height);
-	static bool SaveBMP(const std::string& filename, unsigned int textureId, int width, int height);
-	static bool SaveJPG(const std::string& filename, unsigned int textureId, int width, int height, int quality = 90);
+	// CPU-side encoders for interleaved 8-bit pixels (1-4 channels). Textures are read back
+	// by TextureExporter on the render thread, so this class never touches OpenGL.
+	static bool SavePNG(const std::string& filename, int width, int height, int channels, const unsigned char* pixels);
+	static bool SaveTGA(const std::string& filename, int width, int height, int channels, const unsigned char* pixels);
+	static bool SaveBMP(const std::string& filename, int width, int height, int channels, const unsigned char* pixels);
+	static bool SaveJPG(const std::string& filename, int width, int height, int channels, const unsigned char* pixels, int quality = 90);
+	static bool SaveImage(const std::string& filename, ImageFormat format, int width, int height, int channels,
+		const unsigned char* pixels, int jpgQuality = 90);
+
+	// Format from the file extension (case-insensitive); anything unknown is PNG.
+	static ImageFormat GetFormatFromPath(const std::string& filename);
+	static const char* GetExtension(ImageFormat format);
+
+	// CPU-side image file access. Files are memory-mapped (MappedFile) and decoded from the
+	// mapped pages, so nothing is read into a heap buffer before decoding. This translation unit
+	// owns the stb implementations; ExrReader includes stb_image.h for declarations only.
+	static unsigned char* LoadPixels(const std::string& filename, int& width, int& height, int desiredChannels);
+
+	// Decodes to one 8-bit channel. Grayscale files decode straight into the plane; colour
+	// files are reduced to luminance in place (stb's weights), without a second buffer.
+	static unsigned char* LoadGrayscale(const std::string& filename, int& width, int& height);
+
+	// The same at the file's own depth: bitDepth 16 for 16-bit PNG / PNM (uint16_t samples),
+	// 32 for Radiance HDR and OpenEXR (linear float samples), 8 otherwise.
+	static void* LoadGrayscale(const std::string& filename, int& width, int& height, int& bitDepth);
+	static void FreePixels(void* pixels);
+	static bool SavePixelsPNG(const std::string& filename, int width, int height, int channels, const unsigned char* pixels);
+	static const char* GetLastError();
 
-};
\ No newline at end of file
+};
@@ -0,0 +1,250 @@
+#include "Ktx2Writer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+
+#ifdef ORM_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace
+{
+	constexpr unsigned char Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	constexpr uint32_t HeaderBytes = 80;  // identifier, header and index
+	constexpr uint32_t LevelIndexEntryBytes = 24;
+	constexpr uint32_t SupercompressionZstd = 2;
+
+	// Khronos data format descriptor values.
+	constexpr uint8_t ModelRGBSDA = 1;
+	constexpr uint8_t ModelBC4 = 131;
+	constexpr uint8_t ModelBC5 = 132;
+	constexpr uint8_t ModelBC7 = 134;
+	constexpr uint8_t PrimariesBT709 = 1;
+	constexpr uint8_t TransferLinear = 1;
+	constexpr uint8_t ChannelAlpha = 15;
+
+	constexpr char WriterKey[] = "KTXwriter";
+	constexpr char WriterValue[] = "ORMTool";
+
+	struct Sample
+	{
+		uint16_t bitOffset;
+		uint8_t bitLength;
+		uint8_t channel;
+		uint32_t upper;
+	};
+
+	void Put32(std::vector<unsigned char>& out, uint32_t value)
+	{
+		for(int i = 0; i < 4; ++i)
+			out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+	}
+
+	void Put64(std::vector<unsigned char>& out, uint64_t value)
+	{
+		for(int i = 0; i < 8; ++i)
+			out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+	}
+
+	void PadTo(std::vector<unsigned char>& out, size_t alignment)
+	{
+		while(out.size() % alignment)
+			out.push_back(0);
+	}
+
+	/** The basic data format descriptor block, preceded by its total size. */
+	std::vector<unsigned char> MakeDescriptor(int channels, BlockFormat format)
+	{
+		uint8_t model = ModelRGBSDA;
+		uint8_t blockSize = 0;  // texel block dimension minus one
+		uint8_t bytesPlane = static_cast<uint8_t>(channels);
+		std::vector<Sample> samples;
+
+		switch(format) {
+			case BlockFormat::BC4:
+				model = ModelBC4;
+				blockSize = 3;
+				bytesPlane = 8;
+				samples.push_back(Sample{ 0, 63, 0, 0xFFFFFFFFu });
+				break;
+			case BlockFormat::BC5:
+				model = ModelBC5;
+				blockSize = 3;
+				bytesPlane = 16;
+				samples.push_back(Sample{ 0, 63, 0, 0xFFFFFFFFu });
+				samples.push_back(Sample{ 64, 63, 1, 0xFFFFFFFFu });
+				break;
+			case BlockFormat::BC7:
+				model = ModelBC7;
+				blockSize = 3;
+				bytesPlane = 16;
+				samples.push_back(Sample{ 0, 127, 0, 0xFFFFFFFFu });
+				break;
+			default:
+				for(int c = 0; c < channels; ++c)
+					samples.push_back(Sample{ static_cast<uint16_t>(8 * c), 7, static_cast<uint8_t>(c == 3 ? ChannelAlpha : c), 255 });
+				break;
+		}
+
+		const uint32_t blockBytes = 24 + 16 * static_cast<uint32_t>(samples.size());
+		std::vector<unsigned char> out;
+		Put32(out, 4 + blockBytes);
+		Put32(out, 0);  // vendor Khronos, descriptor type basic
+		Put32(out, 2u | (blockBytes << 16));  // version 2
+		Put32(out, model | (PrimariesBT709 << 8) | (TransferLinear << 16));  // flags: straight alpha
+		Put32(out, blockSize | (blockSize << 8));
+		Put32(out, bytesPlane);
+		Put32(out, 0);
+		for(const Sample& sample : samples) {
+			Put32(out, sample.bitOffset | (static_cast<uint32_t>(sample.bitLength) << 16) | (static_cast<uint32_t>(sample.channel) << 24));
+			Put32(out, 0);  // sample position
+			Put32(out, 0);  // lower
+			Put32(out, sample.upper);
+		}
+		return out;
+	}
+
+	std::vector<unsigned char> MakeKeyValueData()
+	{
+		std::vector<unsigned char> out;
+		Put32(out, static_cast<uint32_t>(sizeof(WriterKey) + sizeof(WriterValue)));
+		out.insert(out.end(), WriterKey, WriterKey + sizeof(WriterKey));
+		out.insert(out.end(), WriterValue, WriterValue + sizeof(WriterValue));
+		PadTo(out, 4);
+		return out;
+	}
+
+	size_t GetLevelBytes(int width, int height, int channels, BlockFormat format)
+	{
+		return format == BlockFormat::None ? static_cast<size_t>(width) * height * channels
+			: BlockCompressor::GetCompressedSize(format, width, height);
+	}
+}
+
+[[nodiscard]] bool Ktx2Writer::Write(const std::string& path, int width, int height, int channels, BlockFormat format,
+	const std::vector<Ktx2Level>& levels, bool zstd)
+{
+	const uint32_t vkFormat = GetVkFormat(channels, format);
+	if(!vkFormat || width <= 0 || height <= 0 || levels.empty() || static_cast<int>(levels.size()) > GetFullMipCount(width, height))
+		return false;
+
+	for(size_t i = 0; i < levels.size(); ++i) {
+		const size_t expected = GetLevelBytes(std::max(1, width >> i), std::max(1, height >> i), channels, format);
+		if(levels[i].uncompressedBytes != expected || (!zstd && levels[i].data.size() != expected))
+			return false;
+	}
+
+	const std::vector<unsigned char> descriptor = MakeDescriptor(channels, format);
+	const std::vector<unsigned char> keyValues = MakeKeyValueData();
+	const uint32_t levelCount = static_cast<uint32_t>(levels.size());
+	const uint32_t descriptorOffset = HeaderBytes + LevelIndexEntryBytes * levelCount;
+	const uint32_t keyValueOffset = descriptorOffset + static_cast<uint32_t>(descriptor.size());
+
+	// Unsupercompressed levels start on a multiple of both the texel block size and 4.
+	size_t alignment = 1;
+	if(!zstd) {
+		const size_t texelBytes = format == BlockFormat::None ? static_cast<size_t>(channels) : BlockCompressor::GetBlockBytes(format);
+		alignment = texelBytes % 4 == 0 ? texelBytes : texelBytes * (texelBytes % 2 == 0 ? 2 : 4);
+	}
+
+	// Smallest level first.
+	std::vector<uint64_t> offsets(levels.size());
+	uint64_t position = keyValueOffset + keyValues.size();
+	for(size_t i = levels.size(); i-- > 0;) {
+		position = (position + alignment - 1) / alignment * alignment;
+		offsets[i] = position;
+		position += levels[i].data.size();
+	}
+
+	std::vector<unsigned char> header(Identifier, Identifier + sizeof(Identifier));
+	Put32(header, vkFormat);
+	Put32(header, 1);  // type size
+	Put32(header, static_cast<uint32_t>(width));
+	Put32(header, static_cast<uint32_t>(height));
+	Put32(header, 0);  // depth
+	Put32(header, 0);  // layers
+	Put32(header, 1);  // faces
+	Put32(header, levelCount);
+	Put32(header, zstd ? SupercompressionZstd : 0);
+	Put32(header, descriptorOffset);
+	Put32(header, static_cast<uint32_t>(descriptor.size()));
+	Put32(header, keyValueOffset);
+	Put32(header, static_cast<uint32_t>(keyValues.size()));
+	Put64(header, 0);  // no supercompression global data
+	Put64(header, 0);
+	for(size_t i = 0; i < levels.size(); ++i) {
+		Put64(header, offsets[i]);
+		Put64(header, levels[i].data.size());
+		Put64(header, levels[i].uncompressedBytes);
+	}
+	header.insert(header.end(), descriptor.begin(), descriptor.end());
+	header.insert(header.end(), keyValues.begin(), keyValues.end());
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if(!file)
+		return false;
+
+	file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+	uint64_t written = header.size();
+	const char padding[16] = {};
+	for(size_t i = levels.size(); i-- > 0;) {
+		file.write(padding, static_cast<std::streamsize>(offsets[i] - written));
+		file.write(reinterpret_cast<const char*>(levels[i].data.data()), static_cast<std::streamsize>(levels[i].data.size()));
+		written = offsets[i] + levels[i].data.size();
+	}
+	return static_cast<bool>(file.flush());
+}
+
+[[nodiscard]] bool Ktx2Writer::Supercompress(Ktx2Level& level, int compressionLevel)
+{
+#ifdef ORM_HAS_ZSTD
+	std::vector<unsigned char> frame(ZSTD_compressBound(level.data.size()));
+	const size_t size = ZSTD_compress(frame.data(), frame.size(), level.data.data(), level.data.size(), compressionLevel);
+	if(ZSTD_isError(size))
+		return false;
+	frame.resize(size);
+	level.data = std::move(frame);
+	return true;
+#else
+	(void)level;
+	(void)compressionLevel;
+	return false;
+#endif
+}
+
+bool Ktx2Writer::SupportsZstd()
+{
+#ifdef ORM_HAS_ZSTD
+	return true;
+#else
+	return false;
+#endif
+}
+
+int Ktx2Writer::GetFullMipCount(int width, int height)
+{
+	int count = 1;
+	for(int size = std::max(width, height); size > 1; size >>= 1)
+		++count;
+	return count;
+}
+
+unsigned int Ktx2Writer::GetVkFormat(int channels, BlockFormat format)
+{
+	switch(format) {
+		case BlockFormat::BC4: return 139;  // VK_FORMAT_BC4_UNORM_BLOCK
+		case BlockFormat::BC5: return 141;  // VK_FORMAT_BC5_UNORM_BLOCK
+		case BlockFormat::BC7: return 145;  // VK_FORMAT_BC7_UNORM_BLOCK
+		default: break;
+	}
+
+	switch(channels) {
+		case 1: return 9;   // VK_FORMAT_R8_UNORM
+		case 2: return 16;  // VK_FORMAT_R8G8_UNORM
+		case 3: return 23;  // VK_FORMAT_R8G8B8_UNORM
+		case 4: return 37;  // VK_FORMAT_R8G8B8A8_UNORM
+		default: return 0;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "BlockCompressor.h"
+
+/** One mip level as stored in the file: raw texels or blocks, possibly supercompressed. */
+struct Ktx2Level
+{
+	std::vector<unsigned char> data;
+
+	/** Size of the level before supercompression. */
+	size_t uncompressedBytes = 0;
+};
+
+/**
+ * Class: Ktx2Writer
+ *
+ * Writes 2D textures in the Khronos KTX 2.0 container: 8-bit UNORM texels
+ * (R8 to R8G8B8A8) or BC4 / BC5 / BC7 blocks, with a data format descriptor,
+ * a KTXwriter entry and any number of mip levels.
+ *
+ * Notes:
+ * - levels[0] is the full-size image; level i is max(1, size >> i). Levels are
+ *   stored smallest first, as the specification recommends for streaming.
+ * - Zstandard supercompression (scheme 2) is only compiled in when ORM_HAS_ZSTD
+ *   is defined (CMake sets it when it finds libzstd); SupportsZstd() reports it.
+ *   Compress every level with Supercompress() before Write() and pass the same
+ *   zstd flag to both.
+ * - Data is linear (ORM maps are not color), so the transfer function is linear.
+ */
+class Ktx2Writer
+{
+public:
+	/** channels is used for raw texels (format None) and ignored for block formats. */
+	[[nodiscard]] static bool Write(const std::string& path, int width, int height, int channels, BlockFormat format,
+		const std::vector<Ktx2Level>& levels, bool zstd);
+
+	/** Replaces level.data with its Zstandard frame; false when zstd is not available or fails. */
+	[[nodiscard]] static bool Supercompress(Ktx2Level& level, int compressionLevel);
+
+	static bool SupportsZstd();
+
+	/** Number of levels in a full mip chain down to 1x1. */
+	static int GetFullMipCount(int width, int height);
+
+	/** VkFormat value of the stored data, 0 if not representable. */
+	static unsigned int GetVkFormat(int channels, BlockFormat format);
+};
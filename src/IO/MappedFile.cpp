@@ -0,0 +1,112 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)), open(std::exchange(other.open, false))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if(this != &other) {
+		Close();
+		data = std::exchange(other.data, nullptr);
+		size = std::exchange(other.size, 0);
+		open = std::exchange(other.open, false);
+	}
+	return *this;
+}
+
+[[nodiscard]] bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	// Narrow path, like the fopen calls in stb, so both accept the same names.
+	const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		return false;
+	}
+
+	if(fileSize.QuadPart > 0) {
+		// The view keeps the mapping alive; both handles can go right away.
+		const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(mapping) {
+			data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			CloseHandle(mapping);
+		}
+		if(!data) {
+			CloseHandle(file);
+			return false;
+		}
+	}
+	CloseHandle(file);
+	size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if(file < 0)
+		return false;
+
+	struct stat info;
+	if(fstat(file, &info) != 0 || !S_ISREG(info.st_mode)) {
+		::close(file);
+		return false;
+	}
+
+	if(info.st_size > 0) {
+		void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		if(view == MAP_FAILED) {
+			::close(file);
+			return false;
+		}
+		madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+		data = static_cast<const unsigned char*>(view);
+	}
+	::close(file);  // the mapping holds its own reference
+	size = static_cast<size_t>(info.st_size);
+#endif
+
+	open = true;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(data) {
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap(const_cast<unsigned char*>(data), size);
+#endif
+	}
+	data = nullptr;
+	size = 0;
+	open = false;
+}
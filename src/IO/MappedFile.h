@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * Class: MappedFile
+ *
+ * Read-only memory mapping of a whole file (mmap on POSIX, a file mapping
+ * object on Windows). Decoders read straight from the mapped pages, so the
+ * file is never copied into a heap buffer, and repeated loads of the same
+ * file are served from the OS page cache.
+ *
+ * Notes:
+ * - Move-only; the mapping is released by Close() or the destructor.
+ * - An empty file opens successfully with a null GetData() and size 0.
+ * - Open() hints sequential access, which is how image decoders read.
+ */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	[[nodiscard]] bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return open; }
+	const unsigned char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+	bool open = false;
+};
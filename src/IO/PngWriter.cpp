@@ -0,0 +1,376 @@
+#include "PngWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+
+#include "BufferPool.h"
+#include "Constants.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	constexpr unsigned char Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	void PutBigEndian(std::vector<unsigned char>& out, uint32_t value)
+	{
+		out.push_back(static_cast<unsigned char>(value >> 24));
+		out.push_back(static_cast<unsigned char>(value >> 16));
+		out.push_back(static_cast<unsigned char>(value >> 8));
+		out.push_back(static_cast<unsigned char>(value));
+	}
+
+	unsigned char GetColorType(int channels)
+	{
+		switch(channels)
+		{
+		case 1: return 0;  // grayscale
+		case 2: return 4;  // grayscale + alpha
+		case 3: return 2;  // RGB
+		default: return 6; // RGBA
+		}
+	}
+
+	/** Two-byte zlib header (CM 8, 32K window) with the FLEVEL hint for the level. */
+	void PutZlibHeader(std::vector<unsigned char>& out, int level)
+	{
+		const int flevel = level <= 1 ? 0 : level <= 5 ? 1 : level == 6 ? 2 : 3;
+		const unsigned int header = (0x78u << 8) | (static_cast<unsigned int>(flevel) << 6);
+		out.push_back(0x78);
+		out.push_back(static_cast<unsigned char>((header + (31 - header % 31) % 31) & 0xFF));
+	}
+
+	/** Tracks the bytes held by strip buffers across workers and remembers the high-water mark. */
+	class BufferMeter
+	{
+	public:
+		void Add(size_t bytes)
+		{
+			const size_t now = live.fetch_add(bytes) + bytes;
+			size_t seen = peak.load();
+			while(now > seen && !peak.compare_exchange_weak(seen, now)) {}
+		}
+
+		void Remove(size_t bytes) { live.fetch_sub(bytes); }
+		size_t GetPeak() const { return peak.load(); }
+
+	private:
+		std::atomic<size_t> live{ 0 };
+		std::atomic<size_t> peak{ 0 };
+	};
+
+	/** Appends chunks to a PNG file as strips arrive; strips must be appended in image order. */
+	class PngFileStream
+	{
+	public:
+		bool Open(const std::string& path, int width, int height, int channels, int bitDepth, int compressionLevel)
+		{
+			file.open(path, std::ios::binary | std::ios::trunc);
+			if(!file)
+				return false;
+
+			level = compressionLevel;
+			file.write(reinterpret_cast<const char*>(Signature), sizeof(Signature));
+
+			std::vector<unsigned char> header;
+			PutBigEndian(header, static_cast<uint32_t>(width));
+			PutBigEndian(header, static_cast<uint32_t>(height));
+			header.push_back(static_cast<unsigned char>(bitDepth));
+			header.push_back(GetColorType(channels));
+			header.insert(header.end(), 3, 0);  // deflate, adaptive filtering, no interlace
+			WriteChunk("IHDR", header.data(), header.size());
+			return static_cast<bool>(file);
+		}
+
+		// The zlib header rides on the first IDAT, the combined Adler-32 on the last.
+		bool Append(PngStrip& strip, bool last)
+		{
+			if(first) {
+				std::vector<unsigned char> zlibHeader;
+				PutZlibHeader(zlibHeader, level);
+				strip.data.insert(strip.data.begin(), zlibHeader.begin(), zlibHeader.end());
+				first = false;
+			}
+
+			adler = Deflate::CombineAdler32(adler, strip.adler, strip.filteredSize);
+			if(last)
+				PutBigEndian(strip.data, adler);
+
+			WriteChunk("IDAT", strip.data.data(), strip.data.size());
+			return static_cast<bool>(file);
+		}
+
+		bool Close()
+		{
+			WriteChunk("IEND", nullptr, 0);
+			file.close();
+			return !file.fail();
+		}
+
+	private:
+		void WriteChunk(const char type[4], const unsigned char* data, size_t size)
+		{
+			std::vector<unsigned char> length;
+			PutBigEndian(length, static_cast<uint32_t>(size));
+			file.write(reinterpret_cast<const char*>(length.data()), 4);
+			file.write(type, 4);
+			if(size > 0)
+				file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+
+			std::vector<unsigned char> crc;
+			const uint32_t typeCrc = Deflate::Crc32(reinterpret_cast<const unsigned char*>(type), 4);
+			PutBigEndian(crc, size > 0 ? Deflate::Crc32(data, size, typeCrc) : typeCrc);
+			file.write(reinterpret_cast<const char*>(crc.data()), 4);
+		}
+
+		std::ofstream file;
+		int level = Deflate::DefaultLevel;
+		uint32_t adler = 1;
+		bool first = true;
+	};
+
+	/** PNG stores 16-bit samples most significant byte first. */
+	void ToBigEndian16(unsigned char* samples, size_t count)
+	{
+		for(size_t i = 0; i < count; ++i) {
+			uint16_t value;
+			std::memcpy(&value, samples + 2 * i, 2);
+			samples[2 * i] = static_cast<unsigned char>(value >> 8);
+			samples[2 * i + 1] = static_cast<unsigned char>(value);
+		}
+	}
+
+	unsigned char Paeth(int a, int b, int c)
+	{
+		const int p = a + b - c;
+		const int pa = std::abs(p - a);
+		const int pb = std::abs(p - b);
+		const int pc = std::abs(p - c);
+		if(pa <= pb && pa <= pc) return static_cast<unsigned char>(a);
+		if(pb <= pc) return static_cast<unsigned char>(b);
+		return static_cast<unsigned char>(c);
+	}
+
+	/** Writes filter type + filtered bytes of one row, keeping the cheapest of the five filters. */
+	void FilterRow(const unsigned char* row, const unsigned char* above, size_t stride, int bpp,
+		unsigned char* scratch, unsigned char* out)
+	{
+		int bestFilter = 0;
+		long bestCost = -1;
+
+		for(int filter = 0; filter < 5; ++filter)
+		{
+			unsigned char* line = filter == 0 ? out + 1 : scratch;
+			long cost = 0;
+			for(size_t i = 0; i < stride; ++i)
+			{
+				const int a = i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0;
+				const int b = above ? above[i] : 0;
+				const int c = above && i >= static_cast<size_t>(bpp) ? above[i - bpp] : 0;
+
+				unsigned char predicted = 0;
+				switch(filter)
+				{
+				case 1: predicted = static_cast<unsigned char>(a); break;
+				case 2: predicted = static_cast<unsigned char>(b); break;
+				case 3: predicted = static_cast<unsigned char>((a + b) >> 1); break;
+				case 4: predicted = Paeth(a, b, c); break;
+				default: break;
+				}
+				line[i] = static_cast<unsigned char>(row[i] - predicted);
+				cost += std::abs(static_cast<int>(static_cast<signed char>(line[i])));
+			}
+
+			if(bestCost < 0 || cost < bestCost) {
+				bestCost = cost;
+				bestFilter = filter;
+				if(filter != 0)
+					std::copy(scratch, scratch + stride, out + 1);
+			}
+		}
+		out[0] = static_cast<unsigned char>(bestFilter);
+	}
+}
+
+PngWriter::PngWriter(ThreadPool& pool) : pool(pool)
+{
+}
+
+[[nodiscard]] bool PngWriter::Write(const std::string& path, int width, int height, int channels, const unsigned char* pixels,
+	const PngWriteOptions& options) const
+{
+	if(!pixels)
+		return false;
+
+	const size_t stride = static_cast<size_t>(width) * channels;
+	return WriteStreams({ PngStreamOutput{ path, channels } }, width, height,
+		[&] (int firstRow, int rowCount, unsigned char* const* rows) {
+			std::memcpy(rows[0], pixels + firstRow * stride, rowCount * stride);
+		}, options);
+}
+
+[[nodiscard]] bool PngWriter::WriteStreams(const std::vector<PngStreamOutput>& outputs, int width, int height, const RowFiller& fill,
+	const PngWriteOptions& options, PngStreamStats* stats, const ProgressFn& progress) const
+{
+	if(width <= 0 || height <= 0 || outputs.empty())
+		return false;
+
+	int maxPixelBytes = 0;
+	for(const PngStreamOutput& output : outputs) {
+		if(output.channels < 1 || output.channels > 4 || (output.bitDepth != 8 && output.bitDepth != 16))
+			return false;
+		maxPixelBytes = std::max(maxPixelBytes, output.channels * output.bitDepth / 8);
+	}
+
+	const int level = std::clamp(options.compressionLevel, 0, 9);
+	const int stripRows = GetStripRows(width, maxPixelBytes, options);
+	const size_t stripCount = (static_cast<size_t>(height) + stripRows - 1) / stripRows;
+	const size_t inFlight = GetStripsInFlight(options);
+
+	PngStreamStats localStats;
+	PngStreamStats& result = stats ? *stats : localStats;
+	result = PngStreamStats();
+	result.stripCount = stripCount;
+
+	std::vector<PngFileStream> streams(outputs.size());
+	for(size_t i = 0; i < outputs.size(); ++i) {
+		if(!streams[i].Open(outputs[i].path, width, height, outputs[i].channels, outputs[i].bitDepth, level)) {
+			result.failedOutput = static_cast<int>(i);
+			return false;
+		}
+	}
+
+	BufferMeter meter;
+	std::atomic<int> unallocatedOutput = -1;
+
+	// Strips are produced in waves of inFlight and appended in order, so at most
+	// one wave of strip buffers is ever alive.
+	for(size_t wave = 0; wave < stripCount; wave += inFlight)
+	{
+		const size_t waveSize = std::min(inFlight, stripCount - wave);
+		std::vector<std::vector<PngStrip>> strips(waveSize, std::vector<PngStrip>(outputs.size()));
+
+		pool.ParallelFor(waveSize, [&] (size_t index) {
+			const size_t strip = wave + index;
+			const int firstRow = static_cast<int>(strip) * stripRows;
+			const int rowCount = std::min(stripRows, height - firstRow);
+			const int extraRow = firstRow > 0 ? 1 : 0;  // raw row above, needed by the Up/Average/Paeth filters
+
+			std::vector<PooledBuffer> raw(outputs.size());
+			std::vector<unsigned char*> rows(outputs.size());
+			size_t rawBytes = 0;
+			for(size_t i = 0; i < outputs.size(); ++i) {
+				raw[i] = PooledBuffer(static_cast<size_t>(rowCount + extraRow) * width * outputs[i].channels * (outputs[i].bitDepth / 8));
+				rows[i] = raw[i].GetData();
+				rawBytes += raw[i].GetSize();
+				if(!rows[i])
+					unallocatedOutput = static_cast<int>(i);
+			}
+			meter.Add(rawBytes);
+			if(unallocatedOutput >= 0) {
+				meter.Remove(rawBytes);
+				return;
+			}
+
+			fill(firstRow - extraRow, rowCount + extraRow, rows.data());
+
+			for(size_t i = 0; i < outputs.size(); ++i) {
+				const int pixelBytes = outputs[i].channels * outputs[i].bitDepth / 8;
+				if(outputs[i].bitDepth == 16)
+					ToBigEndian16(rows[i], raw[i].GetSize() / 2);
+
+				const size_t stride = static_cast<size_t>(width) * pixelBytes;
+				const size_t filteredBytes = (stride + 1) * rowCount;
+				meter.Add(filteredBytes);
+				if(!CompressStrip(extraRow ? rows[i] : nullptr, rows[i] + extraRow * stride, rowCount, width, pixelBytes,
+					level, strip + 1 == stripCount, strips[index][i]))
+					unallocatedOutput = static_cast<int>(i);
+				meter.Add(strips[index][i].data.capacity());
+				meter.Remove(filteredBytes);
+			}
+			meter.Remove(rawBytes);
+		});
+
+		// Out of memory for a strip: the output is failed like one that cannot be appended.
+		if(unallocatedOutput >= 0) {
+			result.failedOutput = unallocatedOutput;
+			return false;
+		}
+
+		for(size_t index = 0; index < waveSize; ++index) {
+			for(size_t i = 0; i < outputs.size(); ++i) {
+				PngStrip& strip = strips[index][i];
+				const size_t bytes = strip.data.capacity();
+				if(!streams[i].Append(strip, wave + index + 1 == stripCount)) {
+					result.failedOutput = static_cast<int>(i);
+					return false;
+				}
+				std::vector<unsigned char>().swap(strip.data);
+				meter.Remove(bytes);
+			}
+		}
+
+		if(progress)
+			progress(static_cast<float>(wave + waveSize) / stripCount);
+	}
+
+	for(size_t i = 0; i < outputs.size(); ++i) {
+		if(!streams[i].Close()) {
+			result.failedOutput = static_cast<int>(i);
+			return false;
+		}
+	}
+
+	result.peakBufferBytes = meter.GetPeak();
+	return true;
+}
+
+bool PngWriter::CompressStrip(const unsigned char* previousRow, const unsigned char* rows, int rowCount,
+	int width, int pixelBytes, int level, bool final, PngStrip& strip)
+{
+	const size_t stride = static_cast<size_t>(width) * pixelBytes;
+
+	PooledBuffer filtered((stride + 1) * rowCount);
+	if(!filtered.GetData())
+		return false;
+	std::vector<unsigned char> scratch(stride);
+	for(int y = 0; y < rowCount; ++y) {
+		const unsigned char* row = rows + y * stride;
+		const unsigned char* above = y > 0 ? row - stride : previousRow;
+		FilterRow(row, above, stride, pixelBytes, scratch.data(), filtered.GetData() + y * (stride + 1));
+	}
+
+	strip.filteredSize = filtered.GetSize();
+	strip.adler = Deflate::Adler32(filtered.GetData(), filtered.GetSize());
+	strip.data.clear();
+
+	// The deflated strip grows as a vector; running out of memory there fails the strip like the filtered rows do.
+	try {
+		strip.data.reserve(filtered.GetSize() / 2);
+		Deflate::CompressSegment(filtered.GetData(), filtered.GetSize(), level, final, strip.data);
+	}
+	catch(const std::bad_alloc&) {
+		std::vector<unsigned char>().swap(strip.data);
+		return false;
+	}
+	return true;
+}
+
+size_t PngWriter::GetStripsInFlight(const PngWriteOptions& options) const
+{
+	if(options.maxStripsInFlight > 0)
+		return static_cast<size_t>(options.maxStripsInFlight);
+	return std::max<size_t>(1, pool.GetThreadCount() * 2);
+}
+
+int PngWriter::GetStripRows(int width, int pixelBytes, const PngWriteOptions& options)
+{
+	if(options.stripRows > 0)
+		return options.stripRows;
+
+	const size_t stride = static_cast<size_t>(width) * pixelBytes + 1;
+	return static_cast<int>(std::max<size_t>(1, ORM::PngStripBytes / stride));
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Deflate.h"
+
+class ThreadPool;
+
+struct PngWriteOptions
+{
+	/** zlib-style level: 0 stores, 1 is fastest, 9 compresses hardest. */
+	int compressionLevel = Deflate::DefaultLevel;
+
+	/** Rows per independently compressed strip; 0 sizes strips to ORM::PngStripBytes. */
+	int stripRows = 0;
+
+	/** Strips produced and held at once; 0 means two per pool thread. */
+	int maxStripsInFlight = 0;
+};
+
+/** One PNG file fed by a streaming write. */
+struct PngStreamOutput
+{
+	std::string path;
+	int channels = 4;
+
+	/** 8 or 16; 16-bit rows are filled with native-endian uint16_t samples. */
+	int bitDepth = 8;
+};
+
+struct PngStreamStats
+{
+	size_t stripCount = 0;
+
+	/** High-water mark of strip buffers (raw rows, filtered rows, compressed data) alive at once. */
+	size_t peakBufferBytes = 0;
+
+	/** Index into the outputs of the file that could not be written (or whose strip buffers could not be allocated), or -1. */
+	int failedOutput = -1;
+};
+
+/** One filtered and deflated run of rows, ready to be stored as an IDAT chunk. */
+struct PngStrip
+{
+	std::vector<unsigned char> data;
+	uint32_t adler = 1;
+	size_t filteredSize = 0;
+};
+
+/**
+ * Class: PngWriter
+ *
+ * 8- and 16-bit PNG encoder that splits the image into horizontal strips and filters and
+ * deflates them concurrently on a ThreadPool. Each strip becomes one IDAT chunk;
+ * strips are joined with sync flushes and their Adler-32 values are combined,
+ * so the result is a single standard zlib stream any decoder accepts.
+ *
+ * Notes:
+ * - WriteStreams() never needs the whole image: rows are requested from a
+ *   RowFiller one strip at a time, at most maxStripsInFlight strips are alive,
+ *   and finished strips are appended to the files in order. Peak memory
+ *   depends on strip size and thread count, not on image size.
+ * - Several outputs of the same size can share one stream, so a filler that
+ *   produces all of them from the same source rows reads the source once.
+ * - Row filters are chosen per row with the minimum-sum-of-absolute-differences
+ *   heuristic. The output is deterministic for a given level and strip height,
+ *   whatever the thread count.
+ */
+class PngWriter
+{
+public:
+	using ProgressFn = std::function<void(float)>;
+
+	/** Fills rowCount rows starting at firstRow; rows[i] holds rowCount * width * outputs[i].channels samples. */
+	using RowFiller = std::function<void(int firstRow, int rowCount, unsigned char* const* rows)>;
+
+	explicit PngWriter(ThreadPool& pool);
+
+	[[nodiscard]] bool Write(const std::string& path, int width, int height, int channels, const unsigned char* pixels,
+		const PngWriteOptions& options = PngWriteOptions()) const;
+
+	[[nodiscard]] bool WriteStreams(const std::vector<PngStreamOutput>& outputs, int width, int height, const RowFiller& fill,
+		const PngWriteOptions& options = PngWriteOptions(), PngStreamStats* stats = nullptr, const ProgressFn& progress = nullptr) const;
+
+	/**
+	 * Filters and compresses rowCount rows. previousRow is the raw row above the
+	 * strip, or null for the first strip; final marks the last strip of the image.
+	 * Rows are in file byte order; pixelBytes is channels * bitDepth / 8.
+	 * Returns false when the filtered rows could not be allocated.
+	 */
+	[[nodiscard]] static bool CompressStrip(const unsigned char* previousRow, const unsigned char* rows, int rowCount,
+		int width, int pixelBytes, int level, bool final, PngStrip& strip);
+
+	static int GetStripRows(int width, int pixelBytes, const PngWriteOptions& options);
+
+	size_t GetStripsInFlight(const PngWriteOptions& options) const;
+
+private:
+	ThreadPool& pool;
+};
@@ -0,0 +1,173 @@
+#include "RawImage.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "Constants.h"
+#include "MappedFile.h"
+
+namespace
+{
+	constexpr unsigned char Magic[4] = { 'O', 'R', 'M', 'R' };
+	constexpr uint32_t Version = 1;
+
+	uint32_t Get32(const unsigned char* p)
+	{
+		return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+	}
+
+	uint16_t Get16(const unsigned char* p)
+	{
+		return static_cast<uint16_t>(p[0] | p[1] << 8);
+	}
+
+	void Put32(unsigned char* p, uint32_t value)
+	{
+		for(int i = 0; i < 4; ++i)
+			p[i] = static_cast<unsigned char>(value >> (8 * i));
+	}
+
+	void Put16(unsigned char* p, uint16_t value)
+	{
+		p[0] = static_cast<unsigned char>(value);
+		p[1] = static_cast<unsigned char>(value >> 8);
+	}
+
+	std::array<unsigned char, RawImage::HeaderBytes> MakeHeader(const RawImageInfo& info)
+	{
+		std::array<unsigned char, RawImage::HeaderBytes> header{};
+		std::memcpy(header.data(), Magic, sizeof(Magic));
+		Put32(header.data() + 4, Version);
+		Put32(header.data() + 8, static_cast<uint32_t>(info.width));
+		Put32(header.data() + 12, static_cast<uint32_t>(info.height));
+		Put16(header.data() + 16, static_cast<uint16_t>(info.channels));
+		Put16(header.data() + 18, static_cast<uint16_t>(info.bitDepth));
+		Put32(header.data() + 20, static_cast<uint32_t>(info.layout));
+		return header;
+	}
+}
+
+bool RawImage::IsRawPath(const std::string& path)
+{
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [] (unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return extension == Extension;
+}
+
+bool RawImage::ReadHeader(const unsigned char* data, size_t size, RawImageInfo& info, const char*& error)
+{
+	if(size < HeaderBytes || std::memcmp(data, Magic, sizeof(Magic)) != 0) {
+		error = "not an ORMTool raw image";
+		return false;
+	}
+	if(Get32(data + 4) != Version) {
+		error = "unsupported raw image version";
+		return false;
+	}
+
+	const uint32_t width = Get32(data + 8);
+	const uint32_t height = Get32(data + 12);
+	const uint16_t channels = Get16(data + 16);
+	const uint16_t bitDepth = Get16(data + 18);
+	const uint32_t layout = Get32(data + 20);
+	if(width == 0 || height == 0 || width > (1u << 24) || height > (1u << 24) || channels < 1 || channels > 4
+		|| (bitDepth != 8 && bitDepth != 16 && bitDepth != 32) || layout > static_cast<uint32_t>(RawLayout::Interleaved)) {
+		error = "invalid raw image header";
+		return false;
+	}
+
+	const uint64_t expected = static_cast<uint64_t>(width) * height * channels * (bitDepth / 8);
+	if(size - HeaderBytes != expected) {
+		error = "raw image size does not match its header";
+		return false;
+	}
+
+	info.width = static_cast<int>(width);
+	info.height = static_cast<int>(height);
+	info.channels = channels;
+	info.bitDepth = bitDepth;
+	info.layout = static_cast<RawLayout>(layout);
+	return true;
+}
+
+std::shared_ptr<unsigned char> RawImage::MapPlane(const std::string& path, RawImageInfo& info, const char*& error)
+{
+	auto file = std::make_shared<MappedFile>();
+	if(!file->Open(path)) {
+		error = "can't open file";
+		return nullptr;
+	}
+	if(!ReadHeader(file->GetData(), file->GetSize(), info, error))
+		return nullptr;
+	if(info.channels != 1) {
+		error = "raw sources must have a single channel";
+		return nullptr;
+	}
+
+	// Aliasing constructor: the plane owns the mapping, not the pointer it hands out.
+	unsigned char* samples = const_cast<unsigned char*>(file->GetData()) + HeaderBytes;
+	return std::shared_ptr<unsigned char>(std::move(file), samples);
+}
+
+[[nodiscard]] bool RawImage::WriteInterleaved(const std::vector<RawImageOutput>& outputs, int width, int height, int bitDepth,
+	const RowFiller& fill, int* failedOutput)
+{
+	auto fail = [&] (size_t index) {
+		if(failedOutput) *failedOutput = static_cast<int>(index);
+		return false;
+	};
+	if(failedOutput) *failedOutput = -1;
+	if(outputs.empty() || width <= 0 || height <= 0 || (bitDepth != 8 && bitDepth != 16))
+		return fail(0);
+
+	const size_t sampleBytes = static_cast<size_t>(bitDepth / 8);
+	size_t pixelBytes = 0;
+	for(const RawImageOutput& output : outputs)
+		pixelBytes += output.channels * sampleBytes;
+
+	// Bands sized like a packing tile, so the filled rows are still in cache when they are written.
+	const int bandRows = static_cast<int>(std::clamp<size_t>(ORM::PackTileBytes / (static_cast<size_t>(width) * pixelBytes), 1, height));
+
+	std::vector<std::ofstream> files(outputs.size());
+	std::vector<std::vector<unsigned char>> bands(outputs.size());
+	std::vector<unsigned char*> rows(outputs.size());
+	for(size_t i = 0; i < outputs.size(); ++i) {
+		RawImageInfo info;
+		info.width = width;
+		info.height = height;
+		info.channels = outputs[i].channels;
+		info.bitDepth = bitDepth;
+		info.layout = RawLayout::Interleaved;
+
+		files[i].open(outputs[i].path, std::ios::binary | std::ios::trunc);
+		const std::array<unsigned char, HeaderBytes> header = MakeHeader(info);
+		files[i].write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+		if(!files[i])
+			return fail(i);
+
+		bands[i].resize(static_cast<size_t>(bandRows) * width * outputs[i].channels * sampleBytes);
+		rows[i] = bands[i].data();
+	}
+
+	for(int firstRow = 0; firstRow < height; firstRow += bandRows) {
+		const int rowCount = std::min(bandRows, height - firstRow);
+		fill(firstRow, rowCount, rows.data());
+		for(size_t i = 0; i < outputs.size(); ++i) {
+			const size_t bytes = static_cast<size_t>(rowCount) * width * outputs[i].channels * sampleBytes;
+			if(!files[i].write(reinterpret_cast<const char*>(rows[i]), static_cast<std::streamsize>(bytes)))
+				return fail(i);
+		}
+	}
+
+	for(size_t i = 0; i < outputs.size(); ++i) {
+		files[i].close();
+		if(!files[i])
+			return fail(i);
+	}
+	return true;
+}
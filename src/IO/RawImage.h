@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class RawLayout
+{
+	Planar = 0,
+	Interleaved = 1
+};
+
+struct RawImageInfo
+{
+	int width = 0;
+	int height = 0;
+	int channels = 1;
+	int bitDepth = 8;
+	RawLayout layout = RawLayout::Planar;
+};
+
+struct RawImageOutput
+{
+	std::string path;
+	int channels = 4;
+};
+
+/**
+ * Class: RawImage
+ *
+ * ORMTool's codec-free exchange format (.ormraw) for engine-side pipelines:
+ * a 32-byte header followed by the samples exactly as they sit in memory.
+ * Sources are mapped and handed to the packer without a copy; packed outputs
+ * are streamed to disk row band by row band, so chained tools pay neither
+ * decode nor deflate.
+ *
+ * Header (little-endian):
+ *   0  "ORMR"       4  version (1)      8  width       12 height
+ *   16 channels (u16)  18 bitDepth (u16: 8, 16 or 32 = float)
+ *   20 layout (0 planar, 1 interleaved) 24 reserved (8 bytes, zero)
+ *
+ * Notes:
+ * - Samples are stored in host byte order, which is little-endian on every
+ *   platform ORMTool builds for; that is what lets the mapping be used as is.
+ * - Planar files hold channel 0's rows, then channel 1's, and so on.
+ * - Sources must have one channel; the header keeps the data 32-byte aligned
+ *   inside the page-aligned mapping.
+ */
+class RawImage
+{
+public:
+	static constexpr const char* Extension = ".ormraw";
+	static constexpr size_t HeaderBytes = 32;
+
+	/** Fills rowCount rows starting at firstRow; rows[i] holds rowCount * width * outputs[i].channels samples. */
+	using RowFiller = std::function<void(int firstRow, int rowCount, unsigned char* const* rows)>;
+
+	/** True when the path has the .ormraw extension (case-insensitive). */
+	static bool IsRawPath(const std::string& path);
+
+	/** Parses and checks the header against the data size; false with error set to a static message. */
+	static bool ReadHeader(const unsigned char* data, size_t size, RawImageInfo& info, const char*& error);
+
+	/**
+	 * Maps a single-channel file and returns its samples in place. The pointer aliases the
+	 * mapping, which stays open until the last copy is released; the pages are read-only.
+	 */
+	static std::shared_ptr<unsigned char> MapPlane(const std::string& path, RawImageInfo& info, const char*& error);
+
+	/** Writes interleaved 8- or 16-bit files of the same size from one fill; failedOutput names the file that failed. */
+	[[nodiscard]] static bool WriteInterleaved(const std::vector<RawImageOutput>& outputs, int width, int height, int bitDepth,
+		const RowFiller& fill, int* failedOutput = nullptr);
+};
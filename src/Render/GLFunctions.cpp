@@ -0,0 +1,41 @@
+#include "GLFunctions.h"
+
+namespace
+{
+	template<typename Fn>
+	void Resolve(Fn& function, const char* name)
+	{
+		function = reinterpret_cast<Fn>(glfwGetProcAddress(name));
+	}
+}
+
+bool GLFunctions::Load()
+{
+	Resolve(genBuffers, "glGenBuffers");
+	Resolve(deleteBuffers, "glDeleteBuffers");
+	Resolve(bindBuffer, "glBindBuffer");
+	Resolve(bufferData, "glBufferData");
+	Resolve(mapBufferRange, "glMapBufferRange");
+	Resolve(unmapBuffer, "glUnmapBuffer");
+	Resolve(fenceSync, "glFenceSync");
+	Resolve(clientWaitSync, "glClientWaitSync");
+	Resolve(deleteSync, "glDeleteSync");
+
+	// Drivers may hand out pointers for functions they do not support; trust the extension string.
+	bufferStorage = nullptr;
+	if(glfwExtensionSupported("GL_ARB_buffer_storage"))
+		Resolve(bufferStorage, "glBufferStorage");
+
+	return SupportsPixelBuffers();
+}
+
+bool GLFunctions::SupportsPixelBuffers() const
+{
+	return genBuffers && deleteBuffers && bindBuffer && bufferData && mapBufferRange && unmapBuffer
+		&& fenceSync && clientWaitSync && deleteSync;
+}
+
+bool GLFunctions::SupportsPersistentMapping() const
+{
+	return SupportsPixelBuffers() && bufferStorage;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include <GLFW/glfw3.h>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+// The platform gl.h may stop at OpenGL 1.1; the enums below are core since 1.2 - 4.4.
+#ifndef GL_R8
+#define GL_R8 0x8229
+#endif
+#ifndef GL_RGB8
+#define GL_RGB8 0x8051
+#endif
+#ifndef GL_RGBA8
+#define GL_RGBA8 0x8058
+#endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+#ifndef GL_TEXTURE_SWIZZLE_RGBA
+#define GL_TEXTURE_SWIZZLE_RGBA 0x8E46
+#endif
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT 0x0001
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_BUFFER_BIT
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#endif
+#ifndef GL_MAP_UNSYNCHRONIZED_BIT
+#define GL_MAP_UNSYNCHRONIZED_BIT 0x0020
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_ALREADY_SIGNALED
+#define GL_ALREADY_SIGNALED 0x911A
+#endif
+#ifndef GL_CONDITION_SATISFIED
+#define GL_CONDITION_SATISFIED 0x911C
+#endif
+
+/**
+ * Struct: GLFunctions
+ *
+ * The OpenGL entry points above 1.1 that ORMTool calls itself (ImGui's backend
+ * loads its own). They are resolved through glfwGetProcAddress, so Load() must
+ * run on the thread that owns the current context.
+ *
+ * Notes:
+ * - bufferStorage is only resolved when GL_ARB_buffer_storage (core in 4.4) is
+ *   reported; the context ORMTool asks for is 4.3, so it may be missing.
+ */
+struct GLFunctions
+{
+	using SyncHandle = struct __GLsync*;
+
+	void (APIENTRY* genBuffers)(GLsizei, GLuint*) = nullptr;
+	void (APIENTRY* deleteBuffers)(GLsizei, const GLuint*) = nullptr;
+	void (APIENTRY* bindBuffer)(GLenum, GLuint) = nullptr;
+	void (APIENTRY* bufferData)(GLenum, std::ptrdiff_t, const void*, GLenum) = nullptr;
+	void (APIENTRY* bufferStorage)(GLenum, std::ptrdiff_t, const void*, GLbitfield) = nullptr;
+	void* (APIENTRY* mapBufferRange)(GLenum, std::ptrdiff_t, std::ptrdiff_t, GLbitfield) = nullptr;
+	GLboolean (APIENTRY* unmapBuffer)(GLenum) = nullptr;
+	SyncHandle (APIENTRY* fenceSync)(GLenum, GLbitfield) = nullptr;
+	GLenum (APIENTRY* clientWaitSync)(SyncHandle, GLbitfield, uint64_t) = nullptr;
+	void (APIENTRY* deleteSync)(SyncHandle) = nullptr;
+
+	bool Load();
+
+	bool SupportsPixelBuffers() const;
+	bool SupportsPersistentMapping() const;
+};
@@ -0,0 +1,176 @@
+#include "GpuUploadQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "Constants.h"
+
+namespace
+{
+	void GetFormats(int channels, GLint& internalFormat, GLenum& format)
+	{
+		internalFormat = GL_RGBA8;
+		format = GL_RGBA;
+		if(channels == 1) { internalFormat = GL_R8; format = GL_RED; }
+		else if(channels == 3) { internalFormat = GL_RGB8; format = GL_RGB; }
+	}
+
+	/** Creates the texture with storage for every level of image, filled only when withPixels is set. */
+	unsigned int AllocateTexture(const GpuUploadImage& image, bool withPixels)
+	{
+		GLint internalFormat;
+		GLenum format;
+		GetFormats(image.channels, internalFormat, format);
+
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for(int level = 0; level < image.GetLevelCount(); ++level) {
+			glTexImage2D(GL_TEXTURE_2D, level, internalFormat, image.GetLevelWidth(level), image.GetLevelHeight(level), 0,
+				format, GL_UNSIGNED_BYTE, withPixels ? image.GetLevelPixels(level) : nullptr);
+		}
+		if(image.channels == 1) {
+			const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.GetLevelCount() - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.mips.empty() ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		return texture;
+	}
+}
+
+void GpuUploadQueue::Post(GpuUploadImage image, CompletionFn onUploaded)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pending.push_back(Request{ std::move(image), std::move(onUploaded) });
+}
+
+size_t GpuUploadQueue::Drain(double budgetMs)
+{
+	using Clock = std::chrono::steady_clock;
+	const auto start = Clock::now();
+
+	if(!initialized) {
+		initialized = true;
+		if(gl.Load())
+			ring.Initialize(gl, ORM::UploadSlotBytes, ORM::UploadSlotCount);
+	}
+
+	size_t uploaded = 0;
+	for(;;)
+	{
+		if(!streaming) {
+			Request request;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if(pending.empty())
+					break;
+				request = std::move(pending.front());
+				pending.pop_front();
+			}
+
+			if(!BeginStream(request)) {
+				const unsigned int texture = CreateTexture(request.image);
+				if(request.onUploaded)
+					request.onUploaded(texture, request.image);
+				++uploaded;
+			}
+		}
+
+		if(streaming) {
+			if(!StreamChunk())
+				break;  // every slot is still being read by the GPU
+
+			if(active.level == active.request.image.GetLevelCount()) {
+				streaming = false;
+				ActiveUpload finished = std::move(active);
+				active = ActiveUpload();
+				if(finished.request.onUploaded)
+					finished.request.onUploaded(finished.texture, finished.request.image);
+				++uploaded;
+			}
+		}
+
+		if(std::chrono::duration<double, std::milli>(Clock::now() - start).count() >= budgetMs)
+			break;
+	}
+	return uploaded;
+}
+
+void GpuUploadQueue::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pending.clear();
+}
+
+void GpuUploadQueue::Shutdown()
+{
+	Clear();
+	if(streaming) {
+		glDeleteTextures(1, &active.texture);
+		active = ActiveUpload();
+		streaming = false;
+	}
+	ring.Shutdown();
+	initialized = false;
+}
+
+size_t GpuUploadQueue::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending.size();
+}
+
+unsigned int GpuUploadQueue::CreateTexture(const GpuUploadImage& image)
+{
+	return AllocateTexture(image, true);
+}
+
+bool GpuUploadQueue::BeginStream(Request& request)
+{
+	const GpuUploadImage& image = request.image;
+	const size_t rowBytes = static_cast<size_t>(image.width) * image.channels;
+	if(!ring.IsReady() || !image.pixels || image.height <= 0 || rowBytes == 0 || rowBytes > ring.GetSlotBytes())
+		return false;
+
+	active.texture = AllocateTexture(image, false);
+	active.level = 0;
+	active.nextRow = 0;
+	active.request = std::move(request);
+	streaming = true;
+	return true;
+}
+
+bool GpuUploadQueue::StreamChunk()
+{
+	PixelBufferRing::Slot slot;
+	if(!ring.Acquire(slot))
+		return false;
+
+	const GpuUploadImage& image = active.request.image;
+	const int width = image.GetLevelWidth(active.level);
+	const int height = image.GetLevelHeight(active.level);
+	const size_t rowBytes = static_cast<size_t>(width) * image.channels;
+	const int rows = std::min(height - active.nextRow, static_cast<int>(ring.GetSlotBytes() / rowBytes));
+	std::memcpy(slot.data, image.GetLevelPixels(active.level) + rowBytes * active.nextRow, rowBytes * rows);
+	ring.Commit(slot);
+
+	GLint internalFormat;
+	GLenum format;
+	GetFormats(image.channels, internalFormat, format);
+	glBindTexture(GL_TEXTURE_2D, active.texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, active.level, 0, active.nextRow, width, rows, format, GL_UNSIGNED_BYTE,
+		reinterpret_cast<const void*>(slot.offset));
+	ring.Fence(slot);
+
+	active.nextRow += rows;
+	if(active.nextRow == height) {
+		++active.level;
+		active.nextRow = 0;
+	}
+	return true;
+}
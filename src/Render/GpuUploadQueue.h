@@ -0,0 +1,101 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "GLFunctions.h"
+#include "PixelBufferRing.h"
+
+/** CPU pixels waiting for upload. The queue keeps them alive until the completion has run. */
+struct GpuUploadImage
+{
+	std::shared_ptr<const unsigned char> pixels;
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+
+	// Optional mip levels 1..n, each floor(size / 2) of the previous one. With mips the
+	// texture samples trilinearly; the chain may stop before 1x1.
+	std::vector<std::shared_ptr<const unsigned char>> mips;
+
+	int GetLevelCount() const { return 1 + static_cast<int>(mips.size()); }
+	int GetLevelWidth(int level) const { return std::max(1, width >> level); }
+	int GetLevelHeight(int level) const { return std::max(1, height >> level); }
+	const unsigned char* GetLevelPixels(int level) const { return level == 0 ? pixels.get() : mips[level - 1].get(); }
+};
+
+/**
+ * Class: GpuUploadQueue
+ *
+ * Hands pixel buffers from worker threads to the render thread, the only thread
+ * with a current GL context. Workers Post() decoded or packed images from
+ * anywhere; Application::RunApplication drains the queue once per frame and
+ * stops as soon as the frame's upload budget is spent, so a burst of large
+ * images is spread over several frames instead of freezing the UI.
+ *
+ * Notes:
+ * - Images are streamed through a PixelBufferRing in chunks of whole rows,
+ *   one mip level after another: a chunk is copied into a free pixel buffer
+ *   and sourced by glTexSubImage2D, so the driver transfers it asynchronously
+ *   while the CPU fills the next slot. A large texture may therefore take
+ *   several frames to complete.
+ * - When pixel buffers are unavailable, or a single row does not fit a slot,
+ *   the image is uploaded directly with glTexImage2D instead.
+ * - Completions run on the render thread once the last chunk has been issued,
+ *   in posting order; they own the texture from then on.
+ * - Every Drain() makes progress unless all ring slots are still in use by
+ *   the GPU, in which case the next frame picks up where this one stopped.
+ */
+class GpuUploadQueue
+{
+public:
+	using CompletionFn = std::function<void(unsigned int texture, const GpuUploadImage& image)>;
+
+	void Post(GpuUploadImage image, CompletionFn onUploaded);
+
+	/** Render thread only. Returns the number of textures completed. */
+	size_t Drain(double budgetMs);
+
+	/** Drops pending uploads without creating their textures. */
+	void Clear();
+
+	/** Render thread only, before the context is destroyed. Also drops pending uploads. */
+	void Shutdown();
+
+	size_t GetPendingCount() const;
+
+	/** Render thread only. Creates a linear-filtered texture with all given levels; single-channel images display as gray. */
+	static unsigned int CreateTexture(const GpuUploadImage& image);
+
+private:
+	struct Request
+	{
+		GpuUploadImage image;
+		CompletionFn onUploaded;
+	};
+
+	struct ActiveUpload
+	{
+		Request request;
+		unsigned int texture = 0;
+		int level = 0;
+		int nextRow = 0;
+	};
+
+	bool BeginStream(Request& request);
+	bool StreamChunk();
+
+	mutable std::mutex mutex;
+	std::deque<Request> pending;
+
+	// Render thread state.
+	GLFunctions gl;
+	PixelBufferRing ring;
+	bool initialized = false;
+	bool streaming = false;
+	ActiveUpload active;
+};
@@ -0,0 +1,117 @@
+#include "PixelBufferRing.h"
+
+bool PixelBufferRing::Initialize(const GLFunctions& functions, size_t bytesPerSlot, int slotCount)
+{
+	Shutdown();
+	if(!functions.SupportsPixelBuffers() || bytesPerSlot == 0 || slotCount <= 0)
+		return false;
+
+	gl = &functions;
+	slotBytes = bytesPerSlot;
+	fences.assign(slotCount, nullptr);
+	const std::ptrdiff_t totalBytes = static_cast<std::ptrdiff_t>(slotBytes * slotCount);
+
+	if(gl->SupportsPersistentMapping()) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLuint buffer = 0;
+		gl->genBuffers(1, &buffer);
+		gl->bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		gl->bufferStorage(GL_PIXEL_UNPACK_BUFFER, totalBytes, nullptr, flags);
+		persistentData = static_cast<unsigned char*>(gl->mapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, totalBytes, flags));
+		gl->bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if(persistentData) {
+			buffers.push_back(buffer);
+			return true;
+		}
+		gl->deleteBuffers(1, &buffer);  // storage or mapping refused: fall back to per-slot buffers
+	}
+
+	buffers.resize(slotCount);
+	gl->genBuffers(slotCount, buffers.data());
+	for(GLuint buffer : buffers) {
+		gl->bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		gl->bufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<std::ptrdiff_t>(slotBytes), nullptr, GL_STREAM_DRAW);
+	}
+	gl->bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return true;
+}
+
+void PixelBufferRing::Shutdown()
+{
+	if(!gl)
+		return;
+
+	for(GLFunctions::SyncHandle& fence : fences) {
+		if(fence)
+			gl->deleteSync(fence);
+		fence = nullptr;
+	}
+	if(persistentData) {
+		gl->bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers.front());
+		gl->unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		gl->bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		persistentData = nullptr;
+	}
+	if(!buffers.empty())
+		gl->deleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+
+	buffers.clear();
+	fences.clear();
+	slotBytes = 0;
+	next = 0;
+	gl = nullptr;
+}
+
+bool PixelBufferRing::Acquire(Slot& slot)
+{
+	if(!IsReady() || !IsSlotFree(next))
+		return false;
+
+	slot.index = next;
+	next = (next + 1) % static_cast<int>(fences.size());
+
+	if(persistentData) {
+		slot.offset = slotBytes * slot.index;
+		slot.data = persistentData + slot.offset;
+		gl->bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers.front());
+		return true;
+	}
+
+	slot.offset = 0;
+	gl->bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[slot.index]);
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+	slot.data = static_cast<unsigned char*>(gl->mapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<std::ptrdiff_t>(slotBytes), flags));
+	if(!slot.data) {
+		gl->bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return false;
+	}
+	return true;
+}
+
+void PixelBufferRing::Commit(const Slot& slot)
+{
+	if(!persistentData && slot.data)
+		gl->unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+}
+
+void PixelBufferRing::Fence(const Slot& slot)
+{
+	fences[slot.index] = gl->fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl->bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+bool PixelBufferRing::IsSlotFree(int index)
+{
+	GLFunctions::SyncHandle& fence = fences[index];
+	if(!fence)
+		return true;
+
+	// Zero timeout: poll, never block the frame.
+	const GLenum status = gl->clientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return false;
+
+	gl->deleteSync(fence);
+	fence = nullptr;
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "GLFunctions.h"
+
+/**
+ * Class: PixelBufferRing
+ *
+ * A small ring of pixel unpack buffers used to stream texture data. A slot is
+ * filled by the CPU, consumed by one glTexSubImage2D call sourcing from the
+ * bound buffer, and fenced; it is handed out again only once its fence has
+ * signaled, so the driver never stalls on a buffer the GPU is still reading.
+ *
+ * Notes:
+ * - Render thread only; every method needs the owning context to be current.
+ * - With GL_ARB_buffer_storage all slots live in one persistently and
+ *   coherently mapped buffer. Otherwise each slot is its own buffer, mapped
+ *   unsynchronized per fill (safe because its fence was already waited on).
+ */
+class PixelBufferRing
+{
+public:
+	struct Slot
+	{
+		unsigned char* data = nullptr;
+		size_t offset = 0;  // byte offset to pass as the pixel pointer while the slot is bound
+		int index = -1;
+	};
+
+	PixelBufferRing() = default;
+	PixelBufferRing(const PixelBufferRing&) = delete;
+	PixelBufferRing& operator=(const PixelBufferRing&) = delete;
+	~PixelBufferRing() = default;
+
+	bool Initialize(const GLFunctions& functions, size_t slotBytes, int slotCount);
+	void Shutdown();
+
+	/** Binds and maps the next slot, or returns false while the GPU still reads it. */
+	bool Acquire(Slot& slot);
+
+	/** Ends CPU writes; the slot stays bound for the upload command that sources from it. */
+	void Commit(const Slot& slot);
+
+	/** Call after the upload command has been issued: fences the slot and unbinds it. */
+	void Fence(const Slot& slot);
+
+	bool IsReady() const { return !buffers.empty(); }
+	bool IsPersistent() const { return persistentData != nullptr; }
+	size_t GetSlotBytes() const { return slotBytes; }
+
+private:
+	bool IsSlotFree(int index);
+
+	const GLFunctions* gl = nullptr;
+	std::vector<GLuint> buffers;  // one shared buffer when persistent, one per slot otherwise
+	std::vector<GLFunctions::SyncHandle> fences;
+	unsigned char* persistentData = nullptr;
+	size_t slotBytes = 0;
+	int next = 0;
+};
@@ -0,0 +1,153 @@
+#include "TextureExporter.h"
+
+#include <cstring>
+#include <memory>
+
+#include "PngWriter.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	GLenum GetFormat(int channels)
+	{
+		if(channels == 1) return GL_RED;
+		if(channels == 3) return GL_RGB;
+		return GL_RGBA;
+	}
+
+	std::shared_ptr<const unsigned char> Share(std::vector<unsigned char>&& pixels)
+	{
+		auto image = std::make_shared<std::vector<unsigned char>>(std::move(pixels));
+		return std::shared_ptr<const unsigned char>(image, image->data());
+	}
+}
+
+TextureExporter::TextureExporter(ThreadPool& pool) : pool(pool)
+{
+}
+
+bool TextureExporter::Export(unsigned int texture, int width, int height, int channels, const std::string& path,
+	ImageFormat format, CompletionFn onSaved, int jpgQuality)
+{
+	if(!texture || width <= 0 || height <= 0 || (channels != 1 && channels != 3 && channels != 4))
+		return false;
+
+	if(!initialized) {
+		initialized = true;
+		gl.Load();
+	}
+
+	Readback readback;
+	readback.bytes = static_cast<size_t>(width) * height * channels;
+	readback.width = width;
+	readback.height = height;
+	readback.channels = channels;
+	readback.path = path;
+	readback.format = format;
+	readback.jpgQuality = jpgQuality;
+	readback.onSaved = std::move(onSaved);
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	if(!gl.SupportsPixelBuffers()) {
+		std::vector<unsigned char> pixels(readback.bytes);
+		glGetTexImage(GL_TEXTURE_2D, 0, GetFormat(channels), GL_UNSIGNED_BYTE, pixels.data());
+		Encode(readback, Share(std::move(pixels)));
+		return true;
+	}
+
+	// With a pack buffer bound the pointer is an offset and the call returns before the copy is done.
+	gl.genBuffers(1, &readback.buffer);
+	gl.bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	gl.bufferData(GL_PIXEL_PACK_BUFFER, static_cast<std::ptrdiff_t>(readback.bytes), nullptr, GL_STREAM_READ);
+	glGetTexImage(GL_TEXTURE_2D, 0, GetFormat(channels), GL_UNSIGNED_BYTE, nullptr);
+	readback.fence = gl.fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	readbacks.push_back(std::move(readback));
+	return true;
+}
+
+bool TextureExporter::Save(std::shared_ptr<const unsigned char> pixels, int width, int height, int channels, const std::string& path,
+	ImageFormat format, CompletionFn onSaved, int jpgQuality)
+{
+	if(!pixels || width <= 0 || height <= 0 || (channels != 1 && channels != 3 && channels != 4))
+		return false;
+
+	Readback readback;
+	readback.bytes = static_cast<size_t>(width) * height * channels;
+	readback.width = width;
+	readback.height = height;
+	readback.channels = channels;
+	readback.path = path;
+	readback.format = format;
+	readback.jpgQuality = jpgQuality;
+	readback.onSaved = std::move(onSaved);
+	Encode(readback, std::move(pixels));
+	return true;
+}
+
+size_t TextureExporter::Poll()
+{
+	size_t started = 0;
+	for(size_t i = 0; i < readbacks.size();) {
+		const GLenum status = gl.clientWaitSync(readbacks[i].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			++i;
+			continue;
+		}
+
+		Finish(readbacks[i]);
+		readbacks.erase(readbacks.begin() + i);
+		++started;
+	}
+	return started;
+}
+
+void TextureExporter::Shutdown()
+{
+	for(Readback& readback : readbacks) {
+		// Bounded wait: a lost context must not hang the exit.
+		gl.clientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+		Finish(readback);
+	}
+	readbacks.clear();
+}
+
+void TextureExporter::Finish(Readback& readback)
+{
+	std::vector<unsigned char> pixels(readback.bytes);
+
+	gl.bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	const void* mapped = gl.mapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<std::ptrdiff_t>(readback.bytes), GL_MAP_READ_BIT);
+	if(mapped) {
+		std::memcpy(pixels.data(), mapped, readback.bytes);
+		gl.unmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	gl.deleteSync(readback.fence);
+	gl.deleteBuffers(1, &readback.buffer);
+	readback.fence = nullptr;
+	readback.buffer = 0;
+
+	if(!mapped) {
+		if(readback.onSaved)
+			readback.onSaved(false, readback.path);
+		return;
+	}
+	Encode(readback, Share(std::move(pixels)));
+}
+
+void TextureExporter::Encode(Readback& readback, std::shared_ptr<const unsigned char> image)
+{
+	// Captures the pool, not the exporter: encodes may still run after the exporter is gone.
+	pool.Submit([&workers = pool, image = std::move(image), width = readback.width, height = readback.height, channels = readback.channels,
+		path = readback.path, format = readback.format, quality = readback.jpgQuality, onSaved = std::move(readback.onSaved)] {
+		const bool saved = format == ImageFormat::PNG
+			? PngWriter(workers).Write(path, width, height, channels, image.get())
+			: IOService::SaveImage(path, format, width, height, channels, image.get(), quality);
+		if(onSaved)
+			onSaved(saved, path);
+	});
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GLFunctions.h"
+#include "IOService.h"
+
+class ThreadPool;
+
+/**
+ * Class: TextureExporter
+ *
+ * Saves GL textures to image files without stalling the frame. Export() queues
+ * an asynchronous glGetTexImage into a pixel pack buffer and fences it; Poll()
+ * checks the fences once per frame, copies finished readbacks out of their
+ * buffers and hands them to the ThreadPool, where IOService or the parallel
+ * PngWriter encodes them. Save() takes the same encode path for pixels that are
+ * still on the CPU, such as full-resolution images only a proxy was uploaded of.
+ *
+ * Notes:
+ * - Export(), Poll() and Shutdown() are render thread only; Save() needs no context.
+ * - Completions run on a worker thread once the file is written (or failed).
+ * - Without pixel buffer support the readback is synchronous; encoding still
+ *   happens on the pool.
+ * - Level 0 is read as stored: texture swizzle state is not applied.
+ */
+class TextureExporter
+{
+public:
+	using CompletionFn = std::function<void(bool saved, const std::string& path)>;
+
+	explicit TextureExporter(ThreadPool& pool);
+	TextureExporter(const TextureExporter&) = delete;
+	TextureExporter& operator=(const TextureExporter&) = delete;
+
+	/** Queues the readback of texture level 0 as channels (1, 3 or 4) bytes per pixel. */
+	bool Export(unsigned int texture, int width, int height, int channels, const std::string& path, ImageFormat format,
+		CompletionFn onSaved = nullptr, int jpgQuality = 90);
+
+	/** Encodes pixels (channels bytes per pixel) on the pool; they are kept alive until the file is written. */
+	bool Save(std::shared_ptr<const unsigned char> pixels, int width, int height, int channels, const std::string& path,
+		ImageFormat format, CompletionFn onSaved = nullptr, int jpgQuality = 90);
+
+	/** Starts encoding every readback whose fence has signaled. Returns how many were handed off. */
+	size_t Poll();
+
+	/** Finishes outstanding readbacks (blocking) and releases their buffers; call before the context goes away. */
+	void Shutdown();
+
+	size_t GetPendingCount() const { return readbacks.size(); }
+
+private:
+	struct Readback
+	{
+		GLuint buffer = 0;
+		GLFunctions::SyncHandle fence = nullptr;
+		size_t bytes = 0;
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		std::string path;
+		ImageFormat format = ImageFormat::PNG;
+		int jpgQuality = 90;
+		CompletionFn onSaved;
+	};
+
+	void Finish(Readback& readback);
+	void Encode(Readback& readback, std::shared_ptr<const unsigned char> pixels);
+
+	ThreadPool& pool;
+	GLFunctions gl;
+	bool initialized = false;
+	std::vector<Readback> readbacks;
+};
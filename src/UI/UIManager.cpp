@@ -5,8 +5,7 @@
 #include <imgui_internal.h>
 
 #include <nfd.h>
-#include <stb_image.h>
-#include <stb_image_write.h>
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 #include <GLFW/glfw3.h>
@@ -14,12 +13,11 @@
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
 #include <future>
-
-#define STB_IMAGE_RESIZE_IMPLEMENTATION
-
-
 #include <unordered_map>
 
+#include "BufferPool.h"
+#include "ChannelKernels.h"
+
 namespace ImNeo 
 {
 
@@ -113,8 +111,10 @@ UIManager::~UIManager()
 
 }
 
-void UIManager::Initialize(GLFWwindow* window)
+void UIManager::Initialize(GLFWwindow* window, GpuUploadQueue& uploads)
 {
+	uploadQueue = &uploads;
+
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
 	ImGui::StyleColorsDark();
@@ -126,13 +126,12 @@ void UIManager::Initialize(GLFWwindow* window)
 
 void UIManager::BeginFrame()
 {
- 
+	exporter.Poll();
 }
 
 void UIManager::DrawUI()
 {
 	ShowMainUI();
-	UpdatePreviewIfNeeded();
 }
 
 void UIManager::Render() 
@@ -141,6 +140,7 @@ void UIManager::Render()
 
 void UIManager::Shutdown()
 {
+	exporter.Shutdown();
 	aoPreview.Unload();
 	roughPreview.Unload();
 	metallicPreview.Unload();
@@ -148,151 +148,57 @@ void UIManager::Shutdown()
 
 }
 
-bool PreviewTexture::Load(const std::string& p)
-{
-	Unload();
-	path = p;
-	int channels;
-	data = stbi_load(p.c_str(), &width, &height, &channels, 3);
-	if(!data) {
-		std::cerr << "Failed to load image: " << p << std::endl;
-		return false;
-	}
-
-	glGenTextures(1, &glId);
-	glBindTexture(GL_TEXTURE_2D, glId);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	return true;
-}
-
 void PreviewTexture::Unload()
 {
 	if(glId) glDeleteTextures(1, &glId);
-	if(channelR) glDeleteTextures(1, &channelR);
-	if(channelG) glDeleteTextures(1, &channelG);
-	if(channelB) glDeleteTextures(1, &channelB);
-	if(data) stbi_image_free(data);
-	glId = channelR = channelG = channelB = 0;
-	data = nullptr;
+	glId = 0;
+	shownChannel = ORMChannel::AllRGB;
+	plane = GrayscalePlane();
+	packedRGB.reset();
 }
 
-void PreviewTexture::GenerateChannelsFromRGB(unsigned char* src, int w, int h) 
+void PreviewTexture::ShowChannel(ORMChannel channel)
 {
-	width = w;
-	height = h;
+	if(!glId || channel == shownChannel)
+		return;
 
-	std::vector<unsigned char> red(w * h);
-	std::vector<unsigned char> green(w * h);
-	std::vector<unsigned char> blue(w * h);
-
-	for(int i = 0; i < w * h; ++i) {
-		red[i] = src[i * 3 + 0];
-		green[i] = src[i * 3 + 1];
-		blue[i] = src[i * 3 + 2];
+	GLint swizzle[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ONE };
+	if(channel != ORMChannel::AllRGB) {
+		const GLint source = channel == ORMChannel::AO_R ? GL_RED : channel == ORMChannel::Roughness_G ? GL_GREEN : GL_BLUE;
+		swizzle[0] = swizzle[1] = swizzle[2] = source;
 	}
-
-	auto createTex = [] (GLuint& id, unsigned char* channelData, int w, int h) {
-		glGenTextures(1, &id);
-		glBindTexture(GL_TEXTURE_2D, id);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, w, h, 0, GL_RED, GL_UNSIGNED_BYTE, channelData);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		};
-
-	createTex(channelR, red.data(), w, h);
-	createTex(channelG, green.data(), w, h);
-	createTex(channelB, blue.data(), w, h);
-}
-
-unsigned char* LoadGrayscale(const std::string& path, int& width, int& height) 
-{
-	int channels;
-	unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 1);
-	if(!data) std::cerr << "Failed to load: " << path << "\n";
-	return data;
+	glBindTexture(GL_TEXTURE_2D, glId);
+	glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	shownChannel = channel;
 }
 
 bool UIManager::SaveUnrealAndUnityORM(
+	const ORMSources& sources,
 	const std::string& ao, const std::string& rough, const std::string& metal,
 	const std::string& unrealPath, const std::string& unityPath,
-	bool doUnreal, bool doUnity,
+	bool doUnreal, bool doUnity, int outputSize,
 	const std::function<void(float)>& progressCallback)
 {
-	int w1, h1, w2, h2, w3, h3;
-	unsigned char* aoData = LoadGrayscale(ao, w1, h1);
-	unsigned char* roughData = LoadGrayscale(rough, w2, h2);
-	unsigned char* metalData = LoadGrayscale(metal, w3, h3);
-
-	if(!aoData || !roughData || !metalData) return false;
-	if(w1 != w2 || w1 != w3 || h1 != h2 || h1 != h3) {
-		std::cerr << "Size mismatch!\n";
+	ORMJob job;
+	job.aoPath = ao;
+	job.roughnessPath = rough;
+	job.metallicPath = metal;
+	job.unrealPath = unrealPath;
+	job.unityPath = unityPath;
+	job.generateUnreal = doUnreal;
+	job.generateUnity = doUnity;
+	job.keepUnrealPixels = doUnreal;
+	job.outputSize = outputSize;
+
+	// Runs on the generation thread: the packed preview is queued for the render thread,
+	// which uploads it on its next frame while the PNGs are still being encoded.
+	ORMResult result = ormGenerator.Generate(sources, job, progressCallback,
+		[this] (ORMPackedImage&& packed) { PostORMPreview(std::move(packed)); });
+	if(!result.Succeeded()) {
+		std::cerr << result.message << "\n";
 		return false;
 	}
 
-	size_t count = w1 * h1;
-	float totalSteps = 0.0f;
-	if(doUnreal) totalSteps += 2.0f;
-	if(doUnity) totalSteps += 2.0f;
-
-	float currentStep = 0.0f;
-
-	if(doUnreal) {
-		std::vector<unsigned char> ormRGB(count * 3);
-		for(size_t i = 0; i < count; ++i) {
-			ormRGB[i * 3 + 0] = aoData[i];
-			ormRGB[i * 3 + 1] = roughData[i];
-			ormRGB[i * 3 + 2] = metalData[i];
-
-			if(progressCallback && (i % (count / 100 + 1) == 0)) {
-				float pixelProgress = static_cast<float>(i) / count;
-				progressCallback((currentStep + pixelProgress) / totalSteps);
-			}
-		}
-		currentStep += 1.0f;
-
-		stbi_write_png(unrealPath.c_str(), w1, h1, 3, ormRGB.data(), w1 * 3);
-		currentStep += 1.0f;
-		if(progressCallback) progressCallback(currentStep / totalSteps);
-
-		ormPreview.Unload();
-		ormPreview.path = unrealPath;
-		ormPreview.width = w1;
-		ormPreview.height = h1;
-		glGenTextures(1, &ormPreview.glId);
-		glBindTexture(GL_TEXTURE_2D, ormPreview.glId);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w1, h1, 0, GL_RGB, GL_UNSIGNED_BYTE, ormRGB.data());
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		ormPreview.GenerateChannelsFromRGB(ormRGB.data(), w1, h1);
-	}
-
-	if(doUnity) {
-		std::vector<unsigned char> ormRGBA(count * 4);
-		for(size_t i = 0; i < count; ++i) {
-			ormRGBA[i * 4 + 0] = metalData[i];
-			ormRGBA[i * 4 + 1] = aoData[i];
-			ormRGBA[i * 4 + 2] = 255;
-			ormRGBA[i * 4 + 3] = 255 - roughData[i];
-
-			if(progressCallback && (i % (count / 100 + 1) == 0)) {
-				float pixelProgress = static_cast<float>(i) / count;
-				progressCallback((currentStep + pixelProgress) / totalSteps);
-			}
-		}
-		currentStep += 1.0f;
-
-		stbi_write_png(unityPath.c_str(), w1, h1, 4, ormRGBA.data(), w1 * 4);
-		currentStep += 1.0f;
-		if(progressCallback) progressCallback(currentStep / totalSteps);
-	}
-
-	stbi_image_free(aoData);
-	stbi_image_free(roughData);
-	stbi_image_free(metalData);
-
-	if(progressCallback) progressCallback(1.0f);
 	return true;
 }
 
@@ -304,13 +210,21 @@ void UIManager::ShowMainUI()
 		{
 			if(ImGui::BeginMenu("Save"))
 			{
-				if(ImGui::MenuItem("Save to PNG"))
+				if(ImGui::MenuItem("Save to PNG", nullptr, false, ormPreview.packedRGB != nullptr))
+				{
+					ExportORMPreview(ImageFormat::PNG);
+				}
+				if(ImGui::MenuItem("Save to JPG", nullptr, false, ormPreview.packedRGB != nullptr))
 				{
-					std::cout << "Save selected\n";
+					ExportORMPreview(ImageFormat::JPG);
 				}
-				if(ImGui::MenuItem("Save to JPG"))
+				if(ImGui::MenuItem("Save to TGA", nullptr, false, ormPreview.packedRGB != nullptr))
 				{
-					std::cout << "Save selected\n";
+					ExportORMPreview(ImageFormat::TGA);
+				}
+				if(ImGui::MenuItem("Save to BMP", nullptr, false, ormPreview.packedRGB != nullptr))
+				{
+					ExportORMPreview(ImageFormat::BMP);
 				}
 				ImGui::EndMenu();
 			}
@@ -359,14 +273,32 @@ void UIManager::ShowMainUI()
 		generatingORM = true;
 		ormProgress = 0.0f;
 
-		loadingThread = std::thread([this] {
+		// Hand the already decoded previews to the generator; planes are immutable and shared.
+		ORMSources sources;
+		sources.ao = aoPreview.plane;
+		sources.roughness = roughPreview.plane;
+		sources.metallic = metallicPreview.plane;
+
+		// With every combo on "Source", mixed sizes still pack at the largest input's size.
+		int outputSize = std::max({ resolutionValues[aoResolutionIndex], resolutionValues[roughResolutionIndex],
+			resolutionValues[metalResolutionIndex] });
+		if(outputSize == 0) {
+			const bool sameSize = aoPreview.width == roughPreview.width && aoPreview.width == metallicPreview.width
+				&& aoPreview.height == roughPreview.height && aoPreview.height == metallicPreview.height;
+			if(!sameSize) {
+				for(const PreviewTexture* preview : { &aoPreview, &roughPreview, &metallicPreview })
+					outputSize = std::max({ outputSize, preview->width, preview->height });
+			}
+		}
+
+		loadingThread = std::thread([this, sources, outputSize] {
 			SaveUnrealAndUnityORM(
+				sources,
 				aoPreview.path, roughPreview.path, metallicPreview.path,
 				generatedUnrealPath, outputUnity,
-				generateUnrealORM, generateUnityORM,
+				generateUnrealORM, generateUnityORM, outputSize,
 				[this] (float p) { ormProgress = p; }
 			);
-			needsPreviewUpdate = true;
 			generatingORM = false;
 			});
 		loadingThread.detach();
@@ -405,17 +337,8 @@ void UIManager::ShowMainUI()
 
 		if(ImGui::ImageButton(label, (ImTextureID)(intptr_t)tex.glId, ImVec2(128, 128))) {
 			nfdchar_t* outPath = nullptr;
-			if(NFD_OpenDialog("png,jpg", nullptr, &outPath) == NFD_OKAY) {
-				tex.Unload();
-				tex.path = outPath;
-				if(tex.Load(outPath)) {
-					for(int i = 0; i < IM_ARRAYSIZE(resolutionValues); ++i) {
-						if(tex.width == resolutionValues[i]) {
-							resolutionIndex = i;
-							break;
-						}
-					}
-				}
+			if(NFD_OpenDialog("png,jpg,hdr,exr", nullptr, &outPath) == NFD_OKAY) {
+				LoadPreviewAsync(tex, outPath, resolutionIndex);
 				free(outPath);
 			}
 		}
@@ -435,10 +358,8 @@ void UIManager::ShowMainUI()
 	float aspect = ormPreview.width > 0 ? (float)ormPreview.height / ormPreview.width : 1.0f;
 	float previewHeight = previewWidth * aspect;
 
+	ormPreview.ShowChannel(selectedChannel);
 	GLuint texId = ormPreview.glId;
-	if(selectedChannel == ORMChannel::AO_R) texId = ormPreview.channelR;
-	else if(selectedChannel == ORMChannel::Roughness_G) texId = ormPreview.channelG;
-	else if(selectedChannel == ORMChannel::Metallic_B) texId = ormPreview.channelB;
 
 	if(texId)
 	{
@@ -454,7 +375,7 @@ void UIManager::ShowMainUI()
 		if (generatingORM )
 			AddLoadingCube("Generate", loaderPos);
 
-		if(loadingTexture)
+		if(loadingTextures > 0)
 			AddLoadingCube("Loading", loaderPos);
 	}
 
@@ -467,25 +388,114 @@ void UIManager::ShowMainUI()
 
 }
 
-void UIManager::UpdatePreviewIfNeeded() {
-	if(!needsPreviewUpdate) return;
+void UIManager::LoadPreviewAsync(PreviewTexture& tex, const std::string& path, int& resolutionIndex)
+{
+	tex.Unload();
+	tex.path = path;
+	const uint64_t request = ++tex.loadRequest;
+	++loadingTextures;
+
+	workerPool.Submit([this, &tex, &resolutionIndex, path, request] {
+		GrayscalePlane plane;
+		const ORMResult loaded = decodeCache.Load(path, plane);
+		if(!loaded.Succeeded()) {
+			std::cerr << loaded.message << std::endl;
+			--loadingTextures;
+			return;
+		}
+
+		// Thumbnails are 8-bit; the plane itself keeps its depth for generation.
+		std::shared_ptr<const unsigned char> display = plane.pixels;
+		if(plane.bitDepth != 8) {
+			const size_t count = static_cast<size_t>(plane.width) * plane.height;
+			std::shared_ptr<unsigned char> narrow = BufferPool::AllocateShared(count);
+			if(!narrow) {
+				std::cerr << "Out of memory narrowing the thumbnail of " << path << std::endl;
+				--loadingTextures;
+				return;
+			}
+			if(plane.bitDepth == 32)
+				ChannelKernels::Quantize(reinterpret_cast<const float*>(plane.pixels.get()), narrow.get(), count, QuantizeMode::Nearest, 0, 0);
+			else
+				ChannelKernels::NarrowTo8(reinterpret_cast<const uint16_t*>(plane.pixels.get()), narrow.get(), count);
+			display = std::move(narrow);
+		}
 
-	ormPreview.Unload();
-	ormPreview.path = generatedUnrealPath;
-
-	int w, h, channels;
-	unsigned char* data = stbi_load(generatedUnrealPath.c_str(), &w, &h, &channels, 3);
-	if(data) {
-		ormPreview.width = w;
-		ormPreview.height = h;
-		glGenTextures(1, &ormPreview.glId);
-		glBindTexture(GL_TEXTURE_2D, ormPreview.glId);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		ormPreview.GenerateChannelsFromRGB(data, w, h);
-		stbi_image_free(data);
+		GpuUploadImage image = MakeDisplayImage(display, plane.width, plane.height, 1, ORM::ThumbnailProxySize);
+		uploadQueue->Post(std::move(image), [this, &tex, &resolutionIndex, plane, request] (unsigned int texture, const GpuUploadImage&) {
+			--loadingTextures;
+			if(tex.loadRequest != request) {
+				glDeleteTextures(1, &texture);  // superseded by a newer pick
+				return;
+			}
+
+			tex.glId = texture;
+			tex.plane = plane;
+			tex.width = plane.width;
+			tex.height = plane.height;
+			resolutionIndex = 0;
+			for(int i = 1; i < IM_ARRAYSIZE(resolutionValues); ++i) {
+				if(std::max(tex.width, tex.height) == resolutionValues[i]) {
+					resolutionIndex = i;
+					break;
+				}
+			}
+		});
+	});
+}
+
+void UIManager::PostORMPreview(ORMPackedImage&& packed)
+{
+	const int width = packed.width;
+	const int height = packed.height;
+	auto rgb = std::make_shared<std::vector<unsigned char>>(std::move(packed.unrealRGB));
+	std::shared_ptr<const unsigned char> pixels(rgb, rgb->data());
+	GpuUploadImage image = MakeDisplayImage(pixels, width, height, 3, ORM::ViewportProxySize);
+
+	uploadQueue->Post(std::move(image), [this, pixels, width, height] (unsigned int texture, const GpuUploadImage&) {
+		ormPreview.Unload();
+		ormPreview.path = generatedUnrealPath;
+		ormPreview.glId = texture;
+		ormPreview.packedRGB = pixels;
+		ormPreview.width = width;
+		ormPreview.height = height;
+	});
+}
+
+GpuUploadImage UIManager::MakeDisplayImage(const std::shared_ptr<const unsigned char>& pixels, int width, int height, int channels, int maxEdge) const
+{
+	int proxyWidth, proxyHeight;
+	ImageResampler::FitWithin(width, height, maxEdge, proxyWidth, proxyHeight);
+
+	GpuUploadImage image{ pixels, width, height, channels };
+	if(proxyWidth != width || proxyHeight != height) {
+		ResampledImage proxy = resampler.Resize(pixels.get(), width, height, channels, proxyWidth, proxyHeight);
+		image.pixels = std::move(proxy.pixels);
+		image.width = proxyWidth;
+		image.height = proxyHeight;
 	}
 
-	needsPreviewUpdate = false;
-}
\ No newline at end of file
+	for(ResampledImage& level : resampler.BuildMipChain(image.pixels.get(), image.width, image.height, channels))
+		image.mips.push_back(std::move(level.pixels));
+	return image;
+}
+
+void UIManager::ExportORMPreview(ImageFormat format)
+{
+	nfdchar_t* outPath = nullptr;
+	if(!ormPreview.packedRGB || NFD_SaveDialog(IOService::GetExtension(format), nullptr, &outPath) != NFD_OKAY)
+		return;
+
+	std::string path = outPath;
+	free(outPath);
+	if(std::filesystem::path(path).extension().empty())
+		path += std::string(".") + IOService::GetExtension(format);
+
+	// The viewport texture is at most ViewportProxySize, so save the packed pixels it was made from instead.
+	exporter.Save(ormPreview.packedRGB, ormPreview.width, ormPreview.height, 3, path, format, [] (bool saved, const std::string& savedPath) {
+		if(saved)
+			std::cout << "Saved " << savedPath << "\n";
+		else
+			std::cerr << "Failed to save " << savedPath << "\n";
+	});
+}
@@ -1,5 +1,6 @@
 #pragma once 
 #include <string>
+#include <cstdint>
 #include <atomic>
 #include <future>
 #include <thread>
@@ -17,6 +18,13 @@
 #include <imgui_internal.h>
 #include <map>
 
+#include "DecodeCache.h"
+#include "ORMGenerator.h"
+#include "GpuUploadQueue.h"
+#include "ImageResampler.h"
+#include "TextureExporter.h"
+#include "ThreadPool.h"
+
 
 //   ImVec2
 inline ImVec2 operator+(const ImVec2& lhs, const ImVec2& rhs) {
@@ -184,20 +192,31 @@ inline void AddLoadingCube(const char* label, ImVec2 position)
 	ImGui::PopID();
 }
 
+enum class ORMChannel { AllRGB, AO_R, Roughness_G, Metallic_B };
+
 struct PreviewTexture
 {
 	std::string path;
 	GLuint glId = 0;
-	GLuint channelR = 0, channelG = 0, channelB = 0;
 	int width = 0, height = 0;
-	unsigned char* data = nullptr;
 
-	bool Load(const std::string& p);
+	// Channel the texture's swizzle currently isolates; a fresh texture shows all of RGB.
+	ORMChannel shownChannel = ORMChannel::AllRGB;
+
+	// Decoded source, shared with ORMGenerator so a Generate click does not decode it again.
+	GrayscalePlane plane;
+
+	// Full-resolution packed RGB of the ORM preview, whose texture is only the display proxy; kept for export.
+	std::shared_ptr<const unsigned char> packedRGB;
+
+	// Incremented per load; an upload finishing for an older request is discarded.
+	uint64_t loadRequest = 0;
+
 	void Unload();
-	void GenerateChannelsFromRGB(unsigned char* src, int w, int h);
-};
 
-enum class ORMChannel { AllRGB, AO_R, Roughness_G, Metallic_B };
+	/** Render thread only. Shows one channel as gray through the texture swizzle, without extra textures. */
+	void ShowChannel(ORMChannel channel);
+};
 
 class UIManager
 {
@@ -205,7 +224,7 @@ public:
 	UIManager();
 	~UIManager();
 
-	void Initialize(GLFWwindow* window);
+	void Initialize(GLFWwindow* window, GpuUploadQueue& uploads);
 	void BeginFrame();
 	void DrawUI();
 	void Render();
@@ -215,13 +234,23 @@ private:
 
 	// UI state and logic
 	void ShowMainUI();
-	void UpdatePreviewIfNeeded();
+
+	// Decodes on the worker pool and uploads through the render thread's queue.
+	void LoadPreviewAsync(PreviewTexture& tex, const std::string& path, int& resolutionIndex);
+	void PostORMPreview(ORMPackedImage&& packed);
+
+	// Encodes the full-resolution packed pixels behind the viewport texture on the worker pool.
+	void ExportORMPreview(ImageFormat format);
+
+	// Display-sized, mipmapped copy of an image; full resolution is never uploaded.
+	GpuUploadImage MakeDisplayImage(const std::shared_ptr<const unsigned char>& pixels, int width, int height, int channels, int maxEdge) const;
 
 	// Image loading/generation
 	bool SaveUnrealAndUnityORM(
+		const ORMSources& sources,
 		const std::string& ao, const std::string& rough, const std::string& metal,
 		const std::string& unrealPath, const std::string& unityPath,
-		bool doUnreal, bool doUnity,
+		bool doUnreal, bool doUnity, int outputSize,
 		const std::function<void(float)>& progressCallback = nullptr
 	);
 
@@ -236,18 +265,29 @@ private:
 	int roughResolutionIndex = 0;
 	int metalResolutionIndex = 0;
 
-	const char* resolutionOptions[6] = { "128","256","512","1024","2048","4096" };
-	const int resolutionValues[6] = { 128, 256, 512, 1024, 2048, 4096 };
+	// Output long edge per input; the largest choice wins and every plane is resampled to it.
+	// "Source" keeps the input's own size.
+	const char* resolutionOptions[7] = { "Source","128","256","512","1024","2048","4096" };
+	const int resolutionValues[7] = { 0, 128, 256, 512, 1024, 2048, 4096 };
 
-	std::atomic<bool> needsPreviewUpdate = false;
 	std::atomic<bool> generatingORM = false;
-	float ormProgress = 0.0f;
+	std::atomic<float> ormProgress = 0.0f;
 	std::string generatedUnrealPath = "orm_unreal.png";
 	std::string outputUnity = "orm_unity.png";
 
 	std::mutex loadingMutex;
 	std::thread loadingThread;
 
-	std::atomic<bool> loadingTexture;
+	std::atomic<int> loadingTextures = 0;
+
+	// Owned by Application and drained on the render thread every frame.
+	GpuUploadQueue* uploadQueue = nullptr;
+
+	// Declared before the pool so in-flight decode tasks never outlive the cache.
+	DecodeCache decodeCache;
+	ThreadPool workerPool;
+	ORMGenerator ormGenerator{ workerPool, &decodeCache };
+	ImageResampler resampler{ workerPool };
+	TextureExporter exporter{ workerPool };
 };
 
@@ -0,0 +1,288 @@
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "Constants.h"
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+#endif
+
+namespace
+{
+	// Every block starts with its header; callers get the bytes after it.
+	constexpr size_t HeaderBytes = 64;
+	constexpr int Unpooled = -1;
+	constexpr int ClassCount = 64 * 4 + 5;
+
+	struct Header
+	{
+		size_t capacity;
+		int sizeClass;
+		bool mapped;
+	};
+	static_assert(sizeof(Header) <= HeaderBytes, "block header must fit its slot");
+
+	struct State
+	{
+		std::mutex mutex;
+		std::vector<Header*> freeLists[ClassCount];
+		size_t retainLimit = ORM::BufferPoolRetainBytes;
+		size_t retainedBytes = 0;
+		size_t hits = 0;
+		size_t misses = 0;
+		std::atomic<size_t> currentBytes{ 0 };
+		std::atomic<size_t> peakBytes{ 0 };
+	};
+
+	// Never destroyed: planes and buffers may be freed by static destructors after main.
+	State& GetState()
+	{
+		static State* state = new State();
+		return *state;
+	}
+
+	/** Quarter-octave class of a pooled size: the smallest 2^e * (1 + m / 4) that holds bytes. */
+	int GetSizeClass(size_t bytes, size_t& capacity)
+	{
+		int exponent = 0;
+		while((bytes - 1) >> (exponent + 1))
+			++exponent;
+		const size_t octave = static_cast<size_t>(1) << exponent;
+		const size_t step = octave >> 2;
+		const size_t quarter = (bytes - 1 - octave) / step + 1;
+		capacity = octave + quarter * step;
+		return exponent * 4 + static_cast<int>(quarter);
+	}
+
+	Header* FromPointer(void* pointer)
+	{
+		return reinterpret_cast<Header*>(static_cast<unsigned char*>(pointer) - HeaderBytes);
+	}
+
+	void* ToPointer(Header* header)
+	{
+		return reinterpret_cast<unsigned char*>(header) + HeaderBytes;
+	}
+
+	void AddUsage(State& state, size_t bytes)
+	{
+		const size_t now = state.currentBytes.fetch_add(bytes) + bytes;
+		size_t peak = state.peakBytes.load();
+		while(now > peak && !state.peakBytes.compare_exchange_weak(peak, now)) {}
+	}
+
+	Header* AllocateBlock(size_t capacity, int sizeClass)
+	{
+		const size_t total = capacity + HeaderBytes;
+		void* base = nullptr;
+		const bool mapped = sizeClass != Unpooled && capacity >= ORM::HugePageBytes;
+		if(mapped) {
+#ifdef _WIN32
+			base = VirtualAlloc(nullptr, total, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+			base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if(base == MAP_FAILED)
+				base = nullptr;
+	#ifdef MADV_HUGEPAGE
+			else
+				madvise(base, total, MADV_HUGEPAGE);
+	#endif
+#endif
+		}
+		else
+			base = std::malloc(total);
+		if(!base)
+			return nullptr;
+
+		Header* header = static_cast<Header*>(base);
+		header->capacity = capacity;
+		header->sizeClass = sizeClass;
+		header->mapped = mapped;
+		return header;
+	}
+
+	void ReleaseBlock(Header* header)
+	{
+		if(!header->mapped) {
+			std::free(header);
+			return;
+		}
+#ifdef _WIN32
+		VirtualFree(header, 0, MEM_RELEASE);
+#else
+		munmap(header, header->capacity + HeaderBytes);
+#endif
+	}
+
+	void ReleaseBlocks(std::vector<Header*>& blocks)
+	{
+		for(Header* header : blocks)
+			ReleaseBlock(header);
+		blocks.clear();
+	}
+}
+
+void* BufferPool::Allocate(size_t bytes)
+{
+	if(bytes == 0)
+		return nullptr;
+
+	State& state = GetState();
+	if(bytes < ORM::BufferPoolMinBytes) {
+		Header* header = AllocateBlock(bytes, Unpooled);
+		if(!header)
+			return nullptr;
+		AddUsage(state, bytes);
+		return ToPointer(header);
+	}
+
+	size_t capacity = 0;
+	const int sizeClass = GetSizeClass(bytes, capacity);
+
+	Header* header = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		std::vector<Header*>& freeList = state.freeLists[sizeClass];
+		if(!freeList.empty()) {
+			header = freeList.back();
+			freeList.pop_back();
+			state.retainedBytes -= capacity;
+			++state.hits;
+		}
+		else
+			++state.misses;
+	}
+
+	if(!header) {
+		header = AllocateBlock(capacity, sizeClass);
+		if(!header) {
+			// Out of memory with blocks of other sizes cached: give those back and retry once.
+			Trim();
+			header = AllocateBlock(capacity, sizeClass);
+		}
+		if(!header)
+			return nullptr;
+	}
+	AddUsage(state, capacity);
+	return ToPointer(header);
+}
+
+void* BufferPool::Reallocate(void* pointer, size_t bytes)
+{
+	if(!pointer)
+		return Allocate(bytes);
+	if(bytes == 0) {
+		Free(pointer);
+		return nullptr;
+	}
+
+	Header* header = FromPointer(pointer);
+	if(header->sizeClass != Unpooled && bytes >= ORM::BufferPoolMinBytes) {
+		size_t capacity = 0;
+		if(GetSizeClass(bytes, capacity) == header->sizeClass)
+			return pointer;
+	}
+
+	// A different class: move, so a shrunk buffer hands its large block back to the pool.
+	void* moved = Allocate(bytes);
+	if(!moved)
+		return nullptr;
+	std::memcpy(moved, pointer, std::min(bytes, header->capacity));
+	Free(pointer);
+	return moved;
+}
+
+void BufferPool::Free(void* pointer)
+{
+	if(!pointer)
+		return;
+
+	State& state = GetState();
+	Header* header = FromPointer(pointer);
+	state.currentBytes.fetch_sub(header->capacity);
+	if(header->sizeClass != Unpooled) {
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if(state.retainedBytes + header->capacity <= state.retainLimit) {
+			state.freeLists[header->sizeClass].push_back(header);
+			state.retainedBytes += header->capacity;
+			return;
+		}
+	}
+	ReleaseBlock(header);
+}
+
+std::shared_ptr<unsigned char> BufferPool::AllocateShared(size_t bytes)
+{
+	unsigned char* pixels = static_cast<unsigned char*>(Allocate(bytes));
+	if(!pixels)
+		return nullptr;
+	return std::shared_ptr<unsigned char>(pixels, Free);
+}
+
+void BufferPool::SetRetainLimit(size_t bytes)
+{
+	State& state = GetState();
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.retainLimit = bytes;
+		if(state.retainedBytes <= bytes)
+			return;
+	}
+	Trim();
+}
+
+size_t BufferPool::GetRetainLimit()
+{
+	State& state = GetState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+	return state.retainLimit;
+}
+
+void BufferPool::Trim()
+{
+	State& state = GetState();
+	std::vector<Header*> blocks;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		for(std::vector<Header*>& freeList : state.freeLists) {
+			blocks.insert(blocks.end(), freeList.begin(), freeList.end());
+			std::vector<Header*>().swap(freeList);
+		}
+		state.retainedBytes = 0;
+	}
+	ReleaseBlocks(blocks);
+}
+
+void BufferPool::ResetPeak()
+{
+	State& state = GetState();
+	state.peakBytes = state.currentBytes.load();
+}
+
+BufferPoolStats BufferPool::GetStats()
+{
+	State& state = GetState();
+	BufferPoolStats stats;
+	stats.currentBytes = state.currentBytes.load();
+	stats.peakBytes = state.peakBytes.load();
+
+	std::lock_guard<std::mutex> lock(state.mutex);
+	stats.retainedBytes = state.retainedBytes;
+	stats.hits = state.hits;
+	stats.misses = state.misses;
+	return stats;
+}
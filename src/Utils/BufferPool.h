@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+
+struct BufferPoolStats
+{
+	size_t currentBytes = 0;   // handed out and not yet freed
+	size_t peakBytes = 0;      // highest currentBytes since start or ResetPeak()
+	size_t retainedBytes = 0;  // freed blocks kept for reuse
+	size_t hits = 0;           // pooled allocations served from a retained block
+	size_t misses = 0;         // pooled allocations that went to the OS
+};
+
+/**
+ * Class: BufferPool
+ *
+ * Process-wide, size-classed allocator for the large per-material buffers:
+ * decoded planes (stb and ExrReader allocate through it), converted and
+ * resampled planes, PNG strips and block-compression bands. A freed block is
+ * kept on its size class's free list, so the next material of a batch reuses
+ * the same, already faulted-in memory instead of churning the heap.
+ *
+ * Notes:
+ * - Thread-safe. Requests below ORM::BufferPoolMinBytes go straight to malloc
+ *   and only count towards the usage counters.
+ * - Pooled sizes are rounded up to a quarter octave (at most 25% slack);
+ *   power-of-two texture planes fit their class exactly.
+ * - Blocks of ORM::HugePageBytes and more are mapped from the OS directly and,
+ *   on Linux, marked for transparent huge pages. Windows large pages need a
+ *   privilege ORMTool does not ask for, so there they are regular pages.
+ * - At most the retain limit stays cached; frees beyond it go back to the OS.
+ */
+class BufferPool
+{
+public:
+	/** Null only for size 0 or when the OS is out of memory; aligned at least like malloc. */
+	static void* Allocate(size_t bytes);
+	static void* Reallocate(void* pointer, size_t bytes);
+	static void Free(void* pointer);
+
+	/** A pooled buffer released to the pool by its last owner. */
+	static std::shared_ptr<unsigned char> AllocateShared(size_t bytes);
+
+	static void SetRetainLimit(size_t bytes);
+	static size_t GetRetainLimit();
+
+	/** Returns every retained block to the OS. */
+	static void Trim();
+	static void ResetPeak();
+
+	static BufferPoolStats GetStats();
+};
+
+/**
+ * Class: PooledBuffer
+ *
+ * Move-only owner of one BufferPool block; the stand-in for a scratch
+ * std::vector<unsigned char> that does not zero its contents. It never
+ * throws: when the pool is out of memory the buffer is left empty (null data,
+ * size 0), and the worker that asked for it reports a failed write instead.
+ */
+class PooledBuffer
+{
+public:
+	PooledBuffer() = default;
+	explicit PooledBuffer(size_t bytes) : data(static_cast<unsigned char*>(BufferPool::Allocate(bytes))), size(data ? bytes : 0)
+	{
+	}
+	~PooledBuffer() { BufferPool::Free(data); }
+
+	PooledBuffer(PooledBuffer&& other) noexcept : data(other.data), size(other.size) { other.data = nullptr; other.size = 0; }
+	PooledBuffer& operator=(PooledBuffer&& other) noexcept
+	{
+		if(this != &other) {
+			BufferPool::Free(data);
+			data = other.data;
+			size = other.size;
+			other.data = nullptr;
+			other.size = 0;
+		}
+		return *this;
+	}
+	PooledBuffer(const PooledBuffer&) = delete;
+	PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+	unsigned char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	unsigned char* data = nullptr;
+	size_t size = 0;
+};
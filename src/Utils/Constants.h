@@ -1,9 +1,48 @@
 #pragma once 
 
 #include <string_view>
+#include <cstddef>
 namespace ORM
 {
 	static constexpr const char* TitleStr = "ORMTool";
 	static constexpr const int WindowWidth = 706;
 	static constexpr const int WindowHeight = 677;
-}
\ No newline at end of file
+
+	// Working-set budget of one packing tile (source rows + packed rows), sized to stay in L2.
+	static constexpr const size_t PackTileBytes = 256 * 1024;
+
+	// Filtered bytes per independently deflated PNG strip; large enough that losing the
+	// shared 32 KiB dictionary at strip boundaries costs well under a percent of ratio.
+	static constexpr const size_t PngStripBytes = 1024 * 1024;
+
+	// Buffers from this size up are pooled by BufferPool; smaller ones go straight to malloc.
+	static constexpr const size_t BufferPoolMinBytes = 64 * 1024;
+
+	// Freed pooled buffers kept for reuse, roughly one large material's working set.
+	static constexpr const size_t BufferPoolRetainBytes = static_cast<size_t>(512) * 1024 * 1024;
+
+	// Pooled blocks this large are mapped from the OS and backed by huge pages where available.
+	static constexpr const size_t HugePageBytes = 2 * 1024 * 1024;
+
+	// Materials a batch prepares / encodes at the same time: one streams its strips while the
+	// previous one's tail (last strip wave, DDS, KTX2) winds down on the remaining workers.
+	static constexpr const size_t BatchStageSlots = 2;
+
+	// Two-subset BC7 partitions the High encoder tries per block, best-ranked first.
+	static constexpr const int Bc7PartitionCandidates = 4;
+
+	// Default memory budget of the decoded source cache.
+	static constexpr const size_t DecodeCacheBytes = static_cast<size_t>(512) * 1024 * 1024;
+
+	// Time the render thread may spend creating textures per frame (a 60 Hz frame is ~16.7 ms).
+	static constexpr const double GpuUploadBudgetMs = 4.0;
+
+	// Pixel unpack buffers that stream large images to the GPU a few rows at a time.
+	static constexpr const size_t UploadSlotBytes = static_cast<size_t>(4) * 1024 * 1024;
+	static constexpr const int UploadSlotCount = 3;
+
+	// Longest edge of the textures uploaded for display: the 128 px source thumbnails and the
+	// ~540 px ORM viewport, with headroom for high-DPI scaling. Full resolution stays on the CPU.
+	static constexpr const int ThumbnailProxySize = 256;
+	static constexpr const int ViewportProxySize = 1024;
+}
@@ -0,0 +1,159 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Identifies the pool and deque of the current thread, so nested submissions stay local.
+	thread_local const ThreadPool* currentPool = nullptr;
+	thread_local size_t currentWorker = 0;
+}
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+	if(threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	queues.reserve(threadCount);
+	for(size_t i = 0; i < threadCount; ++i)
+		queues.push_back(std::make_unique<WorkerQueue>());
+
+	workers.reserve(threadCount);
+	for(size_t i = 0; i < threadCount; ++i)
+		workers.emplace_back([this, i] { WorkerLoop(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for(std::thread& worker : workers)
+	{
+		if(worker.joinable())
+			worker.join();
+	}
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+	return workers.size();
+}
+
+size_t ThreadPool::GetStealCount() const
+{
+	return steals.load();
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	const size_t target = currentPool == this ? currentWorker : nextQueue.fetch_add(1) % queues.size();
+	{
+		std::lock_guard<std::mutex> lock(queues[target]->mutex);
+		queues[target]->tasks.push_back(std::move(task));
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		pendingTasks.fetch_add(1);
+	}
+	wakeCondition.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+	if(count == 0)
+		return;
+
+	if(count == 1 || workers.empty()) {
+		for(size_t i = 0; i < count; ++i)
+			body(i);
+		return;
+	}
+
+	// Shared with helper tasks that may only get scheduled after this call returned.
+	struct ForState
+	{
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> done{ 0 };
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	auto state = std::make_shared<ForState>();
+	const std::function<void(size_t)>* bodyPtr = &body;
+
+	auto drain = [state, bodyPtr, count] {
+		size_t index;
+		while((index = state->next.fetch_add(1)) < count)
+		{
+			(*bodyPtr)(index);
+			if(state->done.fetch_add(1) + 1 == count) {
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->finished.notify_all();
+			}
+		}
+	};
+
+	// The caller drains too, so N workers plus the caller would oversubscribe by one.
+	const size_t helpers = std::min(workers.size() - 1, count - 1);
+	for(size_t i = 0; i < helpers; ++i)
+		Submit(drain);
+
+	drain();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&] { return state->done.load() == count; });
+}
+
+void ThreadPool::WorkerLoop(size_t index)
+{
+	currentPool = this;
+	currentWorker = index;
+
+	for(;;)
+	{
+		std::function<void()> task;
+		if(TryPopLocal(index, task) || TrySteal(index, task)) {
+			pendingTasks.fetch_sub(1);
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeCondition.wait(lock, [this] { return stopping || pendingTasks.load() > 0; });
+		if(stopping && pendingTasks.load() == 0)
+			return;
+	}
+}
+
+bool ThreadPool::TryPopLocal(size_t index, std::function<void()>& task)
+{
+	WorkerQueue& queue = *queues[index];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if(queue.tasks.empty())
+		return false;
+
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool ThreadPool::TrySteal(size_t thief, std::function<void()>& task)
+{
+	for(size_t offset = 1; offset < queues.size(); ++offset)
+	{
+		WorkerQueue& victim = *queues[(thief + offset) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if(victim.tasks.empty())
+			continue;
+
+		task = std::move(victim.tasks.front());
+		victim.tasks.pop_front();
+		steals.fetch_add(1);
+		return true;
+	}
+	return false;
+}
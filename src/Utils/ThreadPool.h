@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Class: ThreadPool
+ *
+ * Fixed-size work-stealing pool used by the packing, encoding and batch stages.
+ * Every worker owns a deque: tasks submitted from a worker go to the back of its
+ * own deque and are popped LIFO, so a task's follow-up work stays hot in cache;
+ * idle workers steal FIFO from the front of other deques. Tasks submitted from
+ * outside the pool are spread round-robin over the worker deques.
+ *
+ * Work is submitted either as fire-and-forget tasks or as a blocking ParallelFor
+ * over an index range, in which the calling thread takes part as well.
+ *
+ * Notes:
+ * - ParallelFor is safe to call from inside a pool task: the caller keeps
+ *   draining indices itself, so nested use never waits on a busy worker.
+ * - A thread count of 0 selects std::thread::hardware_concurrency().
+ */
+class ThreadPool
+{
+public:
+	explicit ThreadPool(size_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/** Returns the number of worker threads owned by the pool. */
+	size_t GetThreadCount() const;
+
+	/** Returns how many tasks idle workers have taken from another worker's deque. */
+	size_t GetStealCount() const;
+
+	/** Queues a task for asynchronous execution on a worker thread. */
+	void Submit(std::function<void()> task);
+
+	/** Runs body(i) for every i in [0, count) and returns once all calls have finished. */
+	void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	void WorkerLoop(size_t index);
+	bool TryPopLocal(size_t index, std::function<void()>& task);
+	bool TrySteal(size_t thief, std::function<void()>& task);
+
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex sleepMutex;
+	std::condition_variable wakeCondition;
+	std::atomic<size_t> pendingTasks{ 0 };
+	std::atomic<size_t> nextQueue{ 0 };
+	std::atomic<size_t> steals{ 0 };
+	bool stopping = false;
+};
@@ -2,10 +2,14 @@
 
 #include <iostream>
 #include "App.h"
+#include "CommandLine.h"
 
 
-int main()
+int main(int argc, char** argv)
 {
+	if(CommandLine::IsHeadlessInvocation(argc, argv))
+		return CommandLine::Run(argc, argv);
+
 	Application app;
 
 	if(app.InitializeApplication() != InitStatus::Success)
@@ -0,0 +1,223 @@
+// BC7: the decoder against blocks of every emitted mode decoded by an independent
+// implementation, and the encoder presets against each other on test images.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "TestCheck.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	struct KnownBlock
+	{
+		unsigned char block[16];
+		unsigned char texels[64];
+	};
+
+	// Blocks written by the encoder, with the RGBA texels Pillow's BC7 decoder gives for them.
+	const KnownBlock KnownBlocks[] = {
+		// mode 1
+		{ { 0x82, 0x3F, 0xC0, 0xE0, 0xC6, 0x6F, 0xC0, 0x23, 0x71, 0xED, 0xF5, 0x94, 0x38, 0x75, 0xC1, 0xC6 },
+			{ 219, 58, 125, 255, 225, 193, 237, 255, 219, 58, 125, 255, 175, 145, 196, 255,
+			  109, 158, 71, 255, 48, 24, 92, 255, 2, 255, 18, 255, 150, 122, 176, 255,
+			  184, 90, 108, 255, 225, 193, 237, 255, 184, 90, 108, 255, 48, 24, 92, 255,
+			  38, 223, 36, 255, 200, 169, 217, 255, 255, 26, 143, 255, 123, 95, 153, 255 } },
+		// mode 3
+		{ { 0x88, 0xB8, 0x1F, 0x8F, 0x07, 0x0A, 0xA5, 0x45, 0x05, 0x8D, 0x41, 0x23, 0x80, 0x81, 0x7F, 0x7E },
+			{ 220, 80, 130, 255, 220, 80, 130, 255, 220, 80, 130, 255, 30, 80, 140, 255,
+			  220, 80, 130, 255, 220, 80, 130, 255, 220, 80, 130, 255, 30, 80, 140, 255,
+			  30, 80, 140, 255, 30, 80, 140, 255, 30, 80, 140, 255, 30, 180, 130, 255,
+			  30, 80, 140, 255, 30, 80, 140, 255, 30, 80, 140, 255, 30, 180, 130, 255 } },
+		// mode 4, no rotation, 2-bit color indices
+		{ { 0x10, 0x58, 0x95, 0xDA, 0xC7, 0xD0, 0xDF, 0x5F, 0xB4, 0x16, 0x51, 0x67, 0x8F, 0xF8, 0x0B, 0xC7 },
+			{ 160, 84, 168, 12, 82, 173, 24, 78, 120, 130, 95, 181, 82, 173, 24, 111,
+			  82, 173, 24, 214, 82, 173, 24, 214, 120, 130, 95, 111, 198, 41, 239, 148,
+			  120, 130, 95, 12, 120, 130, 95, 247, 160, 84, 168, 247, 160, 84, 168, 181,
+			  82, 173, 24, 12, 120, 130, 95, 214, 198, 41, 239, 45, 120, 130, 95, 214 } },
+		// mode 4, G rotated into the scalar, 3-bit color indices
+		{ { 0xD0, 0xC1, 0xFF, 0x6F, 0xD9, 0x9E, 0xC0, 0x7C, 0xD8, 0xBD, 0x90, 0x40, 0x92, 0x8E, 0x1E, 0xEB },
+			{ 8, 239, 181, 255, 75, 239, 158, 255, 75, 103, 158, 255, 8, 172, 181, 255,
+			  146, 103, 134, 255, 146, 36, 134, 255, 146, 36, 134, 255, 146, 239, 134, 255,
+			  213, 239, 111, 255, 42, 36, 169, 255, 75, 103, 158, 255, 247, 36, 99, 255,
+			  42, 103, 169, 255, 213, 36, 111, 255, 75, 172, 158, 255, 247, 172, 99, 255 } },
+		// mode 5, separate alpha
+		{ { 0x20, 0x0E, 0x09, 0x3C, 0xED, 0xD0, 0x90, 0x17, 0x87, 0x82, 0x00, 0xA1, 0xD3, 0xD1, 0xD1, 0xD1 },
+			{ 31, 220, 36, 218, 28, 225, 28, 228, 28, 225, 28, 218, 31, 220, 36, 197,
+			  31, 220, 36, 218, 28, 225, 28, 228, 28, 225, 28, 218, 31, 220, 36, 197,
+			  28, 225, 28, 218, 28, 225, 28, 228, 28, 225, 28, 218, 33, 216, 44, 197,
+			  28, 225, 28, 218, 28, 225, 28, 228, 31, 220, 36, 218, 36, 211, 52, 197 } },
+		// mode 5, B rotated into the scalar
+		{ { 0xE0, 0xB9, 0xF5, 0xFF, 0xF3, 0xFF, 0x8F, 0x8F, 0xE4, 0x96, 0xAF, 0xEE, 0xF6, 0x0B, 0xC0, 0x1A },
+			{ 147, 192, 164, 255, 114, 255, 164, 255, 215, 62, 35, 255, 147, 192, 35, 255,
+			  215, 62, 35, 255, 182, 125, 98, 255, 114, 255, 227, 255, 215, 62, 227, 255,
+			  215, 62, 227, 255, 147, 192, 227, 255, 147, 192, 227, 255, 147, 192, 35, 255,
+			  215, 62, 98, 255, 147, 192, 98, 255, 215, 62, 164, 255, 147, 192, 227, 255 } },
+		// mode 6
+		{ { 0x40, 0x89, 0x63, 0x1C, 0x3F, 0x35, 0x8E, 0xF0, 0x71, 0xFC, 0x81, 0xFD, 0x82, 0xFD, 0x93, 0xFD },
+			{ 37, 199, 79, 143, 33, 212, 55, 181, 31, 221, 38, 208, 29, 227, 27, 225,
+			  37, 201, 76, 148, 33, 214, 51, 187, 30, 223, 34, 213, 29, 227, 27, 225,
+			  36, 203, 72, 155, 33, 214, 51, 187, 30, 223, 34, 213, 29, 227, 27, 225,
+			  35, 205, 68, 160, 32, 216, 48, 192, 30, 223, 34, 213, 29, 227, 27, 225 } },
+		// mode 7
+		{ { 0x80, 0x00, 0x21, 0x9B, 0x28, 0xAB, 0x6C, 0x84, 0x10, 0x5A, 0xCB, 0x2C, 0xE0, 0xE1, 0x1F, 0x1E },
+			{ 32, 81, 138, 178, 32, 81, 138, 178, 32, 178, 130, 178, 32, 178, 130, 178,
+			  32, 81, 138, 178, 32, 81, 138, 178, 32, 178, 130, 178, 32, 178, 130, 178,
+			  32, 178, 130, 178, 32, 178, 130, 178, 219, 81, 130, 97, 219, 81, 130, 97,
+			  32, 178, 130, 178, 32, 178, 130, 178, 219, 81, 130, 97, 219, 81, 130, 97 } }
+	};
+
+	/**
+	 * 64 pseudo-random blocks of each mode (block i of a partitioned mode uses partition i), as
+	 * FNV-1a of the RGBA texels Pillow decodes from them: pins the partition and anchor tables and
+	 * every field layout, including ones the encoder rarely picks.
+	 */
+	struct ModeHash
+	{
+		int mode;
+		uint64_t hash;
+	};
+
+	const ModeHash RandomBlockHashes[] = {
+		{ 1, 0xAA3036D39B728885ull },
+		{ 3, 0x048D04D449C075B9ull },
+		{ 4, 0xE139E31BD77509ABull },
+		{ 5, 0x6F0BD44E449DEA30ull },
+		{ 6, 0x65C848317554D8FBull },
+		{ 7, 0x2145EE22D6AAB7A4ull }
+	};
+
+	uint64_t SplitMix(uint64_t& state)
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	// Not a multiple of 4, so the repeated edge texels are covered too.
+	constexpr int Width = 30;
+	constexpr int Height = 22;
+
+	/** Smooth channels that do not follow one another, or hard edges between unrelated colors. */
+	std::vector<unsigned char> MakeImage(bool edges, int channels)
+	{
+		std::vector<unsigned char> pixels;
+		for(int y = 0; y < Height; ++y) {
+			for(int x = 0; x < Width; ++x) {
+				for(int c = 0; c < channels; ++c) {
+					const double smooth = 127.0 + 100.0 * std::sin(x * 0.1 * (c + 1) + y * 0.07 * (3 - c));
+					const int edge = (x / 3 + y / 2 + c) % 3 == 0 ? 220 - c * 40 : 30 + c * 50;
+					pixels.push_back(static_cast<unsigned char>(edges ? edge : std::lround(smooth)));
+				}
+			}
+		}
+		return pixels;
+	}
+
+	/** Squared error of the decoded image; inputs without alpha are compared against opaque. */
+	double GetError(const std::vector<unsigned char>& pixels, int channels, const std::vector<unsigned char>& blocks)
+	{
+		std::vector<unsigned char> decoded(static_cast<size_t>(Width) * Height * 4);
+		BlockCompressor::Decompress(blocks.data(), Width, Height, BlockFormat::BC7, decoded.data());
+		double error = 0.0;
+		for(size_t i = 0; i < static_cast<size_t>(Width) * Height; ++i) {
+			for(int c = 0; c < 4; ++c) {
+				const int expected = c < channels ? pixels[i * channels + c] : 255;
+				const double d = decoded[i * 4 + c] - expected;
+				error += d * d;
+			}
+		}
+		return error;
+	}
+
+	double GetPsnr(double error)
+	{
+		const double mse = error / (static_cast<double>(Width) * Height * 4);
+		return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 999.0;
+	}
+
+	void TestKnownBlocks()
+	{
+		for(const KnownBlock& known : KnownBlocks) {
+			unsigned char texels[64];
+			BlockCompressor::Decompress(known.block, 4, 4, BlockFormat::BC7, texels);
+			int mode = 0;
+			while(mode < 8 && !((known.block[0] >> mode) & 1))
+				++mode;
+			Test::Check(std::equal(texels, texels + 64, known.texels), "Decompress of a mode " + std::to_string(mode) + " block");
+		}
+	}
+
+	void TestRandomBlocks()
+	{
+		for(const ModeHash& expected : RandomBlockHashes) {
+			const int mode = expected.mode;
+			uint64_t state = static_cast<uint64_t>(mode);
+			uint64_t hash = 0xCBF29CE484222325ull;
+			for(int i = 0; i < 64; ++i) {
+				const uint64_t low = SplitMix(state);
+				const uint64_t high = SplitMix(state);
+				unsigned char block[16];
+				for(int b = 0; b < 8; ++b) {
+					block[b] = static_cast<unsigned char>(low >> (8 * b));
+					block[8 + b] = static_cast<unsigned char>(high >> (8 * b));
+				}
+
+				// The mode's unary prefix, then the partition number (the fields never cross a byte).
+				block[0] = static_cast<unsigned char>((block[0] & ~((2u << mode) - 1)) | (1u << mode));
+				if(mode == 1 || mode == 3 || mode == 7) {
+					uint32_t fields = block[0] | block[1] << 8;
+					fields = (fields & ~(63u << (mode + 1))) | static_cast<uint32_t>(i) << (mode + 1);
+					block[0] = static_cast<unsigned char>(fields);
+					block[1] = static_cast<unsigned char>(fields >> 8);
+				}
+
+				unsigned char texels[64];
+				BlockCompressor::Decompress(block, 4, 4, BlockFormat::BC7, texels);
+				for(unsigned char value : texels)
+					hash = (hash ^ value) * 0x100000001B3ull;
+			}
+			Test::Check(hash == expected.hash, "Decompress of random mode " + std::to_string(mode) + " blocks");
+		}
+	}
+
+	void TestPresets(ThreadPool& pool, bool edges, int channels)
+	{
+		const std::string name = std::string(edges ? "edges" : "smooth") + " with " + std::to_string(channels) + " channels";
+		const std::vector<unsigned char> pixels = MakeImage(edges, channels);
+		const BlockCompressor compressor(pool);
+
+		double errors[3];
+		const BlockQuality qualities[] = { BlockQuality::Fast, BlockQuality::Normal, BlockQuality::High };
+		for(int q = 0; q < 3; ++q) {
+			const std::vector<unsigned char> blocks = compressor.Compress(pixels.data(), Width, Height, channels, BlockFormat::BC7, qualities[q]);
+			if(!Test::Check(blocks.size() == BlockCompressor::GetCompressedSize(BlockFormat::BC7, Width, Height), name + ": compressed size"))
+				return;
+			errors[q] = GetError(pixels, channels, blocks);
+		}
+
+		Test::Check(errors[1] <= errors[0], name + ": Normal no worse than Fast");
+		Test::Check(errors[2] <= errors[1], name + ": High no worse than Normal");
+		// One subset cannot hold three unrelated colors; the partitioned and separate-channel modes can.
+		if(edges)
+			Test::Check(GetPsnr(errors[0]) < 30.0 && GetPsnr(errors[2]) > 40.0, name + ": High PSNR " + std::to_string(GetPsnr(errors[2])));
+	}
+}
+
+int main()
+{
+	TestKnownBlocks();
+	TestRandomBlocks();
+
+	ThreadPool pool;
+	for(bool edges : { false, true }) {
+		for(int channels : { 3, 4 })
+			TestPresets(pool, edges, channels);
+	}
+	return Test::Finish("BlockCompressor");
+}
@@ -0,0 +1,189 @@
+// Every SIMD level the CPU supports must match the Scalar kernels bit for bit,
+// at lengths around the 16/32/64-byte vector widths so the scalar tails run too.
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ChannelKernels.h"
+#include "TestCheck.h"
+
+namespace
+{
+	const size_t Lengths[] = { 0, 1, 7, 15, 16, 17, 31, 32, 33, 47, 48, 63, 64, 65, 127, 128, 129, 1000 };
+
+	const SimdLevel Levels[] = { SimdLevel::SSE2, SimdLevel::SSSE3, SimdLevel::AVX2, SimdLevel::NEON };
+
+	// Unaligned by one sample, so the vector loads and stores cannot rely on alignment.
+	constexpr size_t Offset = 1;
+
+	std::mt19937 random(1234);
+
+	std::vector<uint8_t> MakeBytes(size_t count)
+	{
+		std::uniform_int_distribution<int> byte(0, 255);
+		std::vector<uint8_t> bytes(count + Offset);
+		for(uint8_t& value : bytes)
+			value = static_cast<uint8_t>(byte(random));
+		return bytes;
+	}
+
+	/** Ordinary values, both clamp ends, exact rounding boundaries and non-finite input. */
+	std::vector<float> MakeFloats(size_t count)
+	{
+		std::uniform_real_distribution<float> unit(-0.1f, 1.1f);
+		std::uniform_int_distribution<int> code(0, 255);
+		const float specials[] = { 0.0f, 1.0f, -0.0f, -1.0f, 2.0f, 0.5f, std::numeric_limits<float>::quiet_NaN(),
+			std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), 1.0f / 255.0f };
+
+		std::vector<float> floats(count + Offset);
+		for(size_t i = 0; i < floats.size(); ++i) {
+			switch(i % 4) {
+				case 0: floats[i] = specials[(i / 4) % (sizeof(specials) / sizeof(specials[0]))]; break;
+				case 1: floats[i] = (code(random) + 0.5f) / 255.0f; break;
+				default: floats[i] = unit(random); break;
+			}
+		}
+		return floats;
+	}
+
+	std::string Describe(const char* kernel, SimdLevel level, size_t count)
+	{
+		return std::string(kernel) + " " + ChannelKernels::GetSimdLevelName(level) + " count " + std::to_string(count);
+	}
+
+	template<typename Fn>
+	auto RunAt(SimdLevel level, Fn fn)
+	{
+		ChannelKernels::ForceSimdLevel(level);
+		return fn();
+	}
+
+	void TestPacking(SimdLevel level)
+	{
+		for(size_t count : Lengths) {
+			const std::vector<uint8_t> ao = MakeBytes(count);
+			const std::vector<uint8_t> rough = MakeBytes(count);
+			const std::vector<uint8_t> metal = MakeBytes(count);
+
+			auto unreal = [&] {
+				std::vector<uint8_t> rgb(count * 3 + Offset);
+				ChannelKernels::PackUnrealRGB(ao.data() + Offset, rough.data() + Offset, metal.data() + Offset, rgb.data() + Offset, count);
+				return rgb;
+			};
+			auto unity = [&] {
+				std::vector<uint8_t> rgba(count * 4 + Offset);
+				ChannelKernels::PackUnityRGBA(ao.data() + Offset, rough.data() + Offset, metal.data() + Offset, rgba.data() + Offset, count);
+				return rgba;
+			};
+			auto both = [&] {
+				std::vector<uint8_t> out(count * 7 + 2 * Offset);
+				ChannelKernels::PackUnrealAndUnity(ao.data() + Offset, rough.data() + Offset, metal.data() + Offset,
+					out.data() + Offset, out.data() + count * 3 + 2 * Offset, count);
+				return out;
+			};
+
+			const std::vector<uint8_t> unrealScalar = RunAt(SimdLevel::Scalar, unreal);
+			const std::vector<uint8_t> unityScalar = RunAt(SimdLevel::Scalar, unity);
+			const std::vector<uint8_t> bothScalar = RunAt(SimdLevel::Scalar, both);
+			Test::Check(RunAt(level, unreal) == unrealScalar, Describe("PackUnrealRGB", level, count));
+			Test::Check(RunAt(level, unity) == unityScalar, Describe("PackUnityRGBA", level, count));
+			Test::Check(RunAt(level, both) == bothScalar, Describe("PackUnrealAndUnity", level, count));
+
+			// The Scalar layouts themselves, so a bug shared by every path does not pass unnoticed.
+			for(size_t i = 0; i < count; ++i) {
+				const uint8_t a = ao[Offset + i];
+				const uint8_t r = rough[Offset + i];
+				const uint8_t m = metal[Offset + i];
+				const uint8_t* rgb = unrealScalar.data() + Offset + i * 3;
+				const uint8_t* rgba = unityScalar.data() + Offset + i * 4;
+				if(!Test::Check(rgb[0] == a && rgb[1] == r && rgb[2] == m && rgba[0] == m && rgba[1] == a && rgba[2] == 255
+					&& rgba[3] == 255 - r, Describe("Scalar layout", SimdLevel::Scalar, count)))
+					break;
+			}
+		}
+	}
+
+	template<typename T>
+	void TestQuantize(SimdLevel level, const char* name)
+	{
+		const QuantizeMode modes[] = { QuantizeMode::Nearest, QuantizeMode::OrderedDither };
+		for(QuantizeMode mode : modes) {
+			for(size_t count : Lengths) {
+				const std::vector<float> src = MakeFloats(count);
+				for(int y = 0; y < 8; ++y) {
+					const int x = y * 3;  // every dither column phase across the rows
+					auto quantize = [&] {
+						std::vector<T> dst(count + Offset);
+						ChannelKernels::Quantize(src.data() + Offset, dst.data() + Offset, count, mode, x, y);
+						return dst;
+					};
+					const std::string what = Describe(name, level, count) + (mode == QuantizeMode::Nearest ? " nearest" : " dither")
+						+ " y " + std::to_string(y);
+					Test::Check(RunAt(level, quantize) == RunAt(SimdLevel::Scalar, quantize), what);
+				}
+			}
+		}
+	}
+
+	void TestQuantizeReference()
+	{
+		ChannelKernels::ForceSimdLevel(SimdLevel::Scalar);
+		const std::vector<float> src = MakeFloats(1000);
+		std::vector<uint8_t> dst(src.size());
+		ChannelKernels::Quantize(src.data(), dst.data(), src.size(), QuantizeMode::Nearest, 0, 0);
+		for(size_t i = 0; i < src.size(); ++i) {
+			const float v = std::isnan(src[i]) ? 0.0f : std::fmin(std::fmax(src[i], 0.0f), 1.0f);
+			const int expected = static_cast<int>(std::floor(v * 255.0f + 0.5f));
+			if(!Test::Check(dst[i] == expected, "Quantize Scalar reference at " + std::to_string(i)))
+				break;
+		}
+	}
+
+	void TestNarrowTo8(SimdLevel level)
+	{
+		std::vector<uint16_t> src(65536 + Offset);
+		for(size_t i = 0; i < 65536; ++i)
+			src[i + Offset] = static_cast<uint16_t>(i);
+
+		for(size_t count : Lengths) {
+			auto narrow = [&] {
+				std::vector<uint8_t> dst(count + Offset);
+				ChannelKernels::NarrowTo8(src.data() + Offset + 40000, dst.data() + Offset, count);
+				return dst;
+			};
+			Test::Check(RunAt(level, narrow) == RunAt(SimdLevel::Scalar, narrow), Describe("NarrowTo8", level, count));
+		}
+
+		// Every 16-bit value against round(v / 257); 257 is odd, so there are no ties.
+		std::vector<uint8_t> all(65536);
+		RunAt(level, [&] { ChannelKernels::NarrowTo8(src.data() + Offset, all.data(), all.size()); return 0; });
+		for(uint32_t v = 0; v < 65536; ++v) {
+			if(!Test::Check(all[v] == (2 * v + 257) / 514, Describe("NarrowTo8 reference", level, v)))
+				break;
+		}
+	}
+}
+
+int main()
+{
+	TestQuantizeReference();
+	TestNarrowTo8(SimdLevel::Scalar);
+
+	for(SimdLevel level : Levels) {
+		ChannelKernels::ForceSimdLevel(level);
+		if(ChannelKernels::GetSimdLevel() != level) {
+			std::cout << ChannelKernels::GetSimdLevelName(level) << ": not supported here, skipped\n";
+			continue;
+		}
+		std::cout << ChannelKernels::GetSimdLevelName(level) << ": checking against Scalar\n";
+		TestPacking(level);
+		TestQuantize<uint8_t>(level, "Quantize<uint8_t>");
+		TestQuantize<uint16_t>(level, "Quantize<uint16_t>");
+		TestNarrowTo8(level);
+	}
+	return Test::Finish("ChannelKernels");
+}
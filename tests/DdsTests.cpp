@@ -0,0 +1,196 @@
+// BC4 and BC5 DDS outputs, read back from disk and compared with the blocks of the
+// expected 8-bit planes: in-memory 8-bit sources, and float sources decoded from
+// Radiance .hdr files, which must be quantized like the PNG outputs are.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "ChannelKernels.h"
+#include "ORMGenerator.h"
+#include "TestCheck.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// Not a multiple of the 4x4 block, so the padded edge blocks are covered too.
+	constexpr int Width = 21;
+	constexpr int Height = 10;
+
+	constexpr size_t DdsHeaderBytes = 4 + 124 + 20;  // magic, header, DX10 header
+	constexpr uint32_t DxgiBC4 = 80;
+	constexpr uint32_t DxgiBC5 = 83;
+
+	// Largest error of the decoded blocks; the gradient is smooth apart from the clamp samples.
+	constexpr int MaxBlockError = 16;
+
+	/** Source samples as the HDR decoder sees them, before quantization. */
+	struct FloatPlane
+	{
+		std::vector<float> samples;
+		std::vector<unsigned char> rgbe;
+	};
+
+	/**
+	 * A smooth gradient of exact Radiance values k / 256, plus one sample above 1 and one at 0
+	 * so both clamp ends of the quantizer are exercised.
+	 */
+	FloatPlane MakeGradient(int seed)
+	{
+		FloatPlane plane;
+		for(int y = 0; y < Height; ++y) {
+			for(int x = 0; x < Width; ++x) {
+				int mantissa = 8 + seed * 30 + x * 4 + y * 3;
+				int exponent = 128;
+				if(x == 0 && y == 0) { mantissa = 192; exponent = 129; }  // 1.5
+				if(x == Width - 1 && y == Height - 1) { mantissa = 0; exponent = 0; }
+				const unsigned char m = static_cast<unsigned char>(mantissa);
+				plane.rgbe.insert(plane.rgbe.end(), { m, m, m, static_cast<unsigned char>(exponent) });
+				plane.samples.push_back(exponent ? static_cast<float>(std::ldexp(mantissa, exponent - 136)) : 0.0f);
+			}
+		}
+		return plane;
+	}
+
+	bool WriteHdr(const std::filesystem::path& path, const FloatPlane& plane)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " << Height << " +X " << Width << "\n";
+		file.write(reinterpret_cast<const char*>(plane.rgbe.data()), static_cast<std::streamsize>(plane.rgbe.size()));
+		return static_cast<bool>(file.flush());
+	}
+
+	std::vector<uint8_t> Quantize(const FloatPlane& plane, QuantizeMode mode)
+	{
+		std::vector<uint8_t> quantized(plane.samples.size());
+		for(int y = 0; y < Height; ++y)
+			ChannelKernels::Quantize(plane.samples.data() + static_cast<size_t>(y) * Width, quantized.data() + static_cast<size_t>(y) * Width,
+				Width, mode, 0, y);
+		return quantized;
+	}
+
+	std::vector<uint8_t> Narrow(const FloatPlane& plane)
+	{
+		std::vector<uint8_t> samples;
+		for(size_t i = 0; i < plane.samples.size(); ++i)
+			samples.push_back(static_cast<uint8_t>(plane.rgbe[i * 4]));
+		return samples;
+	}
+
+	GrayscalePlane ToGrayscale(const std::vector<uint8_t>& samples)
+	{
+		std::shared_ptr<unsigned char> pixels(new unsigned char[samples.size()], std::default_delete<unsigned char[]>());
+		std::copy(samples.begin(), samples.end(), pixels.get());
+		return GrayscalePlane{ std::move(pixels), Width, Height, 8 };
+	}
+
+	std::vector<unsigned char> ReadFile(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	/** The file's blocks against the compressor's blocks of the expected texels, and the decoded texels against them. */
+	void CheckDds(const std::filesystem::path& path, BlockFormat format, BlockQuality quality, const std::vector<uint8_t>& expected,
+		const std::string& what)
+	{
+		const std::string name = what + " " + path.filename().string();
+		const std::vector<unsigned char> file = ReadFile(path);
+		const size_t blockBytes = BlockCompressor::GetCompressedSize(format, Width, Height);
+		if(!Test::Check(file.size() == DdsHeaderBytes + blockBytes, name + ": file size"))
+			return;
+
+		const uint32_t dxgi = file[128] | file[129] << 8 | file[130] << 16 | static_cast<uint32_t>(file[131]) << 24;
+		Test::Check(dxgi == (format == BlockFormat::BC4 ? DxgiBC4 : DxgiBC5), name + ": DXGI format");
+
+		ThreadPool pool(1);
+		const std::vector<unsigned char> reference = BlockCompressor(pool).Compress(expected.data(), Width, Height,
+			BlockCompressor::GetDecodedChannels(format), format, quality);
+		const std::vector<unsigned char> blocks(file.begin() + DdsHeaderBytes, file.end());
+		Test::Check(blocks == reference, name + ": blocks of the expected 8-bit texels");
+
+		std::vector<unsigned char> decoded(expected.size());
+		BlockCompressor::Decompress(blocks.data(), Width, Height, format, decoded.data());
+		int error = 0;
+		for(size_t i = 0; i < expected.size(); ++i)
+			error = std::max(error, std::abs(decoded[i] - expected[i]));
+		Test::Check(error <= MaxBlockError, name + ": decoded error " + std::to_string(error));
+	}
+
+	std::vector<uint8_t> Interleave(const std::vector<uint8_t>& first, const std::vector<uint8_t>& second)
+	{
+		std::vector<uint8_t> pairs;
+		for(size_t i = 0; i < first.size(); ++i)
+			pairs.insert(pairs.end(), { first[i], second[i] });
+		return pairs;
+	}
+
+	/** ao / roughness / metallic hold the 8-bit texels the DDS files must encode. */
+	void TestMaterial(ThreadPool& pool, const ORMSources& sources, ORMJob job, const std::vector<uint8_t> (&expected)[3],
+		const std::string& what)
+	{
+		const std::filesystem::path directory = std::filesystem::path(job.unrealPath).parent_path();
+		const ORMGenerator generator(pool);
+		for(BlockFormat format : { BlockFormat::BC4, BlockFormat::BC5 }) {
+			job.blockFormat = format;
+			const std::string name = what + (format == BlockFormat::BC4 ? " bc4" : " bc5");
+			const ORMResult result = generator.Generate(sources, job);
+			if(!Test::Check(result.Succeeded(), name + ": Generate: " + result.message))
+				continue;
+
+			CheckDds(directory / "Material_ORM_AO.dds", BlockFormat::BC4, job.blockQuality, expected[0], name);
+			if(format == BlockFormat::BC4) {
+				CheckDds(directory / "Material_ORM_Roughness.dds", BlockFormat::BC4, job.blockQuality, expected[1], name);
+				CheckDds(directory / "Material_ORM_Metallic.dds", BlockFormat::BC4, job.blockQuality, expected[2], name);
+			}
+			else
+				CheckDds(directory / "Material_ORM_RoughnessMetallic.dds", BlockFormat::BC5, job.blockQuality,
+					Interleave(expected[1], expected[2]), name);
+		}
+	}
+}
+
+int main()
+{
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "ORMToolDdsTests";
+	std::filesystem::create_directories(directory);
+
+	const FloatPlane planes[3] = { MakeGradient(0), MakeGradient(1), MakeGradient(2) };
+	const char* const names[3] = { "AO.hdr", "Roughness.hdr", "Metallic.hdr" };
+	for(int i = 0; i < 3; ++i)
+		Test::Check(WriteHdr(directory / names[i], planes[i]), std::string("write ") + names[i]);
+
+	ORMJob job;
+	job.unrealPath = (directory / "Material_ORM.png").string();
+	job.generateUnity = false;
+
+	ThreadPool pool;
+	{
+		// 8-bit sources are block-compressed as they are.
+		const std::vector<uint8_t> expected[3] = { Narrow(planes[0]), Narrow(planes[1]), Narrow(planes[2]) };
+		ORMSources sources;
+		sources.ao = ToGrayscale(expected[0]);
+		sources.roughness = ToGrayscale(expected[1]);
+		sources.metallic = ToGrayscale(expected[2]);
+		TestMaterial(pool, sources, job, expected, "8-bit");
+	}
+
+	job.aoPath = (directory / names[0]).string();
+	job.roughnessPath = (directory / names[1]).string();
+	job.metallicPath = (directory / names[2]).string();
+	for(QuantizeMode mode : { QuantizeMode::Nearest, QuantizeMode::OrderedDither }) {
+		job.quantize = mode;
+		const std::vector<uint8_t> expected[3] = { Quantize(planes[0], mode), Quantize(planes[1], mode), Quantize(planes[2], mode) };
+		TestMaterial(pool, ORMSources(), job, expected, mode == QuantizeMode::Nearest ? "hdr nearest" : "hdr dither");
+	}
+
+	std::filesystem::remove_all(directory);
+	return Test::Finish("Dds");
+}
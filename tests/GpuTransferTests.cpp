@@ -0,0 +1,276 @@
+// Pixel buffer round trips on a headless GL context (EGL, else OSMesa): images streamed
+// up through GpuUploadQueue's PixelBufferRing with and without persistent mapping, read
+// back through TextureExporter's pack buffers, and CPU pixels saved without a readback.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Constants.h"
+#include "GLFunctions.h"
+#include "GpuUploadQueue.h"
+#include "IOService.h"
+#include "TestCheck.h"
+#include "TextureExporter.h"
+#include "ThreadPool.h"
+
+#if defined(ORM_TEST_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#elif defined(ORM_TEST_OSMESA)
+#include <GL/osmesa.h>
+#endif
+
+#ifndef GL_NUM_EXTENSIONS
+#define GL_NUM_EXTENSIONS 0x821D
+#endif
+
+namespace
+{
+	// ctest reports the test as skipped when no headless context can be created.
+	constexpr int SkipExitCode = 77;
+
+	// GpuUploadQueue::Drain calls before an upload counts as stuck.
+	constexpr int MaxDrains = 100000;
+
+	bool allowPersistentMapping = true;
+
+	struct Size
+	{
+		int width;
+		int height;
+		int channels;
+	};
+
+	// Odd sizes and rows that do not fit a ring slot, so partial chunks and the direct path run too.
+	const Size UploadSizes[] = { { 1531, 977, 1 }, { 1531, 977, 4 }, { 3, 2, 3 }, { 16384, 300, 4 }, { 777, 1400, 3 } };
+
+	const ImageFormat LosslessFormats[] = { ImageFormat::PNG, ImageFormat::TGA, ImageFormat::BMP };
+
+	std::mt19937 random(1234);
+
+#if defined(ORM_TEST_EGL)
+	bool MakeContextCurrent()
+	{
+		EGLDisplay display = EGL_NO_DISPLAY;
+		auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+		if(getPlatformDisplay)
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+#endif
+		if(display == EGL_NO_DISPLAY)
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		EGLint major = 0, minor = 0;
+		if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor) || !eglBindAPI(EGL_OPENGL_API))
+			return false;
+
+		const EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		EGLConfig config = nullptr;
+		EGLint configCount = 0;
+		if(!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount < 1)
+			return false;
+
+		const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		const EGLint contextAttributes[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+		EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+		EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+		return surface != EGL_NO_SURFACE && context != EGL_NO_CONTEXT && eglMakeCurrent(display, surface, surface, context);
+	}
+
+	GLFWglproc GetProcAddress(const char* name)
+	{
+		return reinterpret_cast<GLFWglproc>(eglGetProcAddress(name));
+	}
+#elif defined(ORM_TEST_OSMESA)
+	bool MakeContextCurrent()
+	{
+		static unsigned char framebuffer[4];
+		const int attributes[] = { OSMESA_FORMAT, OSMESA_RGBA, OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+			OSMESA_CONTEXT_MAJOR_VERSION, 3, OSMESA_CONTEXT_MINOR_VERSION, 3, 0 };
+		OSMesaContext context = OSMesaCreateContextAttribs(attributes, nullptr);
+		return context && OSMesaMakeCurrent(context, framebuffer, GL_UNSIGNED_BYTE, 1, 1);
+	}
+
+	GLFWglproc GetProcAddress(const char* name)
+	{
+		return reinterpret_cast<GLFWglproc>(OSMesaGetProcAddress(name));
+	}
+#endif
+
+	std::shared_ptr<const unsigned char> MakePixels(size_t bytes)
+	{
+		std::uniform_int_distribution<int> byte(0, 255);
+		std::shared_ptr<unsigned char> pixels(new unsigned char[bytes], std::default_delete<unsigned char[]>());
+		for(size_t i = 0; i < bytes; ++i)
+			pixels.get()[i] = static_cast<unsigned char>(byte(random));
+		return pixels;
+	}
+
+	GpuUploadImage MakeImage(const Size& size, bool mips)
+	{
+		GpuUploadImage image{ MakePixels(static_cast<size_t>(size.width) * size.height * size.channels), size.width, size.height, size.channels };
+		for(int level = 1; mips && (image.GetLevelWidth(level - 1) > 1 || image.GetLevelHeight(level - 1) > 1); ++level)
+			image.mips.push_back(MakePixels(static_cast<size_t>(image.GetLevelWidth(level)) * image.GetLevelHeight(level) * size.channels));
+		return image;
+	}
+
+	GLenum GetFormat(int channels)
+	{
+		return channels == 1 ? GL_RED : channels == 3 ? GL_RGB : GL_RGBA;
+	}
+
+	std::string Describe(const Size& size)
+	{
+		return std::to_string(size.width) + "x" + std::to_string(size.height) + "x" + std::to_string(size.channels);
+	}
+
+	/** Every level of every texture read back synchronously, against the posted pixels. */
+	void TestUploads(bool persistent)
+	{
+		allowPersistentMapping = persistent;
+		const std::string mode = persistent ? "persistent" : "mapped per fill";
+
+		std::vector<GpuUploadImage> images;
+		for(const Size& size : UploadSizes)
+			images.push_back(MakeImage(size, images.size() % 2 == 1));
+
+		GpuUploadQueue queue;
+		std::vector<unsigned int> textures;
+		for(const GpuUploadImage& image : images)
+			queue.Post(image, [&textures] (unsigned int texture, const GpuUploadImage&) { textures.push_back(texture); });
+
+		int drains = 0;
+		while(queue.GetPendingCount() > 0 || textures.size() < images.size()) {
+			queue.Drain(ORM::GpuUploadBudgetMs);
+			if(!Test::Check(++drains < MaxDrains, "uploads (" + mode + ") finish"))
+				break;
+		}
+
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		for(size_t i = 0; i < textures.size(); ++i) {
+			const GpuUploadImage& image = images[i];
+			glBindTexture(GL_TEXTURE_2D, textures[i]);
+			for(int level = 0; level < image.GetLevelCount(); ++level) {
+				const std::string what = "upload (" + mode + ") " + Describe(UploadSizes[i]) + " level " + std::to_string(level);
+				GLint width = 0, height = 0;
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+				if(!Test::Check(width == image.GetLevelWidth(level) && height == image.GetLevelHeight(level), what + ": size"))
+					continue;
+
+				const size_t bytes = static_cast<size_t>(width) * height * image.channels;
+				std::vector<unsigned char> texels(bytes);
+				glGetTexImage(GL_TEXTURE_2D, level, GetFormat(image.channels), GL_UNSIGNED_BYTE, texels.data());
+				Test::Check(std::memcmp(texels.data(), image.GetLevelPixels(level), bytes) == 0, what + ": texels");
+			}
+			glDeleteTextures(1, &textures[i]);
+		}
+		queue.Shutdown();
+		Test::Check(glGetError() == GL_NO_ERROR, "uploads (" + mode + "): GL error");
+	}
+
+	bool SameAsFile(const std::string& path, const unsigned char* expected, int width, int height, int channels)
+	{
+		int fileWidth = 0, fileHeight = 0;
+		unsigned char* pixels = IOService::LoadPixels(path, fileWidth, fileHeight, channels);
+		const bool same = pixels && fileWidth == width && fileHeight == height
+			&& std::memcmp(pixels, expected, static_cast<size_t>(width) * height * channels) == 0;
+		IOService::FreePixels(pixels);
+		return same;
+	}
+
+	/** Pack-buffer readbacks (Export) and CPU pixels (Save) in every lossless format, read back from disk. */
+	void TestExports(ThreadPool& pool, const std::filesystem::path& directory)
+	{
+		TextureExporter exporter(pool);
+		for(int channels : { 1, 3, 4 }) {
+			const Size size{ 1531, 977, channels };
+			const GpuUploadImage image = MakeImage(size, false);
+			const unsigned int texture = GpuUploadQueue::CreateTexture(image);
+
+			std::atomic<int> finished = 0;
+			std::atomic<int> saved = 0;
+			std::vector<std::string> paths;
+			for(ImageFormat format : LosslessFormats) {
+				const std::string stem = (directory / ("exported_" + std::to_string(channels))).string();
+				paths.push_back(stem + "_texture." + IOService::GetExtension(format));
+				paths.push_back(stem + "_pixels." + IOService::GetExtension(format));
+				auto onSaved = [&finished, &saved] (bool written, const std::string&) {
+					saved += written ? 1 : 0;
+					++finished;
+				};
+				Test::Check(exporter.Export(texture, size.width, size.height, channels, paths[paths.size() - 2], format, onSaved),
+					"Export " + paths[paths.size() - 2]);
+				Test::Check(exporter.Save(image.pixels, size.width, size.height, channels, paths.back(), format, onSaved),
+					"Save " + paths.back());
+			}
+
+			const int expected = static_cast<int>(paths.size());
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+			while(finished < expected && std::chrono::steady_clock::now() < deadline) {
+				exporter.Poll();
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			if(!Test::Check(finished == expected, "exports of " + Describe(size) + " finish"))
+				break;
+			Test::Check(saved == expected, "exports of " + Describe(size) + " written");
+
+			for(const std::string& path : paths)
+				Test::Check(SameAsFile(path, image.pixels.get(), size.width, size.height, channels), path + ": pixels");
+			glDeleteTextures(1, &texture);
+		}
+		exporter.Shutdown();
+		Test::Check(glGetError() == GL_NO_ERROR, "exports: GL error");
+	}
+}
+
+// GLFunctions resolves through GLFW; the test answers for it from the headless context instead of linking GLFW.
+GLFWglproc glfwGetProcAddress(const char* name)
+{
+	return GetProcAddress(name);
+}
+
+int glfwExtensionSupported(const char* extension)
+{
+	if(!allowPersistentMapping && std::strcmp(extension, "GL_ARB_buffer_storage") == 0)
+		return 0;
+
+	using GetStringiFn = const GLubyte* (APIENTRY*)(GLenum, GLuint);
+	const auto getStringi = reinterpret_cast<GetStringiFn>(GetProcAddress("glGetStringi"));
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for(GLint i = 0; getStringi && i < count; ++i) {
+		if(std::strcmp(reinterpret_cast<const char*>(getStringi(GL_EXTENSIONS, static_cast<GLuint>(i))), extension) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+int main()
+{
+	if(!MakeContextCurrent()) {
+		std::cout << "GpuTransfer: no headless OpenGL 3.3 context, skipped\n";
+		return SkipExitCode;
+	}
+	std::cout << "GpuTransfer: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << "\n";
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "ORMToolGpuTransferTests";
+	std::filesystem::create_directories(directory);
+
+	TestUploads(true);
+	TestUploads(false);
+
+	ThreadPool pool;
+	TestExports(pool, directory);
+
+	std::filesystem::remove_all(directory);
+	return Test::Finish("GpuTransfer");
+}
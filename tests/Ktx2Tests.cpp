@@ -0,0 +1,218 @@
+// KTX2 outputs of a non-power-of-two material, read back from disk: header, level
+// index and every level's texels against a 2x2 box-filtered reference chain.
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Ktx2Writer.h"
+#include "ORMGenerator.h"
+#include "TestCheck.h"
+#include "ThreadPool.h"
+
+#ifdef ORM_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace
+{
+	constexpr int Width = 13;
+	constexpr int Height = 7;
+
+	constexpr unsigned char Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	constexpr size_t LevelIndexOffset = 80;
+	constexpr size_t LevelIndexEntryBytes = 24;
+
+	struct Plane
+	{
+		std::vector<uint8_t> samples;
+		int width = 0;
+		int height = 0;
+	};
+
+	struct Level
+	{
+		Plane ao;
+		Plane roughness;
+		Plane metallic;
+	};
+
+	uint64_t Get(const std::vector<unsigned char>& file, size_t offset, int bytes)
+	{
+		uint64_t value = 0;
+		for(int i = 0; i < bytes && offset + i < file.size(); ++i)
+			value |= static_cast<uint64_t>(file[offset + i]) << (8 * i);
+		return value;
+	}
+
+	Plane MakePlane(std::mt19937& random)
+	{
+		std::uniform_int_distribution<int> byte(0, 255);
+		Plane plane{ std::vector<uint8_t>(static_cast<size_t>(Width) * Height), Width, Height };
+		for(uint8_t& sample : plane.samples)
+			sample = static_cast<uint8_t>(byte(random));
+		return plane;
+	}
+
+	/** Rounded mean of each 2x2 block; an odd last row or column of the parent is dropped. */
+	Plane Box(const Plane& parent)
+	{
+		Plane half{ {}, std::max(1, parent.width / 2), std::max(1, parent.height / 2) };
+		half.samples.resize(static_cast<size_t>(half.width) * half.height);
+		for(int y = 0; y < half.height; ++y) {
+			const int y0 = std::min(2 * y, parent.height - 1);
+			const int y1 = std::min(2 * y + 1, parent.height - 1);
+			for(int x = 0; x < half.width; ++x) {
+				const int x0 = std::min(2 * x, parent.width - 1);
+				const int x1 = std::min(2 * x + 1, parent.width - 1);
+				auto at = [&] (int px, int py) { return static_cast<uint32_t>(parent.samples[static_cast<size_t>(py) * parent.width + px]); };
+				half.samples[static_cast<size_t>(y) * half.width + x] = static_cast<uint8_t>((at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1) + 2) >> 2);
+			}
+		}
+		return half;
+	}
+
+	std::vector<uint8_t> Pack(const Level& level, bool unreal)
+	{
+		std::vector<uint8_t> texels;
+		for(size_t i = 0; i < level.ao.samples.size(); ++i) {
+			const uint8_t a = level.ao.samples[i];
+			const uint8_t r = level.roughness.samples[i];
+			const uint8_t m = level.metallic.samples[i];
+			if(unreal)
+				texels.insert(texels.end(), { a, r, m });
+			else
+				texels.insert(texels.end(), { m, a, 255, static_cast<uint8_t>(255 - r) });
+		}
+		return texels;
+	}
+
+	GrayscalePlane ToGrayscale(const Plane& plane)
+	{
+		std::shared_ptr<unsigned char> pixels(new unsigned char[plane.samples.size()], std::default_delete<unsigned char[]>());
+		std::copy(plane.samples.begin(), plane.samples.end(), pixels.get());
+		return GrayscalePlane{ std::move(pixels), plane.width, plane.height, 8 };
+	}
+
+	std::vector<unsigned char> ReadFile(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	/** Stored bytes of one level, undone from Zstandard when the file is supercompressed. */
+	bool ReadLevel(const std::vector<unsigned char>& file, uint64_t offset, uint64_t bytes, uint64_t uncompressedBytes, bool zstd,
+		std::vector<uint8_t>& texels)
+	{
+		const unsigned char* data = file.data() + offset;
+		if(!zstd) {
+			texels.assign(data, data + bytes);
+			return true;
+		}
+#ifdef ORM_HAS_ZSTD
+		texels.resize(uncompressedBytes);
+		const size_t size = ZSTD_decompress(texels.data(), texels.size(), data, bytes);
+		return !ZSTD_isError(size) && size == uncompressedBytes;
+#else
+		(void)uncompressedBytes;
+		return false;
+#endif
+	}
+
+	void CheckFile(const std::filesystem::path& path, const std::vector<Level>& chain, bool unreal, bool zstd)
+	{
+		const std::string name = path.filename().string() + (zstd ? " (zstd)" : "");
+		const std::vector<unsigned char> file = ReadFile(path);
+		if(!Test::Check(file.size() > LevelIndexOffset && std::equal(std::begin(Identifier), std::end(Identifier), file.begin()),
+			name + ": KTX2 identifier"))
+			return;
+
+		const int channels = unreal ? 3 : 4;
+		const uint64_t levelCount = Get(file, 40, 4);
+		Test::Check(Get(file, 12, 4) == Ktx2Writer::GetVkFormat(channels, BlockFormat::None), name + ": vkFormat");
+		Test::Check(Get(file, 16, 4) == 1, name + ": typeSize");
+		Test::Check(Get(file, 20, 4) == Width && Get(file, 24, 4) == Height, name + ": pixel size");
+		Test::Check(Get(file, 28, 4) == 0 && Get(file, 32, 4) == 0 && Get(file, 36, 4) == 1, name + ": depth, layers, faces");
+		Test::Check(Get(file, 44, 4) == (zstd ? 2u : 0u), name + ": supercompression scheme");
+		if(!Test::Check(levelCount == chain.size(), name + ": level count " + std::to_string(levelCount)))
+			return;
+
+		// Level data follows the descriptor and key/value data, smallest level first.
+		const uint64_t dataStart = Get(file, 56, 4) + Get(file, 60, 4);
+		const uint64_t alignment = zstd ? 1 : (unreal ? 12 : 4);
+		uint64_t previousOffset = file.size();
+		for(size_t i = 0; i < chain.size(); ++i) {
+			const std::string level = name + " level " + std::to_string(i);
+			const size_t entry = LevelIndexOffset + i * LevelIndexEntryBytes;
+			const uint64_t offset = Get(file, entry, 8);
+			const uint64_t bytes = Get(file, entry + 8, 8);
+			const uint64_t uncompressedBytes = Get(file, entry + 16, 8);
+			const uint64_t expectedBytes = static_cast<uint64_t>(chain[i].ao.width) * chain[i].ao.height * channels;
+
+			Test::Check(uncompressedBytes == expectedBytes, level + ": uncompressed size");
+			Test::Check(zstd || bytes == expectedBytes, level + ": stored size");
+			Test::Check(offset % alignment == 0, level + ": offset alignment");
+			if(!Test::Check(offset >= dataStart && offset + bytes <= previousOffset, level + ": offset inside the file, after the smaller levels"))
+				return;
+			previousOffset = offset;
+
+			std::vector<uint8_t> texels;
+			if(!Test::Check(ReadLevel(file, offset, bytes, uncompressedBytes, zstd, texels), level + ": decompression"))
+				continue;
+			Test::Check(texels == Pack(chain[i], unreal), level + ": texels against the box-filtered reference");
+		}
+	}
+
+	void TestMaterial(ThreadPool& pool, const std::vector<Level>& chain, int zstdLevel)
+	{
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "ORMToolKtx2Tests";
+		std::filesystem::create_directories(directory);
+
+		ORMSources sources;
+		sources.ao = ToGrayscale(chain[0].ao);
+		sources.roughness = ToGrayscale(chain[0].roughness);
+		sources.metallic = ToGrayscale(chain[0].metallic);
+
+		ORMJob job;
+		job.unrealPath = (directory / "Material_ORM.png").string();
+		job.unityPath = (directory / "Material_MaskMap.png").string();
+		job.generateKtx2 = true;
+		job.ktx2Format = BlockFormat::None;
+		job.ktx2ZstdLevel = zstdLevel;
+
+		const ORMGenerator generator(pool);
+		const ORMResult result = generator.Generate(sources, job);
+		if(Test::Check(result.Succeeded(), "Generate: " + result.message)) {
+			CheckFile(directory / "Material_ORM.ktx2", chain, true, zstdLevel > 0);
+			CheckFile(directory / "Material_MaskMap.ktx2", chain, false, zstdLevel > 0);
+		}
+		std::filesystem::remove_all(directory);
+	}
+}
+
+int main()
+{
+	std::mt19937 random(1234);
+	std::vector<Level> chain(1);
+	chain[0].ao = MakePlane(random);
+	chain[0].roughness = MakePlane(random);
+	chain[0].metallic = MakePlane(random);
+	while(chain.back().ao.width > 1 || chain.back().ao.height > 1) {
+		const Level& parent = chain.back();
+		chain.push_back(Level{ Box(parent.ao), Box(parent.roughness), Box(parent.metallic) });
+	}
+	Test::Check(static_cast<int>(chain.size()) == Ktx2Writer::GetFullMipCount(Width, Height), "reference chain length");
+
+	ThreadPool pool;
+	TestMaterial(pool, chain, 0);
+#ifdef ORM_HAS_ZSTD
+	Test::Check(Ktx2Writer::SupportsZstd(), "SupportsZstd in a build with ORM_HAS_ZSTD");
+	TestMaterial(pool, chain, 3);
+#endif
+	return Test::Finish("Ktx2");
+}
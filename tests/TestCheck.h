@@ -0,0 +1,32 @@
+#pragma once
+#include <iostream>
+#include <string>
+
+/**
+ * Minimal checks for the ctest executables: every failed Check() is printed and
+ * counted, and Finish() turns the count into the process exit code.
+ */
+namespace Test
+{
+	inline int& GetFailureCount()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	inline bool Check(bool condition, const std::string& what)
+	{
+		if(!condition) {
+			++GetFailureCount();
+			std::cerr << "FAILED: " << what << "\n";
+		}
+		return condition;
+	}
+
+	inline int Finish(const char* suite)
+	{
+		const int failures = GetFailureCount();
+		std::cout << suite << ": " << (failures ? std::to_string(failures) + " check(s) failed" : std::string("all checks passed")) << "\n";
+		return failures ? 1 : 0;
+	}
+}